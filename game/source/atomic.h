@@ -0,0 +1,70 @@
+#ifndef ATOMIC_H_INCLUDED
+#define ATOMIC_H_INCLUDED
+
+#include "types.h"
+
+// just enough ordering for single producer / single consumer handoffs between threads:
+// a store with release makes all writes before it visible to the thread that loads the value with acquire.
+// exchange, fetchAdd and compareExchange do both
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+
+static inline uint32 atomic_loadAcquire( const volatile uint32* pValue )
+{
+	// x86 loads are not reordered with later loads and stores, only the compiler has to be stopped
+	const uint32 value = *pValue;
+	_ReadWriteBarrier();
+	return value;
+}
+
+static inline void atomic_storeRelease( volatile uint32* pValue, uint32 value )
+{
+	_ReadWriteBarrier();
+	*pValue = value;
+}
+
+static inline uint32 atomic_exchange( volatile uint32* pValue, uint32 value )
+{
+	return (uint32)_InterlockedExchange( (volatile long*)pValue, (long)value );
+}
+
+static inline uint32 atomic_fetchAdd( volatile uint32* pValue, uint32 value )
+{
+	return (uint32)_InterlockedExchangeAdd( (volatile long*)pValue, (long)value );
+}
+
+// returns TRUE if the value was expected and is now desired
+static inline int atomic_compareExchange( volatile uint32* pValue, uint32 expected, uint32 desired )
+{
+	return (uint32)_InterlockedCompareExchange( (volatile long*)pValue, (long)desired, (long)expected ) == expected;
+}
+#else
+static inline uint32 atomic_loadAcquire( const volatile uint32* pValue )
+{
+	return __atomic_load_n( pValue, __ATOMIC_ACQUIRE );
+}
+
+static inline void atomic_storeRelease( volatile uint32* pValue, uint32 value )
+{
+	__atomic_store_n( pValue, value, __ATOMIC_RELEASE );
+}
+
+static inline uint32 atomic_exchange( volatile uint32* pValue, uint32 value )
+{
+	return __atomic_exchange_n( pValue, value, __ATOMIC_ACQ_REL );
+}
+
+static inline uint32 atomic_fetchAdd( volatile uint32* pValue, uint32 value )
+{
+	return __atomic_fetch_add( pValue, value, __ATOMIC_ACQ_REL );
+}
+
+// returns TRUE if the value was expected and is now desired
+static inline int atomic_compareExchange( volatile uint32* pValue, uint32 expected, uint32 desired )
+{
+	return __atomic_compare_exchange_n( pValue, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+#endif
+
+#endif
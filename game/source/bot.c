@@ -0,0 +1,176 @@
+#include "bot.h"
+#include "input.h"
+#include "vector.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+enum
+{
+	BotWanderTicks		= 3u * ClientTickRate,
+	BotBombCooldown		= ClientTickRate
+};
+
+static const float s_botBombRange		= 6.0f;
+static const float s_botWorldExtent		= 18.0f;	// wander targets stay inside this
+
+static uint32 bot_random( Bot* pBot )
+{
+	uint32 x = pBot->randomState;
+	x ^= x << 13u;
+	x ^= x >> 17u;
+	x ^= x << 5u;
+	pBot->randomState = x;
+	return x;
+}
+
+static float bot_randomRange( Bot* pBot, float min, float max )
+{
+	return min + ( max - min ) * (float)( bot_random( pBot ) >> 8u ) / (float)( 1u << 24u );
+}
+
+void bot_create( Bot* pBot, const IP4Address* pServerAddress, uint botIndex )
+{
+	// the name identifies the own player in the received states:
+	char name[ 12u ];
+	sprintf( name, "bot%u", botIndex % 100000000u );
+	client_create( &pBot->client, pServerAddress, name );
+
+	pBot->randomState		= 0x9e3779b9u ^ ( botIndex * 0x85ebca6bu + 1u );
+	pBot->wanderTicks		= 0u;
+	pBot->bombCooldown		= 0u;
+	pBot->buttonMask		= 0u;
+	float2_set( &pBot->wanderTarget, 0.0f, 0.0f );
+}
+
+void bot_destroy( Bot* pBot )
+{
+	client_destroy( &pBot->client );
+}
+
+static const ClientPlayer* bot_findPlayer( const Bot* pBot )
+{
+	const ClientGameState* pState = &pBot->client.gameState;
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
+	{
+		const ClientPlayer* pPlayer = &pState->player[ i ];
+		if( pPlayer->state != PlayerState_InActive && strncmp( pPlayer->name, pBot->client.state.name, sizeof( pPlayer->name ) ) == 0 )
+		{
+			return pPlayer;
+		}
+	}
+	return 0;
+}
+
+static uint bot_getButtonMask( Bot* pBot, const FlowField* pFlowField )
+{
+	const ClientGameState* pState = &pBot->client.gameState;
+	const ClientPlayer* pSelf = bot_findPlayer( pBot );
+	if( !pSelf )
+	{
+		return 0u;
+	}
+
+	float2 position;
+	float2_set( &position, float_unquantize( pSelf->posX ), float_unquantize( pSelf->posY ) );
+	const float direction = angle_unquantize( pSelf->direction );
+
+	// the flow field leads out of danger and around obstacles to the closest item:
+	float2 target = position;
+	float2 flowDirection;
+	if( flowfield_getDirection( pFlowField, &flowDirection, &position ) )
+	{
+		float2_addScaled1f( &target, &position, &flowDirection, 5.0f );
+	}
+	else
+	{
+		// on the cell of an item drive right to it, without items wander around:
+		float bestDistance = 1e30f;
+		for( uint i = 0u; i < SYS_COUNTOF( pState->items ); ++i )
+		{
+			const ClientItem* pItem = &pState->items[ i ];
+			if( pItem->type == ItemType_None )
+			{
+				continue;
+			}
+
+			float2 itemPosition;
+			float2_set( &itemPosition, float_unquantize( pItem->posX ), float_unquantize( pItem->posY ) );
+			const float distance = float2_squareDistance( &itemPosition, &position );
+			if( distance < bestDistance )
+			{
+				bestDistance	= distance;
+				target			= itemPosition;
+			}
+		}
+
+		if( bestDistance >= 1e30f )
+		{
+			if( pBot->wanderTicks == 0u || float2_squareDistance( &pBot->wanderTarget, &position ) < 4.0f )
+			{
+				float2_set( &pBot->wanderTarget, bot_randomRange( pBot, -s_botWorldExtent, s_botWorldExtent ), bot_randomRange( pBot, -s_botWorldExtent, s_botWorldExtent ) );
+				pBot->wanderTicks = BotWanderTicks;
+			}
+			pBot->wanderTicks--;
+			target = pBot->wanderTarget;
+		}
+	}
+
+	float2 forward;
+	float2_from_angle( &forward, direction );
+
+	float2 toTarget;
+	float2_sub( &toTarget, &target, &position );
+
+	uint buttonMask = ButtonMask_Up;
+	const float side = forward.x * toTarget.y - forward.y * toTarget.x;
+	if( side > 0.1f )
+	{
+		buttonMask |= ButtonMask_Left;
+	}
+	else if( side < -0.1f )
+	{
+		buttonMask |= ButtonMask_Right;
+	}
+
+	// drop a bomb when another car is close to the line the car is driving on (the bomb cross is aligned with it):
+	if( pBot->bombCooldown > 0u )
+	{
+		pBot->bombCooldown--;
+	}
+	else if( !flowfield_isDangerous( pFlowField, &position ) )
+	{
+		for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
+		{
+			const ClientPlayer* pOther = &pState->player[ i ];
+			if( pOther == pSelf || pOther->state == PlayerState_InActive )
+			{
+				continue;
+			}
+
+			float2 toOther;
+			float2_set( &toOther, float_unquantize( pOther->posX ) - position.x, float_unquantize( pOther->posY ) - position.y );
+			const float along	= float2_dot( &toOther, &forward );
+			const float across	= forward.x * toOther.y - forward.y * toOther.x;
+			if( float_abs( along ) < s_botBombRange && float_abs( across ) < s_carRadius * 2.0f )
+			{
+				buttonMask |= ButtonMask_PlaceBomb;
+				pBot->bombCooldown = BotBombCooldown;
+				break;
+			}
+		}
+	}
+
+	return buttonMask;
+}
+
+void bot_think( Bot* pBot, const FlowField* pFlowField )
+{
+	pBot->buttonMask = bot_getButtonMask( pBot, pFlowField );
+}
+
+int bot_update( Bot* pBot )
+{
+	return client_update( &pBot->client, pBot->buttonMask );
+}
@@ -0,0 +1,29 @@
+#ifndef BOT_H_INCLUDED
+#define BOT_H_INCLUDED
+
+#include "types.h"
+#include "client.h"
+#include "flowfield.h"
+
+// a headless client that decides its buttons from the received game state (for load tests, no renderer or sound)
+typedef struct
+{
+	Client		client;
+	uint32		randomState;
+	float2		wanderTarget;
+	uint		wanderTicks;		// until a new wander target is picked
+	uint		bombCooldown;		// in updates
+	uint		buttonMask;			// decided by bot_think, sent by bot_update
+} Bot;
+
+void	bot_create( Bot* pBot, const IP4Address* pServerAddress, uint botIndex );
+void	bot_destroy( Bot* pBot );
+
+// decides the buttons for the last received state. the flow field has to be updated with a state of the bot's match
+// (all bots of a match can share one). only reads the field, so the bots of a match can think in parallel
+void	bot_think( Bot* pBot, const FlowField* pFlowField );
+
+// sends the buttons of the last bot_think and receives new states. returns nonzero if the server went offline
+int		bot_update( Bot* pBot );
+
+#endif
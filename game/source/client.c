@@ -1,20 +1,24 @@
 #include "client.h"
 
+#include "statehash.h"
 #include "debug.h"
+#include "profile.h"
 
-void client_create( Client* pClient, const IP4Address* pServerAddress, const char* pName )
+void localconnection_init( LocalConnection* pConnection )
 {
-	socket_init();
-
-	pClient->socket			= socket_create();
-	pClient->serverAddress	= *pServerAddress;
+	spscring_init( &pConnection->inputs, pConnection->inputBuffer, sizeof( pConnection->inputBuffer[ 0u ] ), SYS_COUNTOF( pConnection->inputBuffer ) );
+	spscring_init( &pConnection->snapshots, pConnection->snapshotBuffer, sizeof( pConnection->snapshotBuffer[ 0u ] ), SYS_COUNTOF( pConnection->snapshotBuffer ) );
+}
 
+static void client_init( Client* pClient, const char* pName )
+{
 	pClient->state.id		  = 1u;
 	pClient->state.buttonMask = 0u;
 	pClient->state.flags	  = ClientStateFlag_Online;
 	copyString( pClient->state.name, sizeof( pClient->state.name ), pName );
 
 	pClient->gameState.id = 0u;
+	pClient->gameState.hash = 0u;
 	for( uint i = 0u; i < SYS_COUNTOF( pClient->gameState.player ); ++i )
 	{
 		pClient->gameState.player[ i ].state = PlayerState_InActive;
@@ -35,6 +39,58 @@ void client_create( Client* pClient, const IP4Address* pServerAddress, const cha
 	{
 		pClient->gameState.items[ i ].type = (uint8)ItemType_None;
 	}
+	for( uint i = 0u; i < SYS_COUNTOF( pClient->localStates ); ++i )
+	{
+		pClient->localStates[ i ].id = 0u;
+	}
+	pClient->desyncTick = 0u;
+}
+
+void client_create( Client* pClient, const IP4Address* pServerAddress, const char* pName )
+{
+	socket_init();
+
+	pClient->socket			= socket_create();
+	pClient->serverAddress	= *pServerAddress;
+	pClient->pConnection	= 0;
+
+	client_init( pClient, pName );
+}
+
+void client_createLocal( Client* pClient, LocalConnection* pConnection, const char* pName )
+{
+	pClient->socket					= InvalidSocket;
+	pClient->serverAddress.address	= InvalidIP;
+	pClient->serverAddress.port		= 0u;
+	pClient->pConnection			= pConnection;
+
+	client_init( pClient, pName );
+}
+
+static void client_sendState( Client* pClient )
+{
+	if( pClient->pConnection )
+	{
+		if( !spscring_push( &pClient->pConnection->inputs, &pClient->state ) )
+		{
+			SYS_TRACE_WARNING( "local input dropped!\n" );
+		}
+	}
+	else
+	{
+		socket_send_blocking( pClient->socket, &pClient->serverAddress, &pClient->state, sizeof( pClient->state ) );
+	}
+}
+
+static int client_receiveState( Client* pClient, ClientGameState* pGameState )
+{
+	if( pClient->pConnection )
+	{
+		return spscring_pop( &pClient->pConnection->snapshots, pGameState ) ? (int)sizeof( *pGameState ) : 0;
+	}
+
+	IP4Address from;
+	return socket_receive( pClient->socket, pGameState, sizeof( *pGameState ), &from );
 }
 
 void client_destroy( Client* pClient )
@@ -42,25 +98,29 @@ void client_destroy( Client* pClient )
 	pClient->state.id++;
 	pClient->state.buttonMask = 0u;
 	pClient->state.flags = 0u;
-	socket_send_blocking( pClient->socket, &pClient->serverAddress, &pClient->state, sizeof( pClient->state ) );
+	client_sendState( pClient );
 
-	socket_destroy( pClient->socket );
-	pClient->socket = InvalidSocket;
+	if( !pClient->pConnection )
+	{
+		socket_destroy( pClient->socket );
+		pClient->socket = InvalidSocket;
 
-	socket_done();
+		socket_done();
+	}
 }
 
 int client_update( Client* pClient, uint buttonMask )
 {
+	SYS_PROFILE_BEGIN( "client_update" );
+
 	pClient->state.id++;
 	pClient->state.buttonMask = (uint8)buttonMask;
-	socket_send_blocking( pClient->socket, &pClient->serverAddress, &pClient->state, sizeof( pClient->state ) );
+	client_sendState( pClient );
 
 	for(;;)
 	{
 		ClientGameState gameState;
-		IP4Address from;
-		const int result = socket_receive( pClient->socket, &gameState, sizeof( gameState ), &from );
+		const int result = client_receiveState( pClient, &gameState );
 		if( result > 0 )
 		{
 			SYS_ASSERT( result == sizeof( gameState ) );
@@ -68,10 +128,23 @@ int client_update( Client* pClient, uint buttonMask )
 
 			if( gameState.id > pClient->gameState.id )
 			{
+				if( statehash_compute( &gameState ) != gameState.hash )
+				{
+					SYS_TRACE_WARNING( "corrupted snapshot at tick %u!\n", gameState.id );
+					continue;
+				}
+
 				pClient->gameState = gameState;
 
+				const ClientGameState* pLocalState = &pClient->localStates[ gameState.id % LocalStateCapacity ];
+				if( pLocalState->id == gameState.id && !client_checkState( pClient, pLocalState ) && pClient->desyncTick == 0u )
+				{
+					pClient->desyncTick = gameState.id;
+				}
+
 				if( gameState.id & ServerFlagOffline )
 				{
+					SYS_PROFILE_END();
 					return 1;
 				}
 			}
@@ -97,6 +170,29 @@ int client_update( Client* pClient, uint buttonMask )
         pClient->explosionTriggered[i] |= flank;
 	}
 
+	SYS_PROFILE_END();
 	return 0;
 }
 
+int client_checkState( const Client* pClient, const ClientGameState* pLocalState )
+{
+	if( pLocalState->id != pClient->gameState.id )
+	{
+		// no authoritative snapshot for this tick
+		return TRUE;
+	}
+
+	if( statehash_compute( pLocalState ) == pClient->gameState.hash )
+	{
+		return TRUE;
+	}
+
+	SYS_TRACE_WARNING( "desync at tick %u!\n", pLocalState->id );
+	statehash_diff( &pClient->gameState, pLocalState );
+	return FALSE;
+}
+
+void client_addLocalState( Client* pClient, const ClientGameState* pLocalState )
+{
+	pClient->localStates[ pLocalState->id % LocalStateCapacity ] = *pLocalState;
+}
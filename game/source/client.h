@@ -4,6 +4,7 @@
 #include "types.h"
 #include "socket.h"
 #include "settings.h"
+#include "spscring.h"
 
 enum
 {
@@ -56,12 +57,14 @@ typedef struct
 	uint16		age;
 	uint8		direction;
 	uint8		steer;
+	uint16		inputId;	// low bits of the ClientState id the server used for this player in this tick
 
 } ClientPlayer;
 
 typedef struct 
 {
 	uint				id;
+	uint64				hash;		// statehash_compute() of this state, set by the server
 
 	ClientPlayer		player[ MaxPlayer ];
 	ClientBomb			bombs[ MaxBombs ];
@@ -85,21 +88,52 @@ typedef struct
 
 } ClientState;
 
+enum
+{
+	LocalInputCapacity		= 16u,
+	LocalSnapshotCapacity	= 8u,
+	LocalStateCapacity		= 8u
+};
+
+// replaces the socket between a client and a server thread in the same process (the host's own player).
+// the client thread pushes inputs and pops snapshots, the server thread the other way round
+typedef struct
+{
+	SpscRing			inputs;
+	SpscRing			snapshots;
+	ClientState			inputBuffer[ LocalInputCapacity ];
+	ClientGameState		snapshotBuffer[ LocalSnapshotCapacity ];
+} LocalConnection;
+
+void	localconnection_init( LocalConnection* pConnection );
+
 typedef struct 
 {
 	Socket			socket;
 	IP4Address		serverAddress;
+	LocalConnection*	pConnection;		// used instead of the socket if set
 
 	int				explosionActive[ MaxExplosions ];
     int             explosionTriggered[ MaxExplosions ];
 	ClientGameState	gameState;
 
+	// locally simulated states (prediction or replay) by tick, checked against the snapshot of the same tick:
+	ClientGameState	localStates[ LocalStateCapacity ];
+	uint			desyncTick;		// the first tick whose local state didn't match its snapshot, 0 if all did
+
 	ClientState		state;
 
 } Client;
 
 void	client_create( Client* pClient, const IP4Address* pServerAddress, const char* pName );
+void	client_createLocal( Client* pClient, LocalConnection* pConnection, const char* pName );
 void	client_destroy( Client* pClient );
 int		client_update( Client* pClient, uint buttonMask );
 
+// compares a locally simulated state (prediction or replay) against the authoritative snapshot of the same tick
+int		client_checkState( const Client* pClient, const ClientGameState* pLocalState );
+
+// keeps the state until the snapshot of its tick arrives, client_update checks it then
+void	client_addLocalState( Client* pClient, const ClientGameState* pLocalState );
+
 #endif
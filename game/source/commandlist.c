@@ -0,0 +1,284 @@
+#include "commandlist.h"
+#include "vector.h"
+#include "debug.h"
+#include "profile.h"
+
+#include <string.h>
+
+enum
+{
+    // the key from the most to the least significant bits:
+    SortKeyPassShift = 60u,
+    SortKeyTargetShift = 52u,
+    SortKeyLayerShift = 44u,
+    SortKeyShaderShift = 36u,
+    SortKeyBlendShift = 32u,
+    SortKeyTexturesShift = 24u,
+    SortKeyIdMask = 0xffu,
+    SortKeyDigitBits = 8u,
+    SortKeyDigitCount = 1u << SortKeyDigitBits
+};
+
+void commandlist_init( CommandList* pList )
+{
+    pList->commandCount = 0u;
+}
+
+RenderCommand* commandlist_add( CommandList* pList, RenderCommandType type, uint pass, uint layer, RenderTarget* pTarget, Shader* pShader, BlendMode blendMode )
+{
+    SYS_ASSERT( pass < MaxRenderPasses );
+    SYS_ASSERT( layer < MaxRenderLayers );
+
+    if( pList->commandCount >= MaxRenderCommands )
+    {
+        // everything recorded so far comes first anyway:
+        SYS_TRACE_WARNING( "render command list is full, submitting early\n" );
+        commandlist_submit( pList );
+    }
+
+    RenderCommand* pCommand = &pList->commands[ pList->commandCount++ ];
+    pCommand->type = type;
+    pCommand->pass = pass;
+    pCommand->layer = layer;
+    pCommand->pTarget = pTarget;
+    pCommand->pShader = pShader;
+    pCommand->blendMode = blendMode;
+    pCommand->textureCount = 0u;
+    pCommand->vpMask = 0u;
+    pCommand->fpMask = 0u;
+    return pCommand;
+}
+
+void rendercommand_setTexture( RenderCommand* pCommand, uint index, uint textureId, SamplerState sampler )
+{
+    SYS_ASSERT( index < MaxFSTextureCount );
+    for( uint i = pCommand->textureCount; i < index; ++i )
+    {
+        pCommand->textureIds[ i ] = 0u;
+        pCommand->samplers[ i ] = SamplerState_ClampU_ClampV_Nearest;
+    }
+    pCommand->textureIds[ index ] = textureId;
+    pCommand->samplers[ index ] = sampler;
+    if( index >= pCommand->textureCount )
+    {
+        pCommand->textureCount = index + 1u;
+    }
+}
+
+void rendercommand_setVp4f( RenderCommand* pCommand, uint index, float x, float y, float z, float w )
+{
+    SYS_ASSERT( index < MaxVSUniformCount );
+    float4_set( &pCommand->vp[ index ], x, y, z, w );
+    pCommand->vpMask |= 1u << index;
+}
+
+void rendercommand_setFp4f( RenderCommand* pCommand, uint index, float x, float y, float z, float w )
+{
+    SYS_ASSERT( index < MaxFSUniformCount );
+    float4_set( &pCommand->fp[ index ], x, y, z, w );
+    pCommand->fpMask |= 1u << index;
+}
+
+// small ids in the order of first use, so equal states get equal key bits
+static uint getPointerId( const void** ppPointers, uint* pCount, const void* pPointer )
+{
+    for( uint i = 0u; i < *pCount; ++i )
+    {
+        if( ppPointers[ i ] == pPointer )
+        {
+            return i;
+        }
+    }
+    SYS_ASSERT( *pCount <= SortKeyIdMask );
+    ppPointers[ *pCount ] = pPointer;
+    return ( *pCount )++;
+}
+
+static int hasSameTextures( const RenderCommand* pCommand0, const RenderCommand* pCommand1 )
+{
+    if( pCommand0->textureCount != pCommand1->textureCount )
+    {
+        return FALSE;
+    }
+    for( uint i = 0u; i < pCommand0->textureCount; ++i )
+    {
+        if( pCommand0->textureIds[ i ] != pCommand1->textureIds[ i ] || pCommand0->samplers[ i ] != pCommand1->samplers[ i ] )
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void buildKeys( CommandList* pList )
+{
+    const void* targets[ MaxRenderCommands ];
+    const void* shaders[ MaxRenderCommands ];
+    uint textureSetIds[ MaxRenderCommands ];
+    uint targetCount = 0u;
+    uint shaderCount = 0u;
+    uint textureSetCount = 0u;
+
+    for( uint i = 0u; i < pList->commandCount; ++i )
+    {
+        const RenderCommand* pCommand = &pList->commands[ i ];
+
+        textureSetIds[ i ] = textureSetCount;
+        for( uint j = 0u; j < i; ++j )
+        {
+            if( hasSameTextures( pCommand, &pList->commands[ j ] ) )
+            {
+                textureSetIds[ i ] = textureSetIds[ j ];
+                break;
+            }
+        }
+        if( textureSetIds[ i ] == textureSetCount )
+        {
+            textureSetCount++;
+        }
+        SYS_ASSERT( textureSetIds[ i ] <= SortKeyIdMask );
+
+        const uint64 targetId = getPointerId( targets, &targetCount, pCommand->pTarget );
+        const uint64 shaderId = getPointerId( shaders, &shaderCount, pCommand->pShader );
+
+        // the command index keeps the recorded order between commands with the same state:
+        pList->keys[ i ] =
+            ( (uint64)pCommand->pass << SortKeyPassShift ) |
+            ( targetId << SortKeyTargetShift ) |
+            ( (uint64)pCommand->layer << SortKeyLayerShift ) |
+            ( shaderId << SortKeyShaderShift ) |
+            ( (uint64)pCommand->blendMode << SortKeyBlendShift ) |
+            ( (uint64)textureSetIds[ i ] << SortKeyTexturesShift ) |
+            (uint64)i;
+        pList->order[ i ] = (uint16)i;
+    }
+}
+
+// least significant digit first radix sort. digits that are the same in all keys are skipped,
+// so a frame usually only needs a few passes. returns the sorted command indices
+static const uint16* sortKeys( CommandList* pList )
+{
+    const uint count = pList->commandCount;
+    uint64* pKeys = pList->keys;
+    uint64* pSortedKeys = pList->sortedKeys;
+    uint16* pOrder = pList->order;
+    uint16* pSortedOrder = pList->sortedOrder;
+
+    for( uint shift = 0u; shift < 64u; shift += SortKeyDigitBits )
+    {
+        uint offsets[ SortKeyDigitCount ];
+        memset( offsets, 0, sizeof( offsets ) );
+        for( uint i = 0u; i < count; ++i )
+        {
+            offsets[ ( pKeys[ i ] >> shift ) & ( SortKeyDigitCount - 1u ) ]++;
+        }
+        if( offsets[ ( pKeys[ 0u ] >> shift ) & ( SortKeyDigitCount - 1u ) ] == count )
+        {
+            continue;
+        }
+
+        uint offset = 0u;
+        for( uint i = 0u; i < SortKeyDigitCount; ++i )
+        {
+            const uint digitCount = offsets[ i ];
+            offsets[ i ] = offset;
+            offset += digitCount;
+        }
+        for( uint i = 0u; i < count; ++i )
+        {
+            const uint target = offsets[ ( pKeys[ i ] >> shift ) & ( SortKeyDigitCount - 1u ) ]++;
+            pSortedKeys[ target ] = pKeys[ i ];
+            pSortedOrder[ target ] = pOrder[ i ];
+        }
+
+        uint64* pTempKeys = pKeys;
+        pKeys = pSortedKeys;
+        pSortedKeys = pTempKeys;
+        uint16* pTempOrder = pOrder;
+        pOrder = pSortedOrder;
+        pSortedOrder = pTempOrder;
+    }
+    return pOrder;
+}
+
+static void executeCommand( const RenderCommand* pCommand )
+{
+    graphics_setRenderTarget( pCommand->pTarget );
+    if( pCommand->type == RenderCommandType_Clear )
+    {
+        const float4* pColor = &pCommand->data.clearColor;
+        graphics_clear( pColor->x, pColor->y, pColor->z, pColor->w );
+        return;
+    }
+
+    graphics_setShader( pCommand->pShader );
+    graphics_setBlendMode( pCommand->blendMode );
+    for( uint i = 0u; i < pCommand->textureCount; ++i )
+    {
+        graphics_setFsTexture( i, pCommand->textureIds[ i ], pCommand->samplers[ i ] );
+    }
+    for( uint i = 0u; i < MaxVSUniformCount; ++i )
+    {
+        if( pCommand->vpMask & ( 1u << i ) )
+        {
+            const float4* pValue = &pCommand->vp[ i ];
+            graphics_setVp4f( i, pValue->x, pValue->y, pValue->z, pValue->w );
+        }
+    }
+    for( uint i = 0u; i < MaxFSUniformCount; ++i )
+    {
+        if( pCommand->fpMask & ( 1u << i ) )
+        {
+            const float4* pValue = &pCommand->fp[ i ];
+            graphics_setFp4f( i, pValue->x, pValue->y, pValue->z, pValue->w );
+        }
+    }
+
+    const RenderCommandData* pData = &pCommand->data;
+    switch( pCommand->type )
+    {
+    case RenderCommandType_Quad:
+        graphics_drawQuad( pData->quad.vertices, pData->quad.uv0.x, pData->quad.uv0.y, pData->quad.uv1.x, pData->quad.uv1.y );
+        break;
+
+    case RenderCommandType_Circle:
+        graphics_drawCircle( &pData->circle.pos, pData->circle.radius );
+        break;
+
+    case RenderCommandType_FullscreenQuad:
+        graphics_drawFullscreenQuad();
+        break;
+
+    case RenderCommandType_StrokeMesh:
+        graphics_drawStrokeMesh( pData->strokeMesh.pMesh, pData->strokeMesh.firstIndex, pData->strokeMesh.indexCount );
+        break;
+
+    case RenderCommandType_Mesh2d:
+        graphics_drawMesh2d( pData->pMesh2d );
+        break;
+
+    default:
+        SYS_BREAK( "Invalid render command!\n" );
+        break;
+    }
+}
+
+void commandlist_submit( CommandList* pList )
+{
+    if( pList->commandCount == 0u )
+    {
+        return;
+    }
+
+    SYS_PROFILE_BEGIN( "commandlist_submit" );
+
+    buildKeys( pList );
+    const uint16* pOrder = sortKeys( pList );
+
+    for( uint i = 0u; i < pList->commandCount; ++i )
+    {
+        executeCommand( &pList->commands[ pOrder[ i ] ] );
+    }
+    pList->commandCount = 0u;
+    SYS_PROFILE_END();
+}
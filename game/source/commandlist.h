@@ -0,0 +1,101 @@
+#ifndef COMMANDLIST_H_INCLUDED
+#define COMMANDLIST_H_INCLUDED
+
+#include "types.h"
+#include "graphics.h"
+
+enum
+{
+    MaxRenderCommands = 256u,
+    MaxRenderPasses = 16u,      // passes are submitted in order, a pass reads what the earlier ones rendered
+    MaxRenderLayers = 256u      // layers of a target are drawn in order (painter's order)
+};
+
+typedef enum
+{
+    RenderCommandType_Clear,
+    RenderCommandType_Quad,
+    RenderCommandType_Circle,
+    RenderCommandType_FullscreenQuad,
+    RenderCommandType_StrokeMesh,
+    RenderCommandType_Mesh2d,
+    RenderCommandType_Count
+} RenderCommandType;
+
+typedef struct
+{
+    float2      vertices[ 4u ];
+    float2      uv0;
+    float2      uv1;
+} RenderQuadData;
+
+typedef struct
+{
+    float2      pos;
+    float       radius;
+} RenderCircleData;
+
+typedef struct
+{
+    const StrokeMesh*   pMesh;
+    uint                firstIndex;
+    uint                indexCount;
+} RenderStrokeMeshData;
+
+typedef union
+{
+    float4                  clearColor;
+    RenderQuadData          quad;
+    RenderCircleData        circle;
+    RenderStrokeMeshData    strokeMesh;
+    const Mesh2d*           pMesh2d;
+} RenderCommandData;
+
+// one draw with all the state it needs. clears only use the target
+typedef struct
+{
+    RenderCommandType   type;
+    uint                pass;
+    uint                layer;
+    RenderTarget*       pTarget;
+    Shader*             pShader;
+    BlendMode           blendMode;
+
+    uint                textureCount;
+    uint                textureIds[ MaxFSTextureCount ];
+    SamplerState        samplers[ MaxFSTextureCount ];
+
+    uint                vpMask;     // bit i is set if vp[ i ] is used
+    uint                fpMask;
+    float4              vp[ MaxVSUniformCount ];
+    float4              fp[ MaxFSUniformCount ];
+
+    RenderCommandData   data;
+} RenderCommand;
+
+// the draws of a frame are recorded here and submitted grouped by pass, target, layer, shader, blend mode and textures.
+// commands with the same key stay in the order they were recorded
+typedef struct
+{
+    RenderCommand   commands[ MaxRenderCommands ];
+    uint            commandCount;
+
+    uint64          keys[ MaxRenderCommands ];
+    uint64          sortedKeys[ MaxRenderCommands ];
+    uint16          order[ MaxRenderCommands ];
+    uint16          sortedOrder[ MaxRenderCommands ];
+} CommandList;
+
+void commandlist_init( CommandList* pList );
+
+// submits the list first if it is full. the returned command has no textures or uniforms yet
+RenderCommand* commandlist_add( CommandList* pList, RenderCommandType type, uint pass, uint layer, RenderTarget* pTarget, Shader* pShader, BlendMode blendMode );
+
+void rendercommand_setTexture( RenderCommand* pCommand, uint index, uint textureId, SamplerState sampler );
+void rendercommand_setVp4f( RenderCommand* pCommand, uint index, float x, float y, float z, float w );
+void rendercommand_setFp4f( RenderCommand* pCommand, uint index, float x, float y, float z, float w );
+
+// sorts and draws all recorded commands and empties the list
+void commandlist_submit( CommandList* pList );
+
+#endif
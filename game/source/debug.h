@@ -16,13 +16,28 @@ enum
     TraceLevel_Debug        = 100
 };
 
-void sys_trace( const char* pFormat, ... );
+// SYS_TRACE_* calls are formatted into a lock free ring and written by a background thread (see trace.h).
+// every call site writes at most TraceSiteMaxMessageCount messages per window, the rest is counted and dropped
+enum
+{
+    TraceSiteMaxMessageCount    = 20u,
+    TraceSiteWindowShift        = 30u       // 2^30ns, about a second
+};
+
+typedef struct
+{
+    volatile uint32     window;
+    volatile uint32     messageCount;
+} TraceSite;
+
+void sys_trace( TraceSite* pSite, int level, const char* pFormat, ... );
 
-#   define SYS_TRACE_EMERGENCY  sys_trace
-#   define SYS_TRACE_ERROR		sys_trace
-#   define SYS_TRACE_WARNING	sys_trace
-#   define SYS_TRACE_INFO		sys_trace
-#   define SYS_TRACE_DEBUG		sys_trace
+#   define SYS_TRACE_AT( level, ... )   do { static TraceSite s_traceSite; sys_trace( &s_traceSite, level, __VA_ARGS__ ); } while( 0 )
+#   define SYS_TRACE_EMERGENCY(...)     SYS_TRACE_AT( TraceLevel_Emergency, __VA_ARGS__ )
+#   define SYS_TRACE_ERROR(...)         SYS_TRACE_AT( TraceLevel_Error, __VA_ARGS__ )
+#   define SYS_TRACE_WARNING(...)       SYS_TRACE_AT( TraceLevel_Warning, __VA_ARGS__ )
+#   define SYS_TRACE_INFO(...)          SYS_TRACE_AT( TraceLevel_Info, __VA_ARGS__ )
+#   define SYS_TRACE_DEBUG(...)         SYS_TRACE_AT( TraceLevel_Debug, __VA_ARGS__ )
 #else
 #   ifdef _MSC_VER
 #      define SYS_TRACE_EMERGENCY	__noop
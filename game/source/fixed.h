@@ -0,0 +1,178 @@
+#ifndef FIXED_H_INCLUDED
+#define FIXED_H_INCLUDED
+
+#include "types.h"
+
+// q16.16 fixed point math. only integer operations (and exact float conversions for values below 256) are
+// used, so the results are the same on every compiler and platform
+typedef int32 fixed;
+
+typedef struct
+{
+	fixed	x, y;
+} fixed2;
+
+enum
+{
+	FixedShift		= 16,
+	FixedOne		= 1 << FixedShift,
+	FixedHalf		= 1 << ( FixedShift - 1 ),
+	FixedHalfPi		= 102944,
+	FixedPi			= 205887,
+	FixedTwoPi		= 411775
+};
+
+fixed	fixed_sin( fixed angle );
+fixed	fixed_cos( fixed angle );
+fixed	fixed_sqrt( fixed value );
+
+static inline fixed fixed_fromFloat( float value )
+{
+	return (fixed)floorf( value * (float)FixedOne + 0.5f );
+}
+
+static inline float fixed_toFloat( fixed value )
+{
+	return (float)value * ( 1.0f / (float)FixedOne );
+}
+
+static inline fixed fixed_mul( fixed a, fixed b )
+{
+	return (fixed)( ( (int64)a * (int64)b + FixedHalf ) >> FixedShift );
+}
+
+static inline fixed fixed_div( fixed a, fixed b )
+{
+	return (fixed)( (int64)a * FixedOne / b );
+}
+
+static inline fixed fixed_abs( fixed value )
+{
+	return value < 0 ? -value : value;
+}
+
+static inline fixed fixed_min( fixed a, fixed b )
+{
+	return a < b ? a : b;
+}
+
+static inline fixed fixed_max( fixed a, fixed b )
+{
+	return a > b ? a : b;
+}
+
+static inline fixed fixed_clamp( fixed value, fixed min, fixed max )
+{
+	return fixed_min( fixed_max( value, min ), max );
+}
+
+static inline fixed fixed_normalizeAngle( fixed angle )
+{
+	// keeps the angle in [-pi,pi) so it can't overflow over a long game:
+	angle %= FixedTwoPi;
+	if( angle >= FixedPi )
+	{
+		angle -= FixedTwoPi;
+	}
+	else if( angle < -FixedPi )
+	{
+		angle += FixedTwoPi;
+	}
+	return angle;
+}
+
+static inline fixed2* fixed2_set( fixed2* pTarget, fixed x, fixed y )
+{
+	pTarget->x = x;
+	pTarget->y = y;
+	return pTarget;
+}
+
+static inline fixed2* fixed2_fromFloat2( fixed2* pTarget, const float2* pSource )
+{
+	pTarget->x = fixed_fromFloat( pSource->x );
+	pTarget->y = fixed_fromFloat( pSource->y );
+	return pTarget;
+}
+
+static inline float2* fixed2_toFloat2( float2* pTarget, const fixed2* pSource )
+{
+	pTarget->x = fixed_toFloat( pSource->x );
+	pTarget->y = fixed_toFloat( pSource->y );
+	return pTarget;
+}
+
+static inline fixed2* fixed2_add( fixed2* pResult, const fixed2* pA, const fixed2* pB )
+{
+	pResult->x = pA->x + pB->x;
+	pResult->y = pA->y + pB->y;
+	return pResult;
+}
+
+static inline fixed2* fixed2_sub( fixed2* pResult, const fixed2* pA, const fixed2* pB )
+{
+	pResult->x = pA->x - pB->x;
+	pResult->y = pA->y - pB->y;
+	return pResult;
+}
+
+static inline fixed2* fixed2_scale1f( fixed2* pResult, const fixed2* pA, fixed factor )
+{
+	pResult->x = fixed_mul( pA->x, factor );
+	pResult->y = fixed_mul( pA->y, factor );
+	return pResult;
+}
+
+static inline fixed2* fixed2_addScaled1f( fixed2* pResult, const fixed2* pA, const fixed2* pB, fixed factor )
+{
+	pResult->x = pA->x + fixed_mul( pB->x, factor );
+	pResult->y = pA->y + fixed_mul( pB->y, factor );
+	return pResult;
+}
+
+static inline fixed fixed2_dot( const fixed2* pA, const fixed2* pB )
+{
+	return (fixed)( ( (int64)pA->x * pB->x + (int64)pA->y * pB->y + FixedHalf ) >> FixedShift );
+}
+
+static inline fixed fixed2_length( const fixed2* pA )
+{
+	return fixed_sqrt( fixed2_dot( pA, pA ) );
+}
+
+static inline fixed2* fixed2_normalize0( fixed2* pValue )
+{
+	const fixed length = fixed2_length( pValue );
+	if( length == 0 )
+	{
+		fixed2_set( pValue, 0, 0 );
+	}
+	else
+	{
+		pValue->x = fixed_div( pValue->x, length );
+		pValue->y = fixed_div( pValue->y, length );
+	}
+	return pValue;
+}
+
+static inline fixed2* fixed2_fromAngle( fixed2* pTarget, fixed angle )
+{
+	pTarget->x = fixed_cos( angle );
+	pTarget->y = fixed_sin( angle );
+	return pTarget;
+}
+
+static inline fixed2* fixed2_rotate( fixed2* pValue, fixed angle )
+{
+	const fixed sinAngle = fixed_sin( angle );
+	const fixed cosAngle = fixed_cos( angle );
+
+	const fixed newX = fixed_mul( pValue->x, cosAngle ) - fixed_mul( pValue->y, sinAngle );
+	const fixed newY = fixed_mul( pValue->y, cosAngle ) + fixed_mul( pValue->x, sinAngle );
+
+	pValue->x = newX;
+	pValue->y = newY;
+	return pValue;
+}
+
+#endif
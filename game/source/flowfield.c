@@ -0,0 +1,414 @@
+#include "flowfield.h"
+#include "geometry.h"
+#include "vector.h"
+#include "debug.h"
+
+#include <string.h>
+
+enum
+{
+	FlowFieldStraightCost	= 2u,
+	FlowFieldDiagonalCost	= 3u,
+	FlowFieldBombCost		= 24u,
+	FlowFieldExplosionCost	= 96u
+};
+
+static const int s_flowFieldOffsets[ 8u ][ 2u ] =
+{
+	{  1,  0 }, {  1,  1 }, {  0,  1 }, { -1,  1 },
+	{ -1,  0 }, { -1, -1 }, {  0, -1 }, {  1, -1 }
+};
+
+static const float2 s_flowFieldDirections[ 8u ] =
+{
+	{  1.0f,  0.0f }, {  0.70710678f,  0.70710678f }, {  0.0f,  1.0f }, { -0.70710678f,  0.70710678f },
+	{ -1.0f,  0.0f }, { -0.70710678f, -0.70710678f }, {  0.0f, -1.0f }, {  0.70710678f, -0.70710678f }
+};
+
+static uint flowfield_getCell( const FlowField* pField, const float2* pPosition )
+{
+	const int x = int_clamp( (int)( ( pPosition->x - pField->gridMin.x ) * pField->invCellSize.x ), 0, FlowFieldGridSize - 1 );
+	const int y = int_clamp( (int)( ( pPosition->y - pField->gridMin.y ) * pField->invCellSize.y ), 0, FlowFieldGridSize - 1 );
+	return (uint)y * FlowFieldGridSize + (uint)x;
+}
+
+void flowfield_init( FlowField* pField, const World* pWorld )
+{
+	memset( pField, 0, sizeof( *pField ) );
+
+	pField->gridMin = pWorld->borderMin;
+	float2_sub( &pField->cellSize, &pWorld->borderMax, &pWorld->borderMin );
+	float2_scale1f( &pField->cellSize, &pField->cellSize, 1.0f / (float)FlowFieldGridSize );
+	float2_set( &pField->invCellSize, 1.0f / pField->cellSize.x, 1.0f / pField->cellSize.y );
+
+	// the world already knows which cells have room for a car:
+	memset( pField->isBlocked, 1, sizeof( pField->isBlocked ) );
+	for( uint i = 0u; i < pWorld->freeCellCount; ++i )
+	{
+		pField->isBlocked[ flowfield_getCell( pField, &pWorld->freeCells[ i ] ) ] = 0u;
+	}
+
+	// nothing is dangerous and there is no goal yet, the first update builds the field:
+	for( uint i = 0u; i < FlowFieldCellCount; ++i )
+	{
+		pField->distance[ i ]	= 0xffffffffu;
+		pField->direction[ i ]	= FlowFieldNoDirection;
+		pField->parent[ i ]		= FlowFieldNoDirection;
+	}
+}
+
+// adds cost to all cells a car on the line would be hit in
+static void flowfield_addLineCost( FlowField* pField, const float2* pStart, const float2* pEnd, uint cost )
+{
+	const float margin = s_carRadius + s_explosionRadius;
+
+	Line line;
+	line.a = *pStart;
+	line.b = *pEnd;
+
+	const int minX = int_clamp( (int)( ( float_min( pStart->x, pEnd->x ) - margin - pField->gridMin.x ) * pField->invCellSize.x ), 0, FlowFieldGridSize - 1 );
+	const int minY = int_clamp( (int)( ( float_min( pStart->y, pEnd->y ) - margin - pField->gridMin.y ) * pField->invCellSize.y ), 0, FlowFieldGridSize - 1 );
+	const int maxX = int_clamp( (int)( ( float_max( pStart->x, pEnd->x ) + margin - pField->gridMin.x ) * pField->invCellSize.x ), 0, FlowFieldGridSize - 1 );
+	const int maxY = int_clamp( (int)( ( float_max( pStart->y, pEnd->y ) + margin - pField->gridMin.y ) * pField->invCellSize.y ), 0, FlowFieldGridSize - 1 );
+
+	for( int y = minY; y <= maxY; ++y )
+	{
+		for( int x = minX; x <= maxX; ++x )
+		{
+			float2 center;
+			float2_set( &center, pField->gridMin.x + ( (float)x + 0.5f ) * pField->cellSize.x, pField->gridMin.y + ( (float)y + 0.5f ) * pField->cellSize.y );
+
+			float2 closestPoint;
+			getLineClosestPoint( &closestPoint, &line, &center );
+			if( float2_squareDistance( &closestPoint, &center ) < margin * margin )
+			{
+				uint8* pCost = &pField->nextDangerCost[ (uint)y * FlowFieldGridSize + (uint)x ];
+				*pCost = (uint8)uint_min( *pCost + cost, 0xffu );
+			}
+		}
+	}
+}
+
+static void flowfield_addCrossCost( FlowField* pField, int16 posX, int16 posY, uint8 direction, const uint8* pArmLengths, uint cost )
+{
+	float2 center;
+	float2_set( &center, float_unquantize( posX ), float_unquantize( posY ) );
+
+	for( uint i = 0u; i < 4u; ++i )
+	{
+		float2 arm;
+		float2_from_angle( &arm, angle_unquantize( direction ) + (float)i * PI * 0.5f );
+
+		float2 end;
+		float2_addScaled1f( &end, &center, &arm, (float)pArmLengths[ i ] );
+		flowfield_addLineCost( pField, &center, &end, cost );
+	}
+}
+
+static void flowfield_pushHeap( FlowField* pField, uint* pHeapSize, uint32 entry )
+{
+	SYS_ASSERT( *pHeapSize < FlowFieldHeapSize );
+	uint index = ( *pHeapSize )++;
+	while( index > 0u )
+	{
+		const uint parent = ( index - 1u ) / 2u;
+		if( pField->heap[ parent ] <= entry )
+		{
+			break;
+		}
+		pField->heap[ index ] = pField->heap[ parent ];
+		index = parent;
+	}
+	pField->heap[ index ] = entry;
+}
+
+static uint32 flowfield_popHeap( FlowField* pField, uint* pHeapSize )
+{
+	const uint32 result = pField->heap[ 0u ];
+	const uint32 entry = pField->heap[ --( *pHeapSize ) ];
+
+	uint index = 0u;
+	for( ;; )
+	{
+		uint child = 2u * index + 1u;
+		if( child >= *pHeapSize )
+		{
+			break;
+		}
+		if( child + 1u < *pHeapSize && pField->heap[ child + 1u ] < pField->heap[ child ] )
+		{
+			child++;
+		}
+		if( entry <= pField->heap[ child ] )
+		{
+			break;
+		}
+		pField->heap[ index ] = pField->heap[ child ];
+		index = child;
+	}
+	pField->heap[ index ] = entry;
+	return result;
+}
+
+static int flowfield_getNeighbour( const FlowField* pField, uint cell, uint direction )
+{
+	const int x = (int)( cell % FlowFieldGridSize ) + s_flowFieldOffsets[ direction ][ 0u ];
+	const int y = (int)( cell / FlowFieldGridSize ) + s_flowFieldOffsets[ direction ][ 1u ];
+	if( x < 0 || y < 0 || x >= (int)FlowFieldGridSize || y >= (int)FlowFieldGridSize )
+	{
+		return -1;
+	}
+
+	// diagonal steps don't cut the corners of blocked cells:
+	if( ( direction & 1u ) != 0u &&
+		( pField->isBlocked[ cell / FlowFieldGridSize * FlowFieldGridSize + (uint)x ] || pField->isBlocked[ (uint)y * FlowFieldGridSize + cell % FlowFieldGridSize ] ) )
+	{
+		return -1;
+	}
+	return y * (int)FlowFieldGridSize + x;
+}
+
+static uint flowfield_getStepCost( uint direction )
+{
+	return ( direction & 1u ) != 0u ? FlowFieldDiagonalCost : FlowFieldStraightCost;
+}
+
+static uint flowfield_getOppositeDirection( uint direction )
+{
+	return ( direction + 4u ) & 7u;
+}
+
+static void flowfield_markChanged( FlowField* pField, uint* pChangedCount, uint cell )
+{
+	if( !pField->isChanged[ cell ] )
+	{
+		pField->isChanged[ cell ] = 1u;
+		pField->changedCells[ ( *pChangedCount )++ ] = (uint16)cell;
+	}
+}
+
+// the distance of a cell with changed danger or goal and of every cell whose shortest way leads over it can't be trusted
+// anymore. these are the first entries of changedCells, returns their count
+static uint flowfield_invalidate( FlowField* pField )
+{
+	uint count = 0u;
+	for( uint i = 0u; i < FlowFieldCellCount; ++i )
+	{
+		if( pField->nextDangerCost[ i ] != pField->dangerCost[ i ] || pField->nextIsGoal[ i ] != pField->isGoal[ i ] )
+		{
+			flowfield_markChanged( pField, &count, i );
+		}
+	}
+
+	// the parents are still the ones of the old costs, so this finds all ways over the changed cells:
+	for( uint i = 0u; i < count; ++i )
+	{
+		const uint cell = pField->changedCells[ i ];
+		for( uint j = 0u; j < SYS_COUNTOF( s_flowFieldOffsets ); ++j )
+		{
+			const int neighbour = flowfield_getNeighbour( pField, cell, j );
+			if( neighbour >= 0 && pField->parent[ neighbour ] == flowfield_getOppositeDirection( j ) )
+			{
+				flowfield_markChanged( pField, &count, (uint)neighbour );
+			}
+		}
+	}
+	return count;
+}
+
+// every cell points to its closest neighbour. blocked cells too, so that a car that touches an obstacle finds its way back
+static void flowfield_updateDirection( FlowField* pField, uint cell )
+{
+	pField->direction[ cell ] = FlowFieldNoDirection;
+	if( pField->isGoal[ cell ] )
+	{
+		return;
+	}
+
+	uint32 bestDistance = pField->isBlocked[ cell ] ? 0xffffffffu : pField->distance[ cell ];
+	for( uint i = 0u; i < SYS_COUNTOF( s_flowFieldOffsets ); ++i )
+	{
+		const int neighbour = flowfield_getNeighbour( pField, cell, i );
+		if( neighbour >= 0 && pField->distance[ neighbour ] < bestDistance )
+		{
+			bestDistance				= pField->distance[ neighbour ];
+			pField->direction[ cell ]	= (uint8)i;
+		}
+	}
+}
+
+// dijkstra from all goal cells, stepping onto a cell costs its danger. heap entries are distance * FlowFieldCellCount + cell.
+// only the invalidated cells start over: they are seeded from their valid neighbours and the search only continues into
+// cells it makes shorter, so a bomb only costs the cells around it and the ways that led over them
+static void flowfield_repair( FlowField* pField )
+{
+	uint changedCount = flowfield_invalidate( pField );
+	const uint invalidCount = changedCount;
+
+	memcpy( pField->dangerCost, pField->nextDangerCost, sizeof( pField->dangerCost ) );
+	memcpy( pField->isGoal, pField->nextIsGoal, sizeof( pField->isGoal ) );
+
+	for( uint i = 0u; i < invalidCount; ++i )
+	{
+		const uint cell = pField->changedCells[ i ];
+		pField->distance[ cell ]	= 0xffffffffu;
+		pField->parent[ cell ]		= FlowFieldNoDirection;
+	}
+
+	uint heapSize = 0u;
+	for( uint i = 0u; i < invalidCount; ++i )
+	{
+		const uint cell = pField->changedCells[ i ];
+		if( pField->isGoal[ cell ] )
+		{
+			pField->distance[ cell ] = 0u;
+			flowfield_pushHeap( pField, &heapSize, cell );
+			continue;
+		}
+		if( pField->isBlocked[ cell ] )
+		{
+			continue;
+		}
+
+		for( uint j = 0u; j < SYS_COUNTOF( s_flowFieldOffsets ); ++j )
+		{
+			const int neighbour = flowfield_getNeighbour( pField, cell, j );
+			if( neighbour < 0 || pField->distance[ neighbour ] == 0xffffffffu )
+			{
+				continue;
+			}
+
+			const uint32 distance = pField->distance[ neighbour ] + flowfield_getStepCost( j ) + pField->dangerCost[ neighbour ];
+			if( distance < pField->distance[ cell ] )
+			{
+				pField->distance[ cell ]	= distance;
+				pField->parent[ cell ]		= (uint8)j;
+			}
+		}
+		if( pField->distance[ cell ] != 0xffffffffu )
+		{
+			flowfield_pushHeap( pField, &heapSize, pField->distance[ cell ] * FlowFieldCellCount + cell );
+		}
+	}
+
+	while( heapSize > 0u )
+	{
+		const uint32 entry = flowfield_popHeap( pField, &heapSize );
+		const uint cell = entry % FlowFieldCellCount;
+		const uint32 distance = entry / FlowFieldCellCount;
+		if( distance != pField->distance[ cell ] )
+		{
+			// a stale entry, the cell was reached on a shorter way since
+			continue;
+		}
+
+		for( uint i = 0u; i < SYS_COUNTOF( s_flowFieldOffsets ); ++i )
+		{
+			const int neighbour = flowfield_getNeighbour( pField, cell, i );
+			if( neighbour < 0 || pField->isBlocked[ neighbour ] )
+			{
+				continue;
+			}
+
+			const uint32 neighbourDistance = distance + flowfield_getStepCost( i ) + pField->dangerCost[ cell ];
+			if( neighbourDistance < pField->distance[ neighbour ] )
+			{
+				pField->distance[ neighbour ]	= neighbourDistance;
+				pField->parent[ neighbour ]		= (uint8)flowfield_getOppositeDirection( i );
+				flowfield_pushHeap( pField, &heapSize, neighbourDistance * FlowFieldCellCount + (uint)neighbour );
+				flowfield_markChanged( pField, &changedCount, (uint)neighbour );
+			}
+		}
+	}
+
+	// the direction of a cell depends on the distances of its neighbours:
+	for( uint i = 0u; i < changedCount; ++i )
+	{
+		const uint cell = pField->changedCells[ i ];
+		flowfield_updateDirection( pField, cell );
+		for( uint j = 0u; j < SYS_COUNTOF( s_flowFieldOffsets ); ++j )
+		{
+			const int neighbour = flowfield_getNeighbour( pField, cell, j );
+			if( neighbour >= 0 && !pField->isChanged[ neighbour ] )
+			{
+				flowfield_updateDirection( pField, (uint)neighbour );
+			}
+		}
+	}
+	for( uint i = 0u; i < changedCount; ++i )
+	{
+		pField->isChanged[ pField->changedCells[ i ] ] = 0u;
+	}
+}
+
+int flowfield_update( FlowField* pField, const ClientGameState* pState )
+{
+	memset( pField->nextDangerCost, 0, sizeof( pField->nextDangerCost ) );
+	memset( pField->nextIsGoal, 0, sizeof( pField->nextIsGoal ) );
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->bombs ); ++i )
+	{
+		const ClientBomb* pBomb = &pState->bombs[ i ];
+		if( pBomb->time != 0u )
+		{
+			const uint8 armLengths[] = { pBomb->length, pBomb->length, pBomb->length, pBomb->length };
+			flowfield_addCrossCost( pField, pBomb->posX, pBomb->posY, pBomb->direction, armLengths, FlowFieldBombCost );
+		}
+	}
+	for( uint i = 0u; i < SYS_COUNTOF( pState->explosions ); ++i )
+	{
+		const ClientExplosion* pExplosion = &pState->explosions[ i ];
+		if( pExplosion->time != 0u )
+		{
+			flowfield_addCrossCost( pField, pExplosion->posX, pExplosion->posY, pExplosion->direction, pExplosion->length, FlowFieldExplosionCost );
+		}
+	}
+
+	uint goalCount = 0u;
+	for( uint i = 0u; i < SYS_COUNTOF( pState->items ); ++i )
+	{
+		const ClientItem* pItem = &pState->items[ i ];
+		if( pItem->type != ItemType_None )
+		{
+			float2 position;
+			float2_set( &position, float_unquantize( pItem->posX ), float_unquantize( pItem->posY ) );
+			pField->nextIsGoal[ flowfield_getCell( pField, &position ) ] = 1u;
+			goalCount++;
+		}
+	}
+	if( goalCount == 0u )
+	{
+		// without items every safe cell is a goal, so the field only leads out of danger:
+		for( uint i = 0u; i < FlowFieldCellCount; ++i )
+		{
+			pField->nextIsGoal[ i ] = (uint8)( !pField->isBlocked[ i ] && pField->nextDangerCost[ i ] == 0u );
+		}
+	}
+
+	// bombs don't move and items stay until they are picked up, so most ticks don't change anything:
+	if( memcmp( pField->nextDangerCost, pField->dangerCost, sizeof( pField->dangerCost ) ) == 0 &&
+		memcmp( pField->nextIsGoal, pField->isGoal, sizeof( pField->isGoal ) ) == 0 )
+	{
+		return FALSE;
+	}
+
+	flowfield_repair( pField );
+	return TRUE;
+}
+
+int flowfield_getDirection( const FlowField* pField, float2* pDirection, const float2* pPosition )
+{
+	const uint direction = pField->direction[ flowfield_getCell( pField, pPosition ) ];
+	if( direction == FlowFieldNoDirection )
+	{
+		return FALSE;
+	}
+
+	*pDirection = s_flowFieldDirections[ direction ];
+	return TRUE;
+}
+
+int flowfield_isDangerous( const FlowField* pField, const float2* pPosition )
+{
+	return pField->dangerCost[ flowfield_getCell( pField, pPosition ) ] != 0u;
+}
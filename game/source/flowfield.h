@@ -0,0 +1,51 @@
+#ifndef FLOWFIELD_H_INCLUDED
+#define FLOWFIELD_H_INCLUDED
+
+#include "types.h"
+#include "world.h"
+#include "client.h"
+
+enum
+{
+	FlowFieldGridSize		= WorldFreeGridSize,	// same cells as the free cells of the world
+	FlowFieldCellCount		= FlowFieldGridSize * FlowFieldGridSize,
+	FlowFieldHeapSize		= 9u * FlowFieldCellCount,	// every cell once plus one entry per improved neighbour
+	FlowFieldNoDirection	= 8u
+};
+
+// shortest ways from every cell of the world to the closest item (or out of danger when there are none).
+// one field is shared by all bots of a match: updating it once per tick is cheap and every bot reads its way in O(1)
+typedef struct
+{
+	float2		gridMin;
+	float2		cellSize;
+	float2		invCellSize;
+
+	uint8		isBlocked[ FlowFieldCellCount ];	// a car doesn't fit into the cell
+	uint8		dangerCost[ FlowFieldCellCount ];	// extra cost for cells on the lines of bombs and explosions
+	uint8		isGoal[ FlowFieldCellCount ];
+	uint32		distance[ FlowFieldCellCount ];
+	uint8		direction[ FlowFieldCellCount ];	// the neighbour to go to, FlowFieldNoDirection on goals
+	uint8		parent[ FlowFieldCellCount ];		// the neighbour the shortest way came from, FlowFieldNoDirection on goals
+
+	// the costs and goals of the current state. the field is only repaired where they differ from the ones above
+	uint8		nextDangerCost[ FlowFieldCellCount ];
+	uint8		nextIsGoal[ FlowFieldCellCount ];
+
+	// the cells whose distance changed in the current repair:
+	uint8		isChanged[ FlowFieldCellCount ];
+	uint16		changedCells[ FlowFieldCellCount ];
+
+	uint32		heap[ FlowFieldHeapSize ];
+} FlowField;
+
+void	flowfield_init( FlowField* pField, const World* pWorld );
+
+// returns TRUE if the state changed the dangers or goals and the field was repaired
+int		flowfield_update( FlowField* pField, const ClientGameState* pState );
+
+// writes the unit direction to drive in. returns FALSE if the position is on a goal (or nothing can be reached)
+int		flowfield_getDirection( const FlowField* pField, float2* pDirection, const float2* pPosition );
+int		flowfield_isDangerous( const FlowField* pField, const float2* pPosition );
+
+#endif
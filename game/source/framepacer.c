@@ -0,0 +1,57 @@
+#include "framepacer.h"
+#include "platform.h"
+
+enum
+{
+	FramePacerSwapWaitTime	= 500000u		// in nanoseconds, a swap that took longer waited for the display (or the gpu)
+};
+
+void framepacer_init( FramePacer* pPacer, uint frameRate )
+{
+	pPacer->frameTime		= 1000000000u / frameRate;
+	pPacer->lastSwapTime	= sys_getTime();
+	pPacer->nextFrameTime	= pPacer->lastSwapTime + pPacer->frameTime;
+}
+
+void framepacer_waitForFrame( FramePacer* pPacer )
+{
+	const uint64 currentTime = sys_getTime();
+	if( currentTime > pPacer->nextFrameTime + pPacer->frameTime )
+	{
+		pPacer->nextFrameTime = currentTime;
+	}
+	else
+	{
+		sys_sleepUntil( pPacer->nextFrameTime );
+	}
+	pPacer->nextFrameTime += pPacer->frameTime;
+}
+
+void framepacer_waitForSwap( FramePacer* pPacer, uint64 swapStartTime )
+{
+	const uint64 currentTime = sys_getTime();
+	const uint64 swapInterval = currentTime - pPacer->lastSwapTime;
+	pPacer->lastSwapTime = currentTime;
+
+	if( currentTime - swapStartTime < FramePacerSwapWaitTime )
+	{
+		// no vsync (or the frame was late for it):
+		framepacer_waitForFrame( pPacer );
+		return;
+	}
+
+	// longer intervals are missed refreshes and don't change the period:
+	if( swapInterval < pPacer->frameTime + pPacer->frameTime / 2u )
+	{
+		pPacer->frameTime = (uint64)( (int64)pPacer->frameTime + ( (int64)swapInterval - (int64)pPacer->frameTime ) / 8 );
+	}
+	pPacer->nextFrameTime = currentTime + pPacer->frameTime;
+}
+
+float framepacer_getElapsedTime( uint64* pLastTime )
+{
+	const uint64 currentTime = sys_getTime();
+	const float elapsedTime = (float)( currentTime - *pLastTime ) * 1e-9f;
+	*pLastTime = currentTime;
+	return elapsedTime;
+}
@@ -0,0 +1,28 @@
+#ifndef FRAMEPACER_H_INCLUDED
+#define FRAMEPACER_H_INCLUDED
+
+#include "types.h"
+
+// sleeps a loop to a fixed rate on the nanosecond clock instead of spinning or relying on millisecond timers
+typedef struct
+{
+	uint64	frameTime;			// in nanoseconds
+	uint64	nextFrameTime;
+	uint64	lastSwapTime;
+} FramePacer;
+
+void	framepacer_init( FramePacer* pPacer, uint frameRate );
+
+// sleeps until the next frame starts. a loop that missed a whole frame starts over from now instead of running the
+// missed frames back to back
+void	framepacer_waitForFrame( FramePacer* pPacer );
+
+// for loops that end in a buffer swap, call it right after the swap. a swap that waited for vsync already paced the loop,
+// so there is no sleep then: a second clock on top of the display would drift against it and cap faster displays.
+// the frame time follows the measured swap intervals, the rate of framepacer_init is only used until a swap waited
+void	framepacer_waitForSwap( FramePacer* pPacer, uint64 swapStartTime );
+
+// the time between two calls in seconds, without millisecond quantization
+float	framepacer_getElapsedTime( uint64* pLastTime );
+
+#endif
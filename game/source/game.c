@@ -7,19 +7,58 @@
 #include "input.h"
 #include "vector.h"
 #include "world.h"
+#include "level.h"
 #include "server.h"
 #include "client.h"
+#include "platform.h"
+#include "atomic.h"
+#include "triplebuffer.h"
+#include "replay.h"
+#include "profile.h"
 
 #include <string.h>
 #include <memory.h>
 #include <stdio.h>
 
+#ifndef SYS_BUILD_MASTER
+//#   define LEVEL_EXPORT     // writes the built in arena to s_arenaLevelFileName
+#endif
+
+enum
+{
+	MaxServerLateTicks	= 5u,
+	MaxUpdateSteps		= 4u		// per game_update, a longer hitch drops the rest instead of running ever more steps
+};
+
 enum 
 {
 	GameState_Menu,
 	GameState_Play
 };
 
+// everything the render thread needs from one game update
+typedef struct
+{
+	int					state;
+	float				drawSpeed;
+	float				variance;
+	float				interpolation;		// time since the last client update in GAMETIMESTEPs (0..1)
+	uint64				publishTime;		// sys_getTime()
+	uint32				explosionCounts[ MaxExplosions ];	// counts the explosions that started in each slot
+	ClientGameState		gameState;
+	ClientGameState		previousGameState;	// before the last client update, the cars are interpolated from it
+} GameRenderState;
+
+// owned by the render thread
+typedef struct
+{
+	int					state;
+	float				drawSpeed;
+	float				variance;
+	uint32				explosionCounts[ MaxExplosions ];	// of the burn holes that were drawn
+	GameRenderTimings	timings;
+} GameRenderer;
+
 typedef struct
 {
     float		renderTime;
@@ -31,19 +70,71 @@ typedef struct
 
     uint32      debugLastButtonMask;
 
-	World		world;
+	World			arenaWorld;		// built in, used when there is no level file
+	const World*	pWorld;
+	float2x3		worldTransform;
 
 	char		playerName[ 12u ];
 	char		serverIP[ 16u ];
 	int			state;
 	int			isServer;
 
-	Client		client;
-	Server		server;
+	Client			client;
+	ClientGameState	previousGameState;
+
+	// the host runs the server on its own thread, only that thread touches the server:
+	Server				server;
+	LocalConnection		localConnection;
+	ThreadHandle		serverThread;
+	volatile uint32		stopServer;
+
+	// the update publishes its results here, the render thread takes the newest:
+	GameRenderState		renderStates[ TripleBufferSlotCount ];
+	TripleBuffer		renderBuffer;
+	uint32				explosionCounts[ MaxExplosions ];
+
+	// the next match is recorded if there is a file name. a replay plays instead of a match:
+	char				recordFileName[ 64u ];
+	ReplayRecorder		recorder;
+	Replay				replay;
+	ReplayCheck			replayCheck;
+	uint				replayTick;
+	uint				replayDesyncTick;
+	int					isReplaying;
 
 } Game;
 
 static Game s_game;
+static GameRenderer s_gameRenderer;
+
+// ticks on its own clock, so hitches of the render loop don't stall the simulation or make it run ticks back to back
+static void game_serverThread( void* pArgument )
+{
+	SYS_USE_ARGUMENT( pArgument );
+	SYS_PROFILE_THREAD_NAME( "server" );
+
+	// created on this thread because the socket backend state is per thread:
+	server_create( &s_game.server, NetworkPort, ServerTickRate );
+	server_setLocalConnection( &s_game.server, &s_game.localConnection );
+
+	const uint64 tickTime = 1000000000u / ServerTickRate;
+	uint64 nextTickTime = sys_getTime();
+	while( !atomic_loadAcquire( &s_game.stopServer ) )
+	{
+		server_update( &s_game.server, s_game.pWorld );
+
+		nextTickTime += tickTime;
+		const uint64 currentTime = sys_getTime();
+		if( currentTime > nextTickTime + MaxServerLateTicks * tickTime )
+		{
+			// the thread didn't run for a long time. the missed ticks are dropped instead of being caught up
+			nextTickTime = currentTime;
+		}
+		sys_sleepUntil( nextTickTime );
+	}
+
+	server_destroy( &s_game.server );
+}
 
 static void game_switch_state( int state )
 {
@@ -51,49 +142,85 @@ static void game_switch_state( int state )
 	{
 		client_destroy( &s_game.client );
 
-		if( s_game.isServer )
+		if( s_game.isReplaying )
 		{
-			server_destroy( &s_game.server );
+			replay_unload( &s_game.replay );
+			s_game.isReplaying = FALSE;
+		}
+		else if( s_game.isServer )
+		{
+			atomic_storeRelease( &s_game.stopServer, 1u );
+			sys_joinThread( s_game.serverThread );
+		}
+
+		if( s_game.recorder.pFile )
+		{
+			SYS_TRACE_DEBUG( "recorded %u ticks\n", s_game.recorder.tickCount );
+			replay_stopRecording( &s_game.recorder );
 		}
 	}
 
 	if( state == GameState_Play )
 	{
         SYS_TRACE_DEBUG( "starting game\n" );
-		IP4Address address;
-		address.port = NetworkPort;
 
-		if( s_game.isServer )
+		if( s_game.recordFileName[ 0u ] != '\0' )
 		{
-			server_create( &s_game.server, NetworkPort );
+			replay_startRecording( &s_game.recorder, s_game.recordFileName );
+			s_game.recordFileName[ 0u ] = '\0';
+		}
 
-			address.address = socket_gethostIP();
+		if( s_game.isReplaying )
+		{
+			// the replay stands in for the server thread on the other end of the local connection:
+			localconnection_init( &s_game.localConnection );
+			client_createLocal( &s_game.client, &s_game.localConnection, s_game.playerName );
 		}
-		else
+		else if( s_game.isServer )
 		{
-			address.address = socket_parseIP( s_game.serverIP );
+			// the own player talks to the server thread through the local connection instead of the loopback socket:
+			localconnection_init( &s_game.localConnection );
+			s_game.stopServer	= 0u;
+			s_game.serverThread	= sys_createThread( game_serverThread, 0 );
+
+			client_createLocal( &s_game.client, &s_game.localConnection, s_game.playerName );
 		}
+		else
+		{
+			IP4Address address;
+			address.address	= socket_parseIP( s_game.serverIP );
+			address.port	= NetworkPort;
 
-		client_create( &s_game.client, &address, s_game.playerName );
+			client_create( &s_game.client, &address, s_game.playerName );
+		}
 	}
 
 	s_game.state = state;
+}
 
-    if( s_game.state == GameState_Menu )
-    {
-        renderer_setDrawSpeed(0.0f);
-        
-        renderer_setPen( Pen_Fat );
-        float2 position;
-        float2_set(&position,20.0f,10.0f);
+// hands the recorded snapshot of the next tick to the client and the simulated one to check it against.
+// returns FALSE at the end of the replay
+static int game_replayTick()
+{
+	if( s_game.replayTick >= s_game.replay.tickCount )
+	{
+		return FALSE;
+	}
 
-        font_drawText(&position,1.0f,0.1f,"PAPERb0mb!" );
-        //font_draw( 
-    }
-    else
-    {
-        renderer_setDrawSpeed(1.0f);
-    }
+	// the inputs of the client go nowhere, the check simulates the recorded ones:
+	ClientState input;
+	while( spscring_pop( &s_game.localConnection.inputs, &input ) )
+	{
+	}
+
+	ClientGameState simulatedState;
+	if( replaycheck_tick( &s_game.replayCheck, &simulatedState, &s_game.replay, s_game.replayTick, s_game.pWorld ) )
+	{
+		client_addLocalState( &s_game.client, &simulatedState );
+	}
+	spscring_push( &s_game.localConnection.snapshots, &s_game.replay.pTicks[ s_game.replayTick ].gameState );
+	s_game.replayTick++;
+	return TRUE;
 }
 
 static void debug_update( uint buttonMask, uint buttonDownMask )
@@ -113,7 +240,6 @@ static void debug_update( uint buttonMask, uint buttonDownMask )
 	{
 		s_game.drawSpeed = float_saturate( drawSpeed );
 		SYS_TRACE_DEBUG( "drawSpeed=%f\n", s_game.drawSpeed );
-        renderer_setDrawSpeed( s_game.drawSpeed );
 	}
 
 	float variance = s_game.variance;
@@ -129,20 +255,31 @@ static void debug_update( uint buttonMask, uint buttonDownMask )
 	{
 		s_game.variance = float_max( 0.0f, variance );
 		SYS_TRACE_DEBUG( "variance=%f\n", s_game.variance );
-        renderer_setVariance( s_game.variance );
 	}
 }
 
-void game_init()
+static void game_fillRenderState( GameRenderState* pRenderState )
 {
-    renderer_init();
-	font_init();
+	pRenderState->state			= s_game.state;
+	pRenderState->drawSpeed		= s_game.drawSpeed;
+	pRenderState->variance		= s_game.variance;
+	pRenderState->interpolation	= s_game.updateTime / GAMETIMESTEP;
+	pRenderState->publishTime	= sys_getTime();
+	memcpy( pRenderState->explosionCounts, s_game.explosionCounts, sizeof( pRenderState->explosionCounts ) );
+	pRenderState->gameState		= s_game.client.gameState;
+	pRenderState->previousGameState	= s_game.previousGameState;
+}
 
-	s_game.drawSpeed = 1.0f;
-    renderer_setDrawSpeed( s_game.drawSpeed );
+static void game_publishRenderState()
+{
+	game_fillRenderState( (GameRenderState*)triplebuffer_getWriteSlot( &s_game.renderBuffer ) );
+	triplebuffer_publish( &s_game.renderBuffer );
+}
 
+void game_init()
+{
+	s_game.drawSpeed = 1.0f;
 	s_game.variance = 0.05f;
-	renderer_setVariance( s_game.variance );
 
     s_game.renderTime = 0.0f;
 	s_game.updateTime = 0.0f;
@@ -155,26 +292,90 @@ void game_init()
 	copyString( s_game.serverIP, sizeof( s_game.serverIP ), "10.1.11.5" );
 	copyString( s_game.playerName, sizeof( s_game.playerName ), "Horst" );
 
-	float2_set( &s_game.world.borderMin, -20.0f, -20.0f );
-	float2_set( &s_game.world.borderMax,  20.0f,  20.0f );
+	float2x2_identity( &s_game.worldTransform.rot );
+	float2x2_scale2f( &s_game.worldTransform.rot, &s_game.worldTransform.rot, 0.7f, 0.7f );
+	float2_set( &s_game.worldTransform.pos, 32.0f, 20.0f );
+
+	level_buildArena( &s_game.arenaWorld );
 
-	float2x2_identity( &s_game.world.worldTransform.rot );
-	float2x2_scale2f( &s_game.world.worldTransform.rot, &s_game.world.worldTransform.rot, 0.7f, 0.7f );
-	float2_set( &s_game.world.worldTransform.pos, 32.0f, 20.0f );
+#ifdef LEVEL_EXPORT
+	level_write( &s_game.arenaWorld, s_arenaLevelFileName );
+#endif
 
-	float2_set( &s_game.world.rockz[ 0u ].center, -10.0f, -10.0f );
-	s_game.world.rockz[ 0u ].radius = 2.5f;
-	float2_set( &s_game.world.rockz[ 1u ].center,  10.0f, -10.0f );
-	s_game.world.rockz[ 1u ].radius = 2.5f;
-	float2_set( &s_game.world.rockz[ 2u ].center,  10.0f,  10.0f );
-	s_game.world.rockz[ 2u ].radius = 2.5f;
-	float2_set( &s_game.world.rockz[ 3u ].center, -10.0f,  10.0f );
-	s_game.world.rockz[ 3u ].radius = 2.5f;
+	s_game.pWorld = level_acquire( s_arenaLevelFileName );
+	if( !s_game.pWorld )
+	{
+		s_game.pWorld = &s_game.arenaWorld;
+	}
 
 	s_game.state = GameState_Menu;
+
+	// all slots start with the initial state, the render thread may read one before the first update:
+	for( uint i = 0u; i < SYS_COUNTOF( s_game.renderStates ); ++i )
+	{
+		game_fillRenderState( &s_game.renderStates[ i ] );
+	}
+	triplebuffer_init( &s_game.renderBuffer, s_game.renderStates, sizeof( s_game.renderStates[ 0u ] ) );
 }
 
 void game_done()
+{
+	if( s_game.pWorld != &s_game.arenaWorld )
+	{
+		level_release( s_game.pWorld );
+	}
+}
+
+void game_recordNextMatch( const char* pFileName )
+{
+	copyString( s_game.recordFileName, sizeof( s_game.recordFileName ), pFileName );
+}
+
+int game_startReplay( const char* pFileName )
+{
+	if( s_game.state == GameState_Play || !replay_load( &s_game.replay, pFileName ) )
+	{
+		return FALSE;
+	}
+
+	s_game.isReplaying			= TRUE;
+	s_game.replayTick			= 0u;
+	s_game.replayDesyncTick		= 0u;
+	replaycheck_init( &s_game.replayCheck );
+	s_game.updateTime	= 0.0f;
+	game_switch_state( GameState_Play );
+	return TRUE;
+}
+
+int game_isReplayDone()
+{
+	return !s_game.isReplaying;
+}
+
+uint game_getReplayDesyncTick()
+{
+	return s_game.replayDesyncTick;
+}
+
+const GameRenderTimings* game_getRenderTimings()
+{
+	return &s_gameRenderer.timings;
+}
+
+void game_initRender()
+{
+    renderer_init();
+	font_init();
+
+	const GameRenderState* pRenderState = (const GameRenderState*)triplebuffer_getReadSlot( &s_game.renderBuffer );
+	s_gameRenderer.state		= GameState_Menu;
+	s_gameRenderer.drawSpeed	= pRenderState->drawSpeed;
+	s_gameRenderer.variance		= pRenderState->variance;
+    renderer_setDrawSpeed( s_gameRenderer.drawSpeed );
+	renderer_setVariance( s_gameRenderer.variance );
+}
+
+void game_doneRender()
 {
     renderer_done();
 	font_done();
@@ -182,11 +383,18 @@ void game_done()
 
 void game_update( const GameInput* pInput )
 {
+    SYS_PROFILE_BEGIN( "game_update" );
+
     const float timeStep = pInput->timeStep;
 
     s_game.renderTime += timeStep;
 
-	const uint32 buttonMask = pInput->buttonMask;
+	// a replay presses the recorded buttons of the tick it plays next:
+	uint32 buttonMask = pInput->buttonMask;
+	if( s_game.isReplaying && s_game.replayTick < s_game.replay.tickCount )
+	{
+		buttonMask = s_game.replay.pTicks[ s_game.replayTick ].buttonMask;
+	}
 	const uint32 buttonDownMask = buttonMask & ~s_game.debugLastButtonMask;
 	s_game.debugLastButtonMask = buttonMask;
 
@@ -212,20 +420,39 @@ void game_update( const GameInput* pInput )
 		case GameState_Play:
 			{
 				int quit = 0;
-				s_game.updateTime += timeStep;
+				s_game.updateTime = float_min( s_game.updateTime + timeStep, (float)MaxUpdateSteps * GAMETIMESTEP );
 
 				while( s_game.updateTime >= GAMETIMESTEP )
 				{
+					if( s_game.isReplaying && !game_replayTick() )
+					{
+						quit = 1;
+						break;
+					}
+
+					s_game.previousGameState = s_game.client.gameState;
 					quit |= client_update( &s_game.client, buttonMask & Button_PlayerMask );
-					if( s_game.isServer )
+					if( s_game.isReplaying && s_game.client.desyncTick != 0u )
 					{
-						server_update( &s_game.server, &s_game.world );
+						s_game.replayDesyncTick = s_game.client.desyncTick;
+						quit = 1;
+						break;
 					}
+					replay_recordTick( &s_game.recorder, buttonMask, &s_game.client.gameState );
 					sound_setEngineFrequency( ( buttonMask & ButtonMask_Up ) ? 1.0f : 0.0f );
 
 					s_game.updateTime -= GAMETIMESTEP;
 				}
 
+				for( uint i = 0u; i < SYS_COUNTOF( s_game.explosionCounts ); ++i )
+				{
+					if( s_game.client.explosionTriggered[ i ] )
+					{
+						s_game.explosionCounts[ i ]++;
+						s_game.client.explosionTriggered[ i ] = 0;
+					}
+				}
+
 				if( quit || ( buttonDownMask & ButtonMask_Leave ) )
 				{
 					game_switch_state( GameState_Menu );
@@ -236,6 +463,9 @@ void game_update( const GameInput* pInput )
 		default:
 			break;
 	}
+
+	game_publishRenderState();
+	SYS_PROFILE_END();
 }
 
 static void game_render_car( const ClientPlayer* pPlayer, const float2x3* pWorldTransform )
@@ -293,7 +523,7 @@ static void game_render_car( const ClientPlayer* pPlayer, const float2x3* pWorld
     //renderer_addStroke( steerPoints, SYS_COUNTOF( steerPoints ) );
 }
 
-static void game_render_world( const World* pWorld )
+static void game_render_world( const World* pWorld, const float2x3* pWorldTransform )
 {
 	float2 points[] =
 	{ 
@@ -304,12 +534,50 @@ static void game_render_world( const World* pWorld )
 		{  pWorld->borderMin.x, pWorld->borderMin.y },
 	};
 	
-	renderer_setTransform( &pWorld->worldTransform );
+	renderer_setTransform( pWorldTransform );
 	renderer_addLinearStroke( points, SYS_COUNTOF( points ) );
 
-	for( uint i = 0u; i < SYS_COUNTOF( pWorld->rockz ); ++i )
+	for( uint i = 0u; i < pWorld->circleCount; ++i )
+	{
+		renderer_addCircle( &pWorld->circles[ i ] );
+	}
+
+	for( uint i = 0u; i < pWorld->capsuleCount; ++i )
 	{
-		renderer_addCircle( &pWorld->rockz[ i ] );
+		const Capsule* pCapsule = &pWorld->capsules[ i ];
+
+		Circle cap;
+		cap.radius = pCapsule->radius;
+		cap.center = pCapsule->line.a;
+		renderer_addCircle( &cap );
+		cap.center = pCapsule->line.b;
+		renderer_addCircle( &cap );
+
+		float2 normal;
+		float2_sub( &normal, &pCapsule->line.b, &pCapsule->line.a );
+		float2_perpendicular( &normal, &normal );
+		float2_normalize0( &normal );
+
+		float2 side[ 2u ];
+		float2_addScaled1f( &side[ 0u ], &pCapsule->line.a, &normal, pCapsule->radius );
+		float2_addScaled1f( &side[ 1u ], &pCapsule->line.b, &normal, pCapsule->radius );
+		renderer_addLinearStroke( side, SYS_COUNTOF( side ) );
+		float2_addScaled1f( &side[ 0u ], &pCapsule->line.a, &normal, -pCapsule->radius );
+		float2_addScaled1f( &side[ 1u ], &pCapsule->line.b, &normal, -pCapsule->radius );
+		renderer_addLinearStroke( side, SYS_COUNTOF( side ) );
+	}
+
+	for( uint i = 0u; i < pWorld->polygonCount; ++i )
+	{
+		const Polygon* pPolygon = &pWorld->polygons[ i ];
+
+		float2 outline[ MaxPolygonVertices + 1u ];
+		for( uint j = 0u; j < pPolygon->vertexCount; ++j )
+		{
+			outline[ j ] = pPolygon->vertices[ j ];
+		}
+		outline[ pPolygon->vertexCount ] = pPolygon->vertices[ 0u ];
+		renderer_addLinearStroke( outline, pPolygon->vertexCount + 1u );
 	}
 }
 
@@ -431,14 +699,80 @@ static void game_render_burnhole( const ClientExplosion* pExplosion, const float
 	}
 }
 
-void game_render()
+// runs on the render thread and only sees the game through the newest published render state
+static void game_render_applyState( GameRenderer* pRenderer, const GameRenderState* pRenderState )
 {
+	if( pRenderState->drawSpeed != pRenderer->drawSpeed )
+	{
+		pRenderer->drawSpeed = pRenderState->drawSpeed;
+        renderer_setDrawSpeed( pRenderer->drawSpeed );
+	}
+	if( pRenderState->variance != pRenderer->variance )
+	{
+		pRenderer->variance = pRenderState->variance;
+        renderer_setVariance( pRenderer->variance );
+	}
+
+	if( pRenderState->state == pRenderer->state )
+	{
+		return;
+	}
+	pRenderer->state = pRenderState->state;
+
+    if( pRenderer->state == GameState_Menu )
+    {
+        renderer_setDrawSpeed(0.0f);
+        
+        renderer_setPen( Pen_Fat );
+        float2 position;
+        float2_set(&position,20.0f,10.0f);
+
+        font_drawText(&position,1.0f,0.1f,"PAPERb0mb!" );
+        //font_draw( 
+    }
+    else
+    {
+        renderer_setDrawSpeed(1.0f);
+    }
+}
+
+// between the previous and the current state. cars that just (re)spawned are not interpolated
+static void game_render_interpolatePlayer( ClientPlayer* pResult, const ClientPlayer* pPrevious, const ClientPlayer* pCurrent, float alpha )
+{
+	*pResult = *pCurrent;
+	if( pPrevious->state == PlayerState_InActive || pCurrent->age < pPrevious->age )
+	{
+		return;
+	}
+
+	pResult->posX		= (int16)( pPrevious->posX + (int)( (float)( pCurrent->posX - pPrevious->posX ) * alpha ) );
+	pResult->posY		= (int16)( pPrevious->posY + (int)( (float)( pCurrent->posY - pPrevious->posY ) * alpha ) );
+
+	// the shorter way around:
+	const int directionDelta = (int8)( pCurrent->direction - pPrevious->direction );
+	pResult->direction	= (uint8)( pPrevious->direction + (int)( (float)directionDelta * alpha ) );
+}
+
+void game_render( float timeStep )
+{
+	SYS_PROFILE_BEGIN( "game_render" );
+
+	GameRenderer* pRenderer = &s_gameRenderer;
+	const uint64 startTime = sys_getTime();
+
+	triplebuffer_acquire( &s_game.renderBuffer );
+	const GameRenderState* pRenderState = (const GameRenderState*)triplebuffer_getReadSlot( &s_game.renderBuffer );
+	game_render_applyState( pRenderer, pRenderState );
+
+	// the state was published a bit before this frame:
+	const float alpha = float_saturate( pRenderState->interpolation + (float)( sys_getTime() - pRenderState->publishTime ) * 1e-9f / GAMETIMESTEP );
+
 	//if( s_game.renderTime < GAMETIMESTEP )
 	//{
 	//	return;
 	//}
 
-	if( s_game.state == GameState_Play && renderer_isPageDone() )
+	if( pRenderer->state == GameState_Play && renderer_isPageDone() )
 	{
 		// new page:
 		renderer_flipPage();
@@ -449,11 +783,11 @@ void game_render()
 		renderer_setTransform( 0 );
 		renderer_setPen( Pen_Default );
 
-		if( s_game.state == GameState_Play )
+		if( pRenderer->state == GameState_Play )
 		{
-			ClientGameState* pGameState = &s_game.client.gameState;
+			const ClientGameState* pGameState = &pRenderState->gameState;
 
-			game_render_world( &s_game.world );
+			game_render_world( s_game.pWorld, &s_game.worldTransform );
 
 			float2 fontPos;
 			float2_set( &fontPos, 5.0f, 20.0f );
@@ -463,7 +797,9 @@ void game_render()
 				const ClientPlayer* pPlayer = &pGameState->player[ i ];
 				if( pPlayer->state != PlayerState_InActive )
 				{
-					game_render_car( pPlayer, &s_game.world.worldTransform );
+					ClientPlayer player;
+					game_render_interpolatePlayer( &player, &pRenderState->previousGameState.player[ i ], pPlayer, alpha );
+					game_render_car( &player, &s_game.worldTransform );
 
 					char frags[ 16u ];
 					sprintf( frags, "%d", pPlayer->frags );
@@ -476,7 +812,7 @@ void game_render()
 				const ClientBomb* pBomb = &pGameState->bombs[ i ];
 				if( pBomb->time > 0u )
 				{
-					game_render_bomb( pBomb, &s_game.world.worldTransform );
+					game_render_bomb( pBomb, &s_game.worldTransform );
 				}
 			}
 			for( uint i = 0u; i < SYS_COUNTOF( pGameState->items ); ++i )
@@ -484,7 +820,7 @@ void game_render()
 				const ClientItem* pItem = &pGameState->items[ i ];
 				if( pItem->type != ItemType_None )
 				{
-					game_render_item( pItem, &s_game.world.worldTransform );
+					game_render_item( pItem, &s_game.worldTransform );
 				}
 			}
 			for( uint i = 0u; i < SYS_COUNTOF( pGameState->explosions ); ++i )
@@ -492,17 +828,19 @@ void game_render()
 				const ClientExplosion* pExplosion = &pGameState->explosions[ i ];
 				//if( pExplosion->time > 0u )
 				//{
-				//	game_render_explosion( pExplosion, &s_game.world.worldTransform );
+				//	game_render_explosion( pExplosion, &s_game.worldTransform );
 				//}
-				if( s_game.client.explosionTriggered[ i ] )
+				if( pRenderState->explosionCounts[ i ] != pRenderer->explosionCounts[ i ] )
 				{
-					game_render_burnhole( pExplosion, &s_game.world.worldTransform );
-					s_game.client.explosionTriggered[i] = 0;
+					game_render_burnhole( pExplosion, &s_game.worldTransform );
+					pRenderer->explosionCounts[ i ] = pRenderState->explosionCounts[ i ];
 				}
 			}
 		}
 	}
-	renderer_updatePage( GAMETIMESTEP );
+	// updating the page uploads and draws the new strokes, that's part of the tessellation too:
+	renderer_updatePage( timeStep );
+	const uint64 tessellationEndTime = sys_getTime();
 
 	FrameData frame;
 	//memset( &frame, 0u, sizeof( frame ) );
@@ -510,5 +848,9 @@ void game_render()
 	//frame.playerPos = s_game.player[ 0u ].position;
 	renderer_drawFrame( &frame );
 
+	pRenderer->timings.tessellationTime	= tessellationEndTime - startTime;
+	pRenderer->timings.submissionTime	= sys_getTime() - tessellationEndTime;
+
 	//s_game.renderTime = 0.0f;
+	SYS_PROFILE_END();
 }
@@ -14,7 +14,32 @@ void game_init();
 void game_done();
 
 void game_update( const GameInput* pInput );
-void game_render();
+
+// writes every client tick of the next match to a replay file (see replay.h)
+void game_recordNextMatch( const char* pFileName );
+
+// plays a replay file instead of a match. every GAMETIMESTEP of game_update plays one recorded tick
+// with its recorded buttons, the buttons of the input are ignored. the game is back in the menu when it is done.
+// the buttons are simulated again and the replay stops at the first tick that doesn't match its recorded snapshot
+int game_startReplay( const char* pFileName );
+int game_isReplayDone();
+
+// the tick the last replay stopped at because the simulation didn't match, 0 if it did
+uint game_getReplayDesyncTick();
+
+// cpu time of the parts of the last game_render in nanoseconds
+typedef struct
+{
+    uint64      tessellationTime;   // building the page: game objects to stroke points, stroke vertices and their upload
+    uint64      submissionTime;     // drawing the frame: the gl calls of the recorded commands
+} GameRenderTimings;
+
+const GameRenderTimings* game_getRenderTimings();
+
+// the render functions can run on their own thread (with the gl context), they only read what game_update published
+void game_initRender();
+void game_doneRender();
+void game_render( float timeStep );
 
 #endif 
 
@@ -1,12 +1,29 @@
+// the ray casts decide explosion lengths on the server, so the simd and scalar paths have to
+// give bit identical results. that only holds with strict ieee math in this file:
+#if defined( __clang__ )
+#   pragma float_control( precise, on )
+#   pragma clang fp contract( off )
+#elif defined( _MSC_VER )
+#   pragma float_control( precise, on )
+#elif defined( __GNUC__ )
+#   pragma GCC optimize( "no-fast-math", "fp-contract=off" )
+#endif
+
 #include "geometry.h"
 #include "vector.h"
+#include "debug.h"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#   define GEOMETRY_SIMD_SSE
+#   include <emmintrin.h>
+#endif
 
 int isCircleCircleIntersecting( const Circle* pCircleA, const Circle* pCircleB )
 {
 	return float2_squareDistance( &pCircleA->center, &pCircleB->center ) < float_sqr( pCircleA->radius + pCircleB->radius );
 }
 
-static float getLinePointDistance( const Line* pLine, const float2* pPoint, float* pLinePos )
+static float getLinePointSquareDistance( const Line* pLine, const float2* pPoint, float* pLinePos )
 {
 	float2 ab;
 	float2_sub( &ab, &pLine->b, &pLine->a );
@@ -23,28 +40,137 @@ static float getLinePointDistance( const Line* pLine, const float2* pPoint, floa
 
 	if( v <= 0.0f ) 
 	{
-		return float2_distance( pPoint, &pLine->a );
+		return float2_squareDistance( pPoint, &pLine->a );
 	} 
 	else if( v >= 1.0f ) 
 	{
-		return float2_distance( pPoint, &pLine->b );
+		return float2_squareDistance( pPoint, &pLine->b );
 	} 
 	else 
 	{
 		float2 p;
 		float2_addScaled1f( &p, &pLine->a, &ab, v );
-		return float2_distance( pPoint, &p );
+		return float2_squareDistance( pPoint, &p );
 	}
 }
 
+static float getLinePointDistance( const Line* pLine, const float2* pPoint, float* pLinePos )
+{
+	return sqrtf( getLinePointSquareDistance( pLine, pPoint, pLinePos ) );
+}
+
 int isCircleLineIntersecting( const Circle* pCircle, const Line* pLine )
 {
-	return getLinePointDistance( pLine, &pCircle->center, 0 ) <= pCircle->radius;
+	return getLinePointSquareDistance( pLine, &pCircle->center, 0 ) <= float_sqr( pCircle->radius );
 }
 
 int isCircleCapsuleIntersecting( const Circle* pCircle, const Capsule* pCapsule )
 {
-	return getLinePointDistance( &pCapsule->line, &pCircle->center, 0 ) <= pCircle->radius + pCapsule->radius;
+	return getLinePointSquareDistance( &pCapsule->line, &pCircle->center, 0 ) <= float_sqr( pCircle->radius + pCapsule->radius );
+}
+
+void getLineClosestPoint( float2* pResult, const Line* pLine, const float2* pPoint )
+{
+	float2 ab;
+	float2_sub( &ab, &pLine->b, &pLine->a );
+
+	const float squareLength = float2_squareLength( &ab );
+	if( squareLength <= 0.0f )
+	{
+		*pResult = pLine->a;
+		return;
+	}
+
+	float2 ap;
+	float2_sub( &ap, pPoint, &pLine->a );
+
+	const float v = float_clamp( float2_dot( &ap, &ab ) / squareLength, 0.0f, 1.0f );
+	float2_addScaled1f( pResult, &pLine->a, &ab, v );
+}
+
+// returns the vector that moves the circle out of the polygon
+static int getCirclePolygonPenetration( const Circle* pCircle, const Polygon* pPolygon, float2* pPush )
+{
+	SYS_ASSERT( pPolygon->vertexCount >= 3u && pPolygon->vertexCount <= MaxPolygonVertices );
+
+	// signed distance of the center to the edge lines. the largest one is the closest edge if the center is inside
+	float maxDistance = -1e30f;
+	float2 maxNormal;
+	float2_set( &maxNormal, 0.0f, 0.0f );
+	for( uint i = 0u; i < pPolygon->vertexCount; ++i )
+	{
+		const float2* pA = &pPolygon->vertices[ i ];
+		const float2* pB = &pPolygon->vertices[ ( i + 1u ) % pPolygon->vertexCount ];
+
+		float2 edge;
+		float2_sub( &edge, pB, pA );
+
+		float2 normal;
+		float2_perpendicular( &normal, &edge );
+		float2_normalize0( &normal );
+
+		float2 ap;
+		float2_sub( &ap, &pCircle->center, pA );
+		const float distance = float2_dot( &ap, &normal );
+		if( distance > maxDistance )
+		{
+			maxDistance = distance;
+			maxNormal = normal;
+		}
+	}
+
+	if( maxDistance >= pCircle->radius )
+	{
+		return FALSE;
+	}
+	if( maxDistance <= 0.0f )
+	{
+		float2_scale1f( pPush, &maxNormal, pCircle->radius - maxDistance );
+		return TRUE;
+	}
+
+	// the center is outside, the closest point is on one of the edges facing it:
+	float minSquareDistance = 1e30f;
+	float2 closest;
+	float2_set( &closest, 0.0f, 0.0f );
+	for( uint i = 0u; i < pPolygon->vertexCount; ++i )
+	{
+		Line edge;
+		edge.a = pPolygon->vertices[ i ];
+		edge.b = pPolygon->vertices[ ( i + 1u ) % pPolygon->vertexCount ];
+
+		float2 point;
+		getLineClosestPoint( &point, &edge, &pCircle->center );
+		const float squareDistance = float2_squareDistance( &point, &pCircle->center );
+		if( squareDistance < minSquareDistance )
+		{
+			minSquareDistance = squareDistance;
+			closest = point;
+		}
+	}
+
+	if( minSquareDistance >= float_sqr( pCircle->radius ) )
+	{
+		return FALSE;
+	}
+
+	const float distance = sqrtf( minSquareDistance );
+	float2_sub( pPush, &pCircle->center, &closest );
+	if( distance > 0.01f )
+	{
+		float2_scale1f( pPush, pPush, ( pCircle->radius - distance ) / distance );
+	}
+	else
+	{
+		float2_set( pPush, 0.0f, 0.0f );
+	}
+	return TRUE;
+}
+
+int isCirclePolygonIntersecting( const Circle* pCircle, const Polygon* pPolygon )
+{
+	float2 push;
+	return getCirclePolygonPenetration( pCircle, pPolygon, &push );
 }
 
 int isCircleCircleIntersectingWithDistance( const Circle* pCircle, const Line* pLine, float* pDistance )
@@ -123,3 +249,494 @@ int circleCircleCollide( const Circle* pFirst, const Circle* pSecond, float mass
 	return FALSE;
 }
 
+int capsuleCircleCollide( const Capsule* pCapsule, const Circle* pCircle, float2* pCirclePos )
+{
+	Circle closest;
+	getLineClosestPoint( &closest.center, &pCapsule->line, &pCircle->center );
+	closest.radius = pCapsule->radius;
+	return circleCircleCollide( &closest, pCircle, 1.0f, 0, pCirclePos );
+}
+
+int polygonCircleCollide( const Polygon* pPolygon, const Circle* pCircle, float2* pCirclePos )
+{
+	float2 push;
+	if( !getCirclePolygonPenetration( pCircle, pPolygon, &push ) )
+	{
+		return FALSE;
+	}
+	float2_add( pCirclePos, pCirclePos, &push );
+	return TRUE;
+}
+
+void raybatch_clear( RayBatch* pBatch )
+{
+	pBatch->count = 0u;
+}
+
+uint raybatch_add( RayBatch* pBatch, const Line* pRay, float maxDistance )
+{
+	SYS_ASSERT( pBatch->count < RayBatchCapacity );
+	const uint index = pBatch->count++;
+	pBatch->ax[ index ]			= pRay->a.x;
+	pBatch->ay[ index ]			= pRay->a.y;
+	pBatch->bx[ index ]			= pRay->b.x;
+	pBatch->by[ index ]			= pRay->b.y;
+	pBatch->distance[ index ]	= maxDistance;
+	return index;
+}
+
+int sweepCircleCircle( const Circle* pMoving, const float2* pDisplacement, const Circle* pStatic, float* pTimeOfImpact )
+{
+	float2 distance;
+	float2_sub( &distance, &pMoving->center, &pStatic->center );
+
+	const float c = float2_squareLength( &distance ) - float_sqr( pMoving->radius + pStatic->radius );
+	const float b = float2_dot( &distance, pDisplacement );
+	const float a = float2_squareLength( pDisplacement );
+	if( c <= 0.0f || b >= 0.0f || a <= 0.0f )
+	{
+		// overlapping already or moving away:
+		return FALSE;
+	}
+
+	const float discriminant = b * b - a * c;
+	if( discriminant < 0.0f )
+	{
+		return FALSE;
+	}
+
+	const float time = ( -b - sqrtf( discriminant ) ) / a;
+	if( time > 1.0f )
+	{
+		return FALSE;
+	}
+
+	*pTimeOfImpact = float_max( time, 0.0f );
+	return TRUE;
+}
+
+// intersection of the segment [origin,origin+direction] with [start,start+edge]
+static int getSegmentIntersectionTime( const float2* pOrigin, const float2* pDirection, const float2* pStart, const float2* pEdge, float* pTime )
+{
+	const float denominator = pDirection->x * pEdge->y - pDirection->y * pEdge->x;
+	if( float_abs( denominator ) < 0.000001f )
+	{
+		return FALSE;
+	}
+
+	float2 w;
+	float2_sub( &w, pStart, pOrigin );
+
+	const float time	= ( w.x * pEdge->y - w.y * pEdge->x ) / denominator;
+	const float edgePos	= ( w.x * pDirection->y - w.y * pDirection->x ) / denominator;
+	if( time < 0.0f || time > 1.0f || edgePos < 0.0f || edgePos > 1.0f )
+	{
+		return FALSE;
+	}
+
+	*pTime = time;
+	return TRUE;
+}
+
+int sweepCircleCapsule( const Circle* pMoving, const float2* pDisplacement, const Capsule* pStatic, float* pTimeOfImpact )
+{
+	const float radius = pMoving->radius + pStatic->radius;
+
+	float2 closest;
+	getLineClosestPoint( &closest, &pStatic->line, &pMoving->center );
+	if( float2_squareDistance( &closest, &pMoving->center ) <= float_sqr( radius ) )
+	{
+		return FALSE;
+	}
+
+	// the capsule grown by the moving radius is entered through one of its caps or one of its sides:
+	float time = 2.0f;
+
+	Circle cap;
+	cap.radius = pStatic->radius;
+	float capTime;
+	cap.center = pStatic->line.a;
+	if( sweepCircleCircle( pMoving, pDisplacement, &cap, &capTime ) && capTime < time )
+	{
+		time = capTime;
+	}
+	cap.center = pStatic->line.b;
+	if( sweepCircleCircle( pMoving, pDisplacement, &cap, &capTime ) && capTime < time )
+	{
+		time = capTime;
+	}
+
+	float2 ab;
+	float2_sub( &ab, &pStatic->line.b, &pStatic->line.a );
+	if( float2_squareLength( &ab ) > 0.0f )
+	{
+		float2 normal;
+		float2_perpendicular( &normal, &ab );
+		float2_normalize0( &normal );
+
+		for( uint i = 0u; i < 2u; ++i )
+		{
+			float2 sideStart;
+			float2_addScaled1f( &sideStart, &pStatic->line.a, &normal, i == 0u ? radius : -radius );
+
+			float sideTime;
+			if( getSegmentIntersectionTime( &pMoving->center, pDisplacement, &sideStart, &ab, &sideTime ) && sideTime < time )
+			{
+				time = sideTime;
+			}
+		}
+	}
+
+	if( time > 1.0f )
+	{
+		return FALSE;
+	}
+
+	*pTimeOfImpact = time;
+	return TRUE;
+}
+
+static float sweepCircleBoxSide( float position, float displacement, float min, float max, float* pNormal )
+{
+	if( displacement < 0.0f && position + displacement < min )
+	{
+		*pNormal = 1.0f;
+		return float_max( ( min - position ) / displacement, 0.0f );
+	}
+	if( displacement > 0.0f && position + displacement > max )
+	{
+		*pNormal = -1.0f;
+		return float_max( ( max - position ) / displacement, 0.0f );
+	}
+	return 1.0f;
+}
+
+void sweepCircle( Circle* pCircle, const float2* pDisplacement, const Capsule* pObstacles, uint obstacleCount, const float2* pBoxMin, const float2* pBoxMax )
+{
+	const float radius = pCircle->radius;
+	float2 displacement = *pDisplacement;
+
+	// the first hit stops the motion, the rest slides along the contact. a second contact stops it for this step
+	for( uint iteration = 0u; iteration < 2u; ++iteration )
+	{
+		float time = 1.0f;
+		float2 normal;
+		float2_set( &normal, 0.0f, 0.0f );
+
+		for( uint i = 0u; i < obstacleCount; ++i )
+		{
+			float obstacleTime;
+			if( sweepCircleCapsule( pCircle, &displacement, &pObstacles[ i ], &obstacleTime ) && obstacleTime < time )
+			{
+				time = obstacleTime;
+
+				float2 contact;
+				float2_addScaled1f( &contact, &pCircle->center, &displacement, time );
+
+				float2 closest;
+				getLineClosestPoint( &closest, &pObstacles[ i ].line, &contact );
+				float2_sub( &normal, &contact, &closest );
+				float2_normalize0( &normal );
+			}
+		}
+
+		float sideNormal = 0.0f;
+		const float timeX = sweepCircleBoxSide( pCircle->center.x, displacement.x, pBoxMin->x + radius, pBoxMax->x - radius, &sideNormal );
+		if( timeX < time )
+		{
+			time = timeX;
+			float2_set( &normal, sideNormal, 0.0f );
+		}
+		const float timeY = sweepCircleBoxSide( pCircle->center.y, displacement.y, pBoxMin->y + radius, pBoxMax->y - radius, &sideNormal );
+		if( timeY < time )
+		{
+			time = timeY;
+			float2_set( &normal, 0.0f, sideNormal );
+		}
+
+		float2_addScaled1f( &pCircle->center, &pCircle->center, &displacement, time );
+		if( time >= 1.0f || iteration == 1u )
+		{
+			break;
+		}
+
+		float2_scale1f( &displacement, &displacement, 1.0f - time );
+		float2_addScaled1f( &displacement, &displacement, &normal, -float2_dot( &displacement, &normal ) );
+	}
+
+	pCircle->center.x = float_clamp( pCircle->center.x, pBoxMin->x + radius, pBoxMax->x - radius );
+	pCircle->center.y = float_clamp( pCircle->center.y, pBoxMin->y + radius, pBoxMax->y - radius );
+}
+
+void circlebatch_clear( CircleBatch* pBatch )
+{
+	pBatch->count = 0u;
+}
+
+uint circlebatch_add( CircleBatch* pBatch, const Circle* pCircle )
+{
+	SYS_ASSERT( pBatch->count < CircleBatchCapacity );
+	const uint index = pBatch->count++;
+	pBatch->centerX[ index ]	= pCircle->center.x;
+	pBatch->centerY[ index ]	= pCircle->center.y;
+	pBatch->radius[ index ]		= pCircle->radius;
+	return index;
+}
+
+#ifdef GEOMETRY_SIMD_SSE
+
+static inline uint circlebatch_getLaneGroupCount( const CircleBatch* pBatch )
+{
+	return ( pBatch->count + 3u ) / 4u;
+}
+
+static inline uint32 circlebatch_getValidMask( const CircleBatch* pBatch )
+{
+	return pBatch->count < 32u ? ( 1u << pBatch->count ) - 1u : 0xffffffffu;
+}
+
+uint32 circlebatch_intersectCircle( const CircleBatch* pBatch, const Circle* pCircle )
+{
+	const __m128 cx = _mm_set1_ps( pCircle->center.x );
+	const __m128 cy = _mm_set1_ps( pCircle->center.y );
+	const __m128 radius = _mm_set1_ps( pCircle->radius );
+
+	uint32 mask = 0u;
+	const uint groupCount = circlebatch_getLaneGroupCount( pBatch );
+	for( uint g = 0u; g < groupCount; ++g )
+	{
+		const uint i = g * 4u;
+		const __m128 dx = _mm_sub_ps( _mm_loadu_ps( &pBatch->centerX[ i ] ), cx );
+		const __m128 dy = _mm_sub_ps( _mm_loadu_ps( &pBatch->centerY[ i ] ), cy );
+		const __m128 radiusSum = _mm_add_ps( _mm_loadu_ps( &pBatch->radius[ i ] ), radius );
+
+		const __m128 squareDistance = _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+		const __m128 isHit = _mm_cmplt_ps( squareDistance, _mm_mul_ps( radiusSum, radiusSum ) );
+		mask |= (uint32)_mm_movemask_ps( isHit ) << i;
+	}
+
+	return mask & circlebatch_getValidMask( pBatch );
+}
+
+uint32 circlebatch_intersectCapsule( const CircleBatch* pBatch, const Capsule* pCapsule )
+{
+	const __m128 zero	= _mm_setzero_ps();
+	const __m128 one	= _mm_set1_ps( 1.0f );
+
+	const float abx1 = pCapsule->line.b.x - pCapsule->line.a.x;
+	const float aby1 = pCapsule->line.b.y - pCapsule->line.a.y;
+
+	const __m128 ax = _mm_set1_ps( pCapsule->line.a.x );
+	const __m128 ay = _mm_set1_ps( pCapsule->line.a.y );
+	const __m128 bx = _mm_set1_ps( pCapsule->line.b.x );
+	const __m128 by = _mm_set1_ps( pCapsule->line.b.y );
+	const __m128 abx = _mm_set1_ps( abx1 );
+	const __m128 aby = _mm_set1_ps( aby1 );
+	const __m128 abLength2 = _mm_set1_ps( abx1 * abx1 + aby1 * aby1 );
+	const __m128 capsuleRadius = _mm_set1_ps( pCapsule->radius );
+
+	uint32 mask = 0u;
+	const uint groupCount = circlebatch_getLaneGroupCount( pBatch );
+	for( uint g = 0u; g < groupCount; ++g )
+	{
+		const uint i = g * 4u;
+		const __m128 cx = _mm_loadu_ps( &pBatch->centerX[ i ] );
+		const __m128 cy = _mm_loadu_ps( &pBatch->centerY[ i ] );
+		const __m128 radiusSum = _mm_add_ps( _mm_loadu_ps( &pBatch->radius[ i ] ), capsuleRadius );
+
+		const __m128 apx = _mm_sub_ps( cx, ax );
+		const __m128 apy = _mm_sub_ps( cy, ay );
+		const __m128 v = _mm_div_ps( _mm_add_ps( _mm_mul_ps( apx, abx ), _mm_mul_ps( apy, aby ) ), abLength2 );
+
+		const __m128 isBeforeA	= _mm_cmple_ps( v, zero );
+		const __m128 isAfterB	= _mm_andnot_ps( isBeforeA, _mm_cmpge_ps( v, one ) );
+		const __m128 isInside	= _mm_andnot_ps( _mm_or_ps( isBeforeA, isAfterB ), _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) );
+
+		const __m128 px = _mm_or_ps( _mm_or_ps( _mm_and_ps( isBeforeA, ax ), _mm_and_ps( isAfterB, bx ) ), _mm_and_ps( isInside, _mm_add_ps( ax, _mm_mul_ps( abx, v ) ) ) );
+		const __m128 py = _mm_or_ps( _mm_or_ps( _mm_and_ps( isBeforeA, ay ), _mm_and_ps( isAfterB, by ) ), _mm_and_ps( isInside, _mm_add_ps( ay, _mm_mul_ps( aby, v ) ) ) );
+		const __m128 dx = _mm_sub_ps( cx, px );
+		const __m128 dy = _mm_sub_ps( cy, py );
+		const __m128 squareDistance = _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+
+		const __m128 isHit = _mm_cmple_ps( squareDistance, _mm_mul_ps( radiusSum, radiusSum ) );
+		mask |= (uint32)_mm_movemask_ps( isHit ) << i;
+	}
+
+	return mask & circlebatch_getValidMask( pBatch );
+}
+
+// the lanes past count may hold anything, their results are never read
+static inline uint raybatch_getLaneGroupCount( const RayBatch* pBatch )
+{
+	return ( pBatch->count + 3u ) / 4u;
+}
+
+void raybatch_intersectCircles( RayBatch* pBatch, const Circle* pCircles, uint circleCount )
+{
+	const __m128 zero	= _mm_setzero_ps();
+	const __m128 one	= _mm_set1_ps( 1.0f );
+
+	const uint groupCount = raybatch_getLaneGroupCount( pBatch );
+	for( uint g = 0u; g < groupCount; ++g )
+	{
+		const uint i = g * 4u;
+		const __m128 ax = _mm_loadu_ps( &pBatch->ax[ i ] );
+		const __m128 ay = _mm_loadu_ps( &pBatch->ay[ i ] );
+		const __m128 bx = _mm_loadu_ps( &pBatch->bx[ i ] );
+		const __m128 by = _mm_loadu_ps( &pBatch->by[ i ] );
+		const __m128 abx = _mm_sub_ps( bx, ax );
+		const __m128 aby = _mm_sub_ps( by, ay );
+		const __m128 abLength2 = _mm_add_ps( _mm_mul_ps( abx, abx ), _mm_mul_ps( aby, aby ) );
+		__m128 minDistance = _mm_loadu_ps( &pBatch->distance[ i ] );
+
+		for( uint j = 0u; j < circleCount; ++j )
+		{
+			const __m128 cx = _mm_set1_ps( pCircles[ j ].center.x );
+			const __m128 cy = _mm_set1_ps( pCircles[ j ].center.y );
+
+			const __m128 apx = _mm_sub_ps( cx, ax );
+			const __m128 apy = _mm_sub_ps( cy, ay );
+			const __m128 v = _mm_div_ps( _mm_add_ps( _mm_mul_ps( apx, abx ), _mm_mul_ps( apy, aby ) ), abLength2 );
+
+			// closest point on the segment, selected the same way as getLinePointDistance:
+			const __m128 isBeforeA	= _mm_cmple_ps( v, zero );
+			const __m128 isAfterB	= _mm_andnot_ps( isBeforeA, _mm_cmpge_ps( v, one ) );
+			const __m128 isInside	= _mm_andnot_ps( _mm_or_ps( isBeforeA, isAfterB ), _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) );
+
+			const __m128 px = _mm_or_ps( _mm_or_ps( _mm_and_ps( isBeforeA, ax ), _mm_and_ps( isAfterB, bx ) ), _mm_and_ps( isInside, _mm_add_ps( ax, _mm_mul_ps( abx, v ) ) ) );
+			const __m128 py = _mm_or_ps( _mm_or_ps( _mm_and_ps( isBeforeA, ay ), _mm_and_ps( isAfterB, by ) ), _mm_and_ps( isInside, _mm_add_ps( ay, _mm_mul_ps( aby, v ) ) ) );
+			const __m128 dx = _mm_sub_ps( cx, px );
+			const __m128 dy = _mm_sub_ps( cy, py );
+			const __m128 pointDistance = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ) );
+			const __m128 isHit = _mm_cmple_ps( pointDistance, _mm_set1_ps( pCircles[ j ].radius ) );
+
+			const __m128 hx = _mm_mul_ps( abx, v );
+			const __m128 hy = _mm_mul_ps( aby, v );
+			const __m128 hitDistance = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( hx, hx ), _mm_mul_ps( hy, hy ) ) );
+			minDistance = _mm_or_ps( _mm_and_ps( isHit, _mm_min_ps( minDistance, hitDistance ) ), _mm_andnot_ps( isHit, minDistance ) );
+		}
+
+		_mm_storeu_ps( &pBatch->distance[ i ], minDistance );
+	}
+}
+
+void raybatch_intersectLines( RayBatch* pBatch, const Line* pLines, uint lineCount )
+{
+	const __m128 zero			= _mm_setzero_ps();
+	const __m128 one			= _mm_set1_ps( 1.0f );
+	const __m128 epsilon		= _mm_set1_ps( 0.0001f );
+	const __m128 minusEpsilon	= _mm_set1_ps( -0.0001f );
+
+	const uint groupCount = raybatch_getLaneGroupCount( pBatch );
+	for( uint g = 0u; g < groupCount; ++g )
+	{
+		const uint i = g * 4u;
+		const __m128 x1 = _mm_loadu_ps( &pBatch->ax[ i ] );
+		const __m128 y1 = _mm_loadu_ps( &pBatch->ay[ i ] );
+		const __m128 x2 = _mm_loadu_ps( &pBatch->bx[ i ] );
+		const __m128 y2 = _mm_loadu_ps( &pBatch->by[ i ] );
+		const __m128 dx12 = _mm_sub_ps( x2, x1 );
+		const __m128 dy12 = _mm_sub_ps( y2, y1 );
+		__m128 minDistance = _mm_loadu_ps( &pBatch->distance[ i ] );
+
+		for( uint j = 0u; j < lineCount; ++j )
+		{
+			const __m128 x3 = _mm_set1_ps( pLines[ j ].a.x );
+			const __m128 y3 = _mm_set1_ps( pLines[ j ].a.y );
+			const __m128 dx34 = _mm_set1_ps( pLines[ j ].b.x - pLines[ j ].a.x );
+			const __m128 dy34 = _mm_set1_ps( pLines[ j ].b.y - pLines[ j ].a.y );
+
+			const __m128 a = _mm_sub_ps( _mm_mul_ps( dx34, _mm_sub_ps( y1, y3 ) ), _mm_mul_ps( dy34, _mm_sub_ps( x1, x3 ) ) );
+			const __m128 b = _mm_sub_ps( _mm_mul_ps( dy34, dx12 ), _mm_mul_ps( dx34, dy12 ) );
+
+			// the negated compares keep the scalar behaviour for nan values:
+			const __m128 isParallel = _mm_and_ps( _mm_cmpgt_ps( b, minusEpsilon ), _mm_cmplt_ps( b, epsilon ) );
+			const __m128 p = _mm_div_ps( a, b );
+			const __m128 isOnLine = _mm_and_ps( _mm_cmpnlt_ps( p, zero ), _mm_cmpngt_ps( p, one ) );
+			const __m128 isHit = _mm_andnot_ps( isParallel, isOnLine );
+
+			const __m128 hx = _mm_mul_ps( dx12, p );
+			const __m128 hy = _mm_mul_ps( dy12, p );
+			const __m128 hitDistance = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( hx, hx ), _mm_mul_ps( hy, hy ) ) );
+			minDistance = _mm_or_ps( _mm_and_ps( isHit, _mm_min_ps( minDistance, hitDistance ) ), _mm_andnot_ps( isHit, minDistance ) );
+		}
+
+		_mm_storeu_ps( &pBatch->distance[ i ], minDistance );
+	}
+}
+
+#else
+
+uint32 circlebatch_intersectCircle( const CircleBatch* pBatch, const Circle* pCircle )
+{
+	uint32 mask = 0u;
+	for( uint i = 0u; i < pBatch->count; ++i )
+	{
+		Circle circle;
+		float2_set( &circle.center, pBatch->centerX[ i ], pBatch->centerY[ i ] );
+		circle.radius = pBatch->radius[ i ];
+
+		if( isCircleCircleIntersecting( &circle, pCircle ) )
+		{
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+}
+
+uint32 circlebatch_intersectCapsule( const CircleBatch* pBatch, const Capsule* pCapsule )
+{
+	uint32 mask = 0u;
+	for( uint i = 0u; i < pBatch->count; ++i )
+	{
+		Circle circle;
+		float2_set( &circle.center, pBatch->centerX[ i ], pBatch->centerY[ i ] );
+		circle.radius = pBatch->radius[ i ];
+
+		if( isCircleCapsuleIntersecting( &circle, pCapsule ) )
+		{
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+}
+
+void raybatch_intersectCircles( RayBatch* pBatch, const Circle* pCircles, uint circleCount )
+{
+	for( uint i = 0u; i < pBatch->count; ++i )
+	{
+		Line ray;
+		float2_set( &ray.a, pBatch->ax[ i ], pBatch->ay[ i ] );
+		float2_set( &ray.b, pBatch->bx[ i ], pBatch->by[ i ] );
+
+		for( uint j = 0u; j < circleCount; ++j )
+		{
+			float distance;
+			if( isCircleCircleIntersectingWithDistance( &pCircles[ j ], &ray, &distance ) )
+			{
+				pBatch->distance[ i ] = float_min( pBatch->distance[ i ], distance );
+			}
+		}
+	}
+}
+
+void raybatch_intersectLines( RayBatch* pBatch, const Line* pLines, uint lineCount )
+{
+	for( uint i = 0u; i < pBatch->count; ++i )
+	{
+		Line ray;
+		float2_set( &ray.a, pBatch->ax[ i ], pBatch->ay[ i ] );
+		float2_set( &ray.b, pBatch->bx[ i ], pBatch->by[ i ] );
+
+		for( uint j = 0u; j < lineCount; ++j )
+		{
+			float distance;
+			if( isLineLineIntersectingWithDistance( &ray, &pLines[ j ], &distance ) )
+			{
+				pBatch->distance[ i ] = float_min( pBatch->distance[ i ], distance );
+			}
+		}
+	}
+}
+
+#endif
@@ -21,14 +21,83 @@ typedef struct
 	float	radius;
 } Circle;
 
+enum
+{
+	MaxPolygonVertices	= 8u
+};
+
+// convex with counter clockwise winding
+typedef struct
+{
+	float2	vertices[ MaxPolygonVertices ];
+	uint	vertexCount;
+} Polygon;
+
+void	getLineClosestPoint( float2* pResult, const Line* pLine, const float2* pPoint );
+
 int		isCircleCircleIntersectingWithDistance( const Circle* pCircle, const Line* pLine, float* pDistance );
 int		isLineLineIntersectingWithDistance( const Line* pLineA, const Line* pLineB, float* pDistance );
 
 int		isCircleCircleIntersecting( const Circle* pCircleA, const Circle* pCircleB );
 int		isCircleLineIntersecting( const Circle* pCircle, const Line* pLine );
 int		isCircleCapsuleIntersecting( const Circle* pCircle, const Capsule* pCapsule );
+int		isCirclePolygonIntersecting( const Circle* pCircle, const Polygon* pPolygon );
 
 int		circleCircleCollide( const Circle* pFirst, const Circle* pSecond, float massRatio, float2* pFirstPos, float2* pSecondPos );
 
+// push the circle out of a static shape (like circleCircleCollide with a mass ratio of 1)
+int		capsuleCircleCollide( const Capsule* pCapsule, const Circle* pCircle, float2* pCirclePos );
+int		polygonCircleCollide( const Polygon* pPolygon, const Circle* pCircle, float2* pCirclePos );
+
+// time of impact (0..1) of a circle moving by pDisplacement against a static circle. circles that already overlap
+// at the start don't count as a hit, they are left to circleCircleCollide
+int		sweepCircleCircle( const Circle* pMoving, const float2* pDisplacement, const Circle* pStatic, float* pTimeOfImpact );
+int		sweepCircleCapsule( const Circle* pMoving, const float2* pDisplacement, const Capsule* pStatic, float* pTimeOfImpact );
+
+// moves the circle by pDisplacement, stopping at the first obstacle or box side it touches and sliding along it
+// with the rest of the motion. the circle stays inside the box [pBoxMin,pBoxMax]. circle obstacles are capsules
+// with line.a == line.b, polygons are passed as their edges (capsules with radius 0)
+void	sweepCircle( Circle* pCircle, const float2* pDisplacement, const Capsule* pObstacles, uint obstacleCount, const float2* pBoxMin, const float2* pBoxMax );
+
+enum
+{
+	CircleBatchCapacity	= 32u,		// has to be a multiple of 4 and fit into the uint32 hit masks
+	RayBatchCapacity	= 64u		// has to be a multiple of 4
+};
+
+// circles in structure of arrays layout, one shape is tested against all of them at once
+typedef struct
+{
+	float	centerX[ CircleBatchCapacity ];
+	float	centerY[ CircleBatchCapacity ];
+	float	radius[ CircleBatchCapacity ];
+	uint	count;
+} CircleBatch;
+
+void	circlebatch_clear( CircleBatch* pBatch );
+uint	circlebatch_add( CircleBatch* pBatch, const Circle* pCircle );
+
+// return a mask with bit i set if circle i intersects the shape (same results as isCircleCircleIntersecting/isCircleCapsuleIntersecting)
+uint32	circlebatch_intersectCircle( const CircleBatch* pBatch, const Circle* pCircle );
+uint32	circlebatch_intersectCapsule( const CircleBatch* pBatch, const Capsule* pCapsule );
+
+// rays in structure of arrays layout so that the kernels can test 4 rays per instruction against one obstacle
+typedef struct
+{
+	float	ax[ RayBatchCapacity ];
+	float	ay[ RayBatchCapacity ];
+	float	bx[ RayBatchCapacity ];
+	float	by[ RayBatchCapacity ];
+	float	distance[ RayBatchCapacity ];	// distance to the closest hit so far
+	uint	count;
+} RayBatch;
+
+void	raybatch_clear( RayBatch* pBatch );
+uint	raybatch_add( RayBatch* pBatch, const Line* pRay, float maxDistance );
+
+// same results as calling isCircleCircleIntersectingWithDistance/isLineLineIntersectingWithDistance per ray and keeping the minimum
+void	raybatch_intersectCircles( RayBatch* pBatch, const Circle* pCircles, uint circleCount );
+void	raybatch_intersectLines( RayBatch* pBatch, const Line* pLines, uint lineCount );
+
 #endif
 
@@ -3,34 +3,338 @@
 #include "debug.h"
 #include "opengl.h"
 
+#include <string.h>
+
+enum
+{
+    CircleStepCount = 20u,
+
+    // the most dynamic draws of a frame: the noise and paper quads of the first frame and the screen quad,
+    // each burn hole once when it is added and once on the page flip and the control points of the font editor
+    MaxFullscreenQuadsPerFrame = 4u,
+    MaxQuadsPerFrame = 2u * 32u,
+    MaxCirclesPerFrame = 128u,
+
+    DynamicRegionSize = sizeof( Vertex2d ) * ( 4u * MaxFullscreenQuadsPerFrame + 6u * MaxQuadsPerFrame + ( CircleStepCount + 2u ) * MaxCirclesPerFrame ),
+    DynamicRegionCount = 3u,            // the gpu may still read the regions of the last two frames
+    DynamicBufferSize = DynamicRegionCount * DynamicRegionSize,
+    MaxTextureUnits = MaxFSTextureCount
+};
+
+typedef struct
+{
+    uint            bufferId;
+    int             isPersistent;
+    uint8*          pMappedData;    // persistent coherent mapping of the whole buffer
+    uint            region;
+    uint            offset;         // next free byte in the buffer
+    GLsync          regionFences[ DynamicRegionCount ];
+
+    // without persistent mapping the vertices are written here and uploaded by the draw into an orphaned buffer:
+    uint8           stagingData[ DynamicBufferSize ];
+} DynamicBuffer;
+
 typedef struct 
 {
     VertexFormat    vertexFormat;
+    uint            vertexFormatBufferId;   // the buffer the array pointers of vertexFormat refer to
+    uint            arrayBufferId;
     BlendMode       blendMode;
     RenderTarget*   pRenderTarget;
     Shader*         pShader;
+    DynamicBuffer   dynamicBuffer;
+
+    // without sampler objects the sampler state is set on the texture whenever it or the texture changes:
+    int             hasSamplerObjects;
+    uint            samplerIds[ SamplerState_Count ];
+
+    uint            activeTextureUnit;
+    uint            textureIds[ MaxTextureUnits ];
+    SamplerState    samplers[ MaxTextureUnits ];    // SamplerState_Count if unknown
 } GraphicsState;
 
 static GraphicsState s_graphics;
 
+static void bindArrayBuffer( uint bufferId )
+{
+    glBindBufferARB( GL_ARRAY_BUFFER_ARB, bufferId );
+    s_graphics.arrayBufferId = bufferId;
+}
+
+static int isExtensionSupported( const char* pName )
+{
+    const char* pExtensions = (const char*)glGetString( GL_EXTENSIONS );
+    if( !pExtensions )
+    {
+        return FALSE;
+    }
+
+    // the names are separated by spaces and some are prefixes of others:
+    const size_t nameLength = strlen( pName );
+    const char* pMatch = strstr( pExtensions, pName );
+    while( pMatch )
+    {
+        if( ( pMatch == pExtensions || pMatch[ -1 ] == ' ' ) && ( pMatch[ nameLength ] == ' ' || pMatch[ nameLength ] == '\0' ) )
+        {
+            return TRUE;
+        }
+        pMatch = strstr( pMatch + nameLength, pName );
+    }
+    return FALSE;
+}
+
+// a buffer that is orphaned when the regions start over, so writing it never waits for the gpu
+static void createStreamingBuffer( DynamicBuffer* pBuffer )
+{
+    glGenBuffersARB( 1, &pBuffer->bufferId );
+    bindArrayBuffer( pBuffer->bufferId );
+    glBufferDataARB( GL_ARRAY_BUFFER_ARB, DynamicBufferSize, 0, GL_STREAM_DRAW_ARB );
+    bindArrayBuffer( 0u );
+    pBuffer->isPersistent = FALSE;
+}
+
+static void createDynamicBuffer( DynamicBuffer* pBuffer )
+{
+    memset( pBuffer->regionFences, 0, sizeof( pBuffer->regionFences ) );
+    pBuffer->region = 0u;
+    pBuffer->offset = 0u;
+    pBuffer->pMappedData = 0;
+
+    if( !isExtensionSupported( "GL_ARB_buffer_storage" ) || !isExtensionSupported( "GL_ARB_sync" ) )
+    {
+        createStreamingBuffer( pBuffer );
+        return;
+    }
+
+    glGenBuffersARB( 1, &pBuffer->bufferId );
+    bindArrayBuffer( pBuffer->bufferId );
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage( GL_ARRAY_BUFFER_ARB, DynamicBufferSize, 0, flags );
+    pBuffer->pMappedData = (uint8*)glMapBufferRange( GL_ARRAY_BUFFER_ARB, 0, DynamicBufferSize, flags );
+    bindArrayBuffer( 0u );
+    pBuffer->isPersistent = TRUE;
+    if( !pBuffer->pMappedData )
+    {
+        SYS_TRACE_WARNING( "Could not map the dynamic vertex buffer persistently!\n" );
+
+        // immutable storage can't be respecified:
+        glDeleteBuffersARB( 1, &pBuffer->bufferId );
+        createStreamingBuffer( pBuffer );
+    }
+}
+
+static void destroyDynamicBuffer( DynamicBuffer* pBuffer )
+{
+    for( uint i = 0u; i < DynamicRegionCount; ++i )
+    {
+        if( pBuffer->regionFences[ i ] )
+        {
+            glDeleteSync( pBuffer->regionFences[ i ] );
+            pBuffer->regionFences[ i ] = 0;
+        }
+    }
+    if( pBuffer->pMappedData )
+    {
+        bindArrayBuffer( pBuffer->bufferId );
+        glUnmapBufferARB( GL_ARRAY_BUFFER_ARB );
+        bindArrayBuffer( 0u );
+        pBuffer->pMappedData = 0;
+    }
+    glDeleteBuffersARB( 1, &pBuffer->bufferId );
+    pBuffer->bufferId = 0u;
+}
+
+static void getSamplerParameters( GLint* pWrap, GLint* pFilter, SamplerState sampler )
+{
+    switch( sampler )
+    {
+    case SamplerState_ClampU_ClampV_Nearest:
+        *pWrap = GL_CLAMP_TO_EDGE;
+        *pFilter = GL_NEAREST;
+        break;
+
+    case SamplerState_ClampU_ClampV_Trilinear:
+        *pWrap = GL_CLAMP_TO_EDGE;
+        *pFilter = GL_LINEAR;
+        break;
+
+    case SamplerState_MirrorU_MirrorV_Bilinear:
+        *pWrap = GL_MIRRORED_REPEAT;
+        *pFilter = GL_LINEAR;
+        break;
+
+    default:
+        SYS_BREAK( "Invalid sampler state!\n" );
+        *pWrap = GL_CLAMP_TO_EDGE;
+        *pFilter = GL_NEAREST;
+        break;
+    }
+}
+
+static void createSamplers()
+{
+    s_graphics.hasSamplerObjects = isExtensionSupported( "GL_ARB_sampler_objects" );
+    if( !s_graphics.hasSamplerObjects )
+    {
+        return;
+    }
+
+    glGenSamplers( SamplerState_Count, s_graphics.samplerIds );
+    for( uint i = 0u; i < SamplerState_Count; ++i )
+    {
+        GLint wrap, filter;
+        getSamplerParameters( &wrap, &filter, ( SamplerState )i );
+
+        const uint samplerId = s_graphics.samplerIds[ i ];
+        glSamplerParameteri( samplerId, GL_TEXTURE_WRAP_S, wrap );
+        glSamplerParameteri( samplerId, GL_TEXTURE_WRAP_T, wrap );
+        glSamplerParameteri( samplerId, GL_TEXTURE_MAG_FILTER, filter );
+        glSamplerParameteri( samplerId, GL_TEXTURE_MIN_FILTER, filter );
+    }
+}
+
+static void setActiveTextureUnit( uint unit )
+{
+    if( s_graphics.activeTextureUnit == unit )
+    {
+        return;
+    }
+    glActiveTexture( GL_TEXTURE0 + unit );
+    s_graphics.activeTextureUnit = unit;
+}
+
 void graphics_init()
 {
+    createSamplers();
     graphics_resetState();
+
+    createDynamicBuffer( &s_graphics.dynamicBuffer );
 }
 
 void graphics_done()
 {
+    destroyDynamicBuffer( &s_graphics.dynamicBuffer );
+
+    if( s_graphics.hasSamplerObjects )
+    {
+        glDeleteSamplers( SamplerState_Count, s_graphics.samplerIds );
+    }
+}
+
+int graphics_allocDynamicVertices( DynamicVertices* pVertices, uint vertexSize, uint vertexCount )
+{
+    DynamicBuffer* pBuffer = &s_graphics.dynamicBuffer;
+    SYS_ASSERT( vertexSize > 0u );
+
+    // aligned to the vertex size, so the draw can start at a vertex index with the array pointers at the buffer start:
+    const uint offset = ( pBuffer->offset + vertexSize - 1u ) / vertexSize * vertexSize;
+    const uint size = vertexSize * vertexCount;
+    const uint regionEnd = ( pBuffer->region + 1u ) * DynamicRegionSize;
+
+    // the regions have room for the most a frame draws, so this only fails if a caller draws more than that:
+    SYS_ASSERT( offset + size <= regionEnd );
+    if( offset + size > regionEnd )
+    {
+        return FALSE;
+    }
+    pBuffer->offset = offset + size;
+
+    pVertices->pData = ( pBuffer->isPersistent ? pBuffer->pMappedData : pBuffer->stagingData ) + offset;
+    pVertices->offset = offset;
+    pVertices->vertexSize = vertexSize;
+    pVertices->vertexCount = vertexCount;
+    return TRUE;
+}
+
+void graphics_drawDynamicVertices( const DynamicVertices* pVertices, VertexFormat format, PrimitiveType primitiveType )
+{
+    DynamicBuffer* pBuffer = &s_graphics.dynamicBuffer;
+    if( pVertices->vertexCount == 0u )
+    {
+        return;
+    }
+
+    bindArrayBuffer( pBuffer->bufferId );
+    if( !pBuffer->isPersistent )
+    {
+        // the range hasn't been used since the buffer was orphaned, so this never waits for the gpu:
+        glBufferSubDataARB( GL_ARRAY_BUFFER_ARB, (GLintptrARB)pVertices->offset, (GLsizeiptrARB)( pVertices->vertexSize * pVertices->vertexCount ), pBuffer->stagingData + pVertices->offset );
+    }
+    graphics_setVertexFormat( format );
+
+    const GLenum mode = primitiveType == PrimitiveType_TriangleFan ? GL_TRIANGLE_FAN : GL_TRIANGLES;
+    glDrawArrays( mode, ( int )( pVertices->offset / pVertices->vertexSize ), ( int )pVertices->vertexCount );
+
+    bindArrayBuffer( 0u );
+}
+
+void graphics_finishFrame()
+{
+    DynamicBuffer* pBuffer = &s_graphics.dynamicBuffer;
+
+    const uint nextRegion = ( pBuffer->region + 1u ) % DynamicRegionCount;
+    if( pBuffer->isPersistent )
+    {
+        // the draws of this frame are the last ones reading the region:
+        pBuffer->regionFences[ pBuffer->region ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+        // the swap keeps the gpu less than two frames behind, so the fence is signaled unless the driver queues more.
+        // waiting for it would stall the frame, so the buffer goes back to orphaning instead:
+        GLsync fence = pBuffer->regionFences[ nextRegion ];
+        if( fence && glClientWaitSync( fence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+        {
+            SYS_TRACE_WARNING( "the gpu is more than two frames behind, dynamic vertices are orphaned from now on\n" );
+            destroyDynamicBuffer( pBuffer );
+            createStreamingBuffer( pBuffer );
+
+            // the array pointers still refer to the old buffer, even if the new one gets the same name:
+            s_graphics.vertexFormatBufferId = 0u;
+            pBuffer->region = 0u;
+            pBuffer->offset = 0u;
+            return;
+        }
+        if( fence )
+        {
+            glDeleteSync( fence );
+            pBuffer->regionFences[ nextRegion ] = 0;
+        }
+    }
+    else if( nextRegion == 0u )
+    {
+        // give the driver a new buffer instead of waiting until the gpu is done with the old one:
+        bindArrayBuffer( pBuffer->bufferId );
+        glBufferDataARB( GL_ARRAY_BUFFER_ARB, DynamicBufferSize, 0, GL_STREAM_DRAW_ARB );
+        bindArrayBuffer( 0u );
+    }
+
+    pBuffer->region = nextRegion;
+    pBuffer->offset = nextRegion * DynamicRegionSize;
 }
 
 void graphics_resetState()
 {
     s_graphics.vertexFormat = VertexFormat_Count;
+    s_graphics.vertexFormatBufferId = 0u;
+    s_graphics.arrayBufferId = 0u;
     s_graphics.blendMode = BlendMode_Count;
     s_graphics.pRenderTarget = 0;
     s_graphics.pShader = 0;
 
     graphics_setVertexFormat( VertexFormat_None );
     graphics_setBlendMode( BlendMode_Disabled );
+
+    for( uint i = 0u; i < MaxTextureUnits; ++i )
+    {
+        glActiveTexture( GL_TEXTURE0 + i );
+        glBindTexture( GL_TEXTURE_2D, 0 );
+        if( s_graphics.hasSamplerObjects )
+        {
+            glBindSampler( i, 0 );
+        }
+        s_graphics.textureIds[ i ] = 0u;
+        s_graphics.samplers[ i ] = SamplerState_Count;
+    }
+    s_graphics.activeTextureUnit = MaxTextureUnits - 1u;
     
     glDisable( GL_DEPTH_TEST );
 }
@@ -41,82 +345,105 @@ void graphics_clear( float r, float g, float b, float a )
     glClear( GL_COLOR_BUFFER_BIT );
 }
 
+static void setVertex2d( Vertex2d* pVertex, float x, float y, float u, float v )
+{
+    pVertex->pos.x = x;
+    pVertex->pos.y = y;
+    pVertex->texCoord.x = u;
+    pVertex->texCoord.y = v;
+}
+
 void graphics_drawFullscreenQuad()
 {
-//    graphics_setVertexFormat( VertexFormat_None );
-    glBegin( GL_QUADS );
-        glTexCoord2f( 0.0, 0.0 );   glVertex2i( -1,  1 );
-        glTexCoord2f( 1.0, 0.0 );   glVertex2i(  1,  1 );
-        glTexCoord2f( 1.0, 1.0 );   glVertex2i(  1, -1 );
-        glTexCoord2f( 0.0, 1.0 );   glVertex2i( -1, -1 );
-    glEnd();
+    DynamicVertices vertices;
+    if( !graphics_allocDynamicVertices( &vertices, sizeof( Vertex2d ), 4u ) )
+    {
+        return;
+    }
+
+    Vertex2d* pVertices = (Vertex2d*)vertices.pData;
+    setVertex2d( &pVertices[ 0u ], -1.0f,  1.0f, 0.0f, 0.0f );
+    setVertex2d( &pVertices[ 1u ],  1.0f,  1.0f, 1.0f, 0.0f );
+    setVertex2d( &pVertices[ 2u ],  1.0f, -1.0f, 1.0f, 1.0f );
+    setVertex2d( &pVertices[ 3u ], -1.0f, -1.0f, 0.0f, 1.0f );
+    graphics_drawDynamicVertices( &vertices, VertexFormat_2d, PrimitiveType_TriangleFan );
 }
 
 void graphics_drawQuad( const float2* pVertices, float u0, float v0, float u1, float v1 )
 {
-    graphics_setVertexFormat( VertexFormat_None );
-    glBegin( GL_TRIANGLES );
-        glTexCoord2f( u0, v0 );   glVertex2f( pVertices[ 0u ].x, pVertices[ 0u ].y );
-        glTexCoord2f( u0, v1 );   glVertex2f( pVertices[ 1u ].x, pVertices[ 1u ].y );
-        glTexCoord2f( u1, v1 );   glVertex2f( pVertices[ 2u ].x, pVertices[ 2u ].y );
+    DynamicVertices vertices;
+    if( !graphics_allocDynamicVertices( &vertices, sizeof( Vertex2d ), 6u ) )
+    {
+        return;
+    }
 
-        glTexCoord2f( u0, v0 );   glVertex2f( pVertices[ 0u ].x, pVertices[ 0u ].y );
-        glTexCoord2f( u1, v1 );   glVertex2f( pVertices[ 2u ].x, pVertices[ 2u ].y );
-        glTexCoord2f( u1, v0 );   glVertex2f( pVertices[ 3u ].x, pVertices[ 3u ].y );
-    glEnd();
+    Vertex2d* pTarget = (Vertex2d*)vertices.pData;
+    setVertex2d( &pTarget[ 0u ], pVertices[ 0u ].x, pVertices[ 0u ].y, u0, v0 );
+    setVertex2d( &pTarget[ 1u ], pVertices[ 1u ].x, pVertices[ 1u ].y, u0, v1 );
+    setVertex2d( &pTarget[ 2u ], pVertices[ 2u ].x, pVertices[ 2u ].y, u1, v1 );
+
+    setVertex2d( &pTarget[ 3u ], pVertices[ 0u ].x, pVertices[ 0u ].y, u0, v0 );
+    setVertex2d( &pTarget[ 4u ], pVertices[ 2u ].x, pVertices[ 2u ].y, u1, v1 );
+    setVertex2d( &pTarget[ 5u ], pVertices[ 3u ].x, pVertices[ 3u ].y, u1, v0 );
+    graphics_drawDynamicVertices( &vertices, VertexFormat_2d, PrimitiveType_Triangles );
 }
 
 void graphics_drawCircle( const float2* pPos, float radius )
 {
-    glBegin( GL_TRIANGLE_FAN );
-        glVertex2f( pPos->x, pPos->y );
-        
-        const uint stepCount = 20u;
-        float t = 0.0f;
-        float dt = 2.0F * PI / (float)(stepCount-1u);
-        for( uint i=0u; i < stepCount;++i)
-        {
-            glVertex2f(pPos->x+radius*cosf(t), pPos->y+radius*sinf(t));
-            t += dt;
-        }
-        glVertex2f(pPos->x+radius,pPos->y+0.0f);
-    glEnd();
+    const uint stepCount = CircleStepCount;
+
+    DynamicVertices vertices;
+    if( !graphics_allocDynamicVertices( &vertices, sizeof( Vertex2d ), stepCount + 2u ) )
+    {
+        return;
+    }
+
+    Vertex2d* pVertices = (Vertex2d*)vertices.pData;
+    setVertex2d( &pVertices[ 0u ], pPos->x, pPos->y, 0.0f, 0.0f );
+
+    float t = 0.0f;
+    float dt = 2.0F * PI / (float)(stepCount-1u);
+    for( uint i=0u; i < stepCount;++i)
+    {
+        setVertex2d( &pVertices[ 1u + i ], pPos->x+radius*cosf(t), pPos->y+radius*sinf(t), 0.0f, 0.0f );
+        t += dt;
+    }
+    setVertex2d( &pVertices[ 1u + stepCount ], pPos->x+radius, pPos->y+0.0f, 0.0f, 0.0f );
+    graphics_drawDynamicVertices( &vertices, VertexFormat_2d, PrimitiveType_TriangleFan );
 }
 
 void graphics_setFsTexture( uint index, uint textureId, SamplerState sampler )
 {
     SYS_ASSERT( s_graphics.pShader );
+    SYS_ASSERT( index < MaxTextureUnits );
 
-    glUniform1i( s_graphics.pShader->ft[ index ], ( int )index );
-    glActiveTexture( GL_TEXTURE0 + index );
-    glBindTexture( GL_TEXTURE_2D, textureId );
-
-    switch( sampler )
+    const int isNewTexture = s_graphics.textureIds[ index ] != textureId;
+    if( isNewTexture )
     {
-    case SamplerState_ClampU_ClampV_Nearest:
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );        
-        break;
-    
-    case SamplerState_ClampU_ClampV_Trilinear:
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );  
-        break;
-
-    case SamplerState_MirrorU_MirrorV_Bilinear:
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );        
-        break;
+        setActiveTextureUnit( index );
+        glBindTexture( GL_TEXTURE_2D, textureId );
+        s_graphics.textureIds[ index ] = textureId;
+    }
 
-    default:
-        break;
+    if( s_graphics.hasSamplerObjects )
+    {
+        if( s_graphics.samplers[ index ] != sampler )
+        {
+            glBindSampler( index, s_graphics.samplerIds[ sampler ] );
+        }
     }
+    else if( isNewTexture || s_graphics.samplers[ index ] != sampler )
+    {
+        GLint wrap, filter;
+        getSamplerParameters( &wrap, &filter, sampler );
+
+        setActiveTextureUnit( index );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter );
+    }
+    s_graphics.samplers[ index ] = sampler;
 }
 
 void graphics_setRenderTarget( RenderTarget* pTarget )
@@ -154,11 +481,19 @@ void graphics_setFp4f( uint index, float x, float y, float z, float w )
 
 void graphics_setVertexFormat( VertexFormat format )
 {
-    if( format == s_graphics.vertexFormat )
+    // the array pointers have to be set again when a different buffer is bound:
+    if( format == s_graphics.vertexFormat && s_graphics.arrayBufferId == s_graphics.vertexFormatBufferId )
     {
         return;
     }
     
+    if( s_graphics.vertexFormat == VertexFormat_Stroke )
+    {
+        glDisableClientState( GL_COLOR_ARRAY );
+        glClientActiveTexture( GL_TEXTURE1 );
+        glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+    }
+
     switch( format )
     {
     case VertexFormat_None:
@@ -172,7 +507,20 @@ void graphics_setVertexFormat( VertexFormat format )
         glVertexPointer( 2, GL_FLOAT, sizeof( Vertex2d ), ( void* ) SYS_MEMBEROFFSET( Vertex2d, pos ) );
         glClientActiveTexture( GL_TEXTURE0 );
         glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-        glTexCoordPointer( 3, GL_FLOAT, sizeof( Vertex2d ), ( void* )SYS_MEMBEROFFSET( Vertex2d, texCoord ) );
+        glTexCoordPointer( 2, GL_FLOAT, sizeof( Vertex2d ), ( void* )SYS_MEMBEROFFSET( Vertex2d, texCoord ) );
+        break;
+
+    case VertexFormat_Stroke:
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glVertexPointer( 4, GL_FLOAT, sizeof( StrokeVertex ), ( void* )SYS_MEMBEROFFSET( StrokeVertex, point ) );
+        glEnableClientState( GL_COLOR_ARRAY );
+        glColorPointer( 3, GL_FLOAT, sizeof( StrokeVertex ), ( void* )SYS_MEMBEROFFSET( StrokeVertex, color ) );
+        glClientActiveTexture( GL_TEXTURE0 );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        glTexCoordPointer( 4, GL_FLOAT, sizeof( StrokeVertex ), ( void* )SYS_MEMBEROFFSET( StrokeVertex, arc ) );
+        glClientActiveTexture( GL_TEXTURE1 );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        glTexCoordPointer( 2, GL_FLOAT, sizeof( StrokeVertex ), ( void* )SYS_MEMBEROFFSET( StrokeVertex, pen ) );
         break;
 
     default:
@@ -181,6 +529,7 @@ void graphics_setVertexFormat( VertexFormat format )
     }
 
     s_graphics.vertexFormat = format;
+    s_graphics.vertexFormatBufferId = s_graphics.arrayBufferId;
 }
 
 void graphics_setBlendMode( BlendMode mode )
@@ -215,7 +564,7 @@ void graphics_createMesh2d( Mesh2d* pMesh, uint vertexCount, uint indexCount )
 	
     SYS_ASSERT( pMesh );
     glGenBuffersARB( 1, &pMesh->vertexBufferId );
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, pMesh->vertexBufferId );
+    bindArrayBuffer( pMesh->vertexBufferId );
     glBufferDataARB( GL_ARRAY_BUFFER_ARB, (GLsizeiptrARB)( sizeof( Vertex2d ) * vertexCount ), 0, GL_STATIC_DRAW_ARB );
 
     glGenBuffersARB( 1, &pMesh->indexBufferId );
@@ -225,7 +574,7 @@ void graphics_createMesh2d( Mesh2d* pMesh, uint vertexCount, uint indexCount )
     pMesh->vertexCount = vertexCount;
     pMesh->indexCount = indexCount;
     
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+    bindArrayBuffer( 0u );
     glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
 }
 
@@ -233,7 +582,7 @@ int graphics_lockMesh2d( Mesh2dLock* pLock, Mesh2d* pMesh )
 {
     SYS_ASSERT( pLock );
     SYS_ASSERT( pMesh );
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, pMesh->vertexBufferId );
+    bindArrayBuffer( pMesh->vertexBufferId );
     glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pMesh->indexBufferId );
     void* pVertexData = glMapBufferARB( GL_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB );
     void* pIndexData = glMapBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB );
@@ -249,25 +598,97 @@ int graphics_lockMesh2d( Mesh2dLock* pLock, Mesh2d* pMesh )
 
 void graphics_unlockMesh2d( Mesh2d* pMesh )
 {
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, pMesh->vertexBufferId );
+    bindArrayBuffer( pMesh->vertexBufferId );
     glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pMesh->indexBufferId );
     glUnmapBufferARB( GL_ARRAY_BUFFER_ARB );
     glUnmapBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB );
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+    bindArrayBuffer( 0u );
     glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
 }
 
 void graphics_drawMesh2d( const Mesh2d* pMesh )
 {
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, pMesh->vertexBufferId );
+    bindArrayBuffer( pMesh->vertexBufferId );
     glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pMesh->indexBufferId );
 
     graphics_setVertexFormat( VertexFormat_2d );
 
     glDrawElements( GL_TRIANGLES, ( int )pMesh->indexCount, GL_UNSIGNED_SHORT, 0 );
 
-    glBindBufferARB( GL_ARRAY_BUFFER_ARB, 0 );
+    bindArrayBuffer( 0u );
+    glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
+}
+
+void graphics_createStrokeMesh( StrokeMesh* pMesh, uint vertexCapacity, uint indexCapacity )
+{
+    pMesh->vertexCapacity = vertexCapacity;
+    pMesh->indexCapacity = indexCapacity;
+
+    glGenBuffersARB( 1, &pMesh->vertexBufferId );
+    bindArrayBuffer( pMesh->vertexBufferId );
+    glBufferDataARB( GL_ARRAY_BUFFER_ARB, (GLsizeiptrARB)( sizeof( StrokeVertex ) * vertexCapacity ), 0, GL_DYNAMIC_DRAW_ARB );
+    bindArrayBuffer( 0u );
+
+    glGenBuffersARB( 1, &pMesh->indexBufferId );
+    glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pMesh->indexBufferId );
+    glBufferDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, (GLsizeiptrARB)( sizeof( Index ) * indexCapacity ), 0, GL_DYNAMIC_DRAW_ARB );
+    glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
+}
+
+void graphics_destroyStrokeMesh( StrokeMesh* pMesh )
+{
+    glDeleteBuffersARB( 1, &pMesh->vertexBufferId );
+    glDeleteBuffersARB( 1, &pMesh->indexBufferId );
+    pMesh->vertexBufferId = 0u;
+    pMesh->indexBufferId = 0u;
+    pMesh->vertexCapacity = 0u;
+    pMesh->indexCapacity = 0u;
+}
+
+void graphics_writeStrokeMesh( StrokeMesh* pMesh, uint firstVertex, const StrokeVertex* pVertices, uint vertexCount, uint firstIndex, const Index* pIndices, uint indexCount )
+{
+    SYS_ASSERT( firstVertex + vertexCount <= pMesh->vertexCapacity );
+    SYS_ASSERT( firstIndex + indexCount <= pMesh->indexCapacity );
+    if( vertexCount == 0u )
+    {
+        return;
+    }
+
+    bindArrayBuffer( pMesh->vertexBufferId );
+    if( firstVertex == 0u )
+    {
+        // starting over: a new allocation doesn't have to wait for draws still using the old contents
+        glBufferDataARB( GL_ARRAY_BUFFER_ARB, (GLsizeiptrARB)( sizeof( StrokeVertex ) * pMesh->vertexCapacity ), 0, GL_DYNAMIC_DRAW_ARB );
+    }
+    glBufferSubDataARB( GL_ARRAY_BUFFER_ARB, (GLintptrARB)( sizeof( StrokeVertex ) * firstVertex ), (GLsizeiptrARB)( sizeof( StrokeVertex ) * vertexCount ), pVertices );
+    bindArrayBuffer( 0u );
+
+    if( indexCount == 0u )
+    {
+        return;
+    }
+
+    glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pMesh->indexBufferId );
+    if( firstIndex == 0u )
+    {
+        glBufferDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, (GLsizeiptrARB)( sizeof( Index ) * pMesh->indexCapacity ), 0, GL_DYNAMIC_DRAW_ARB );
+    }
+    glBufferSubDataARB( GL_ELEMENT_ARRAY_BUFFER_ARB, (GLintptrARB)( sizeof( Index ) * firstIndex ), (GLsizeiptrARB)( sizeof( Index ) * indexCount ), pIndices );
     glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
 }
 
+void graphics_drawStrokeMesh( const StrokeMesh* pMesh, uint firstIndex, uint indexCount )
+{
+    SYS_ASSERT( firstIndex + indexCount <= pMesh->indexCapacity );
+    if( indexCount == 0u )
+    {
+        return;
+    }
 
+    bindArrayBuffer( pMesh->vertexBufferId );
+    glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, pMesh->indexBufferId );
+    graphics_setVertexFormat( VertexFormat_Stroke );
+    glDrawElements( GL_TRIANGLES, ( int )indexCount, GL_UNSIGNED_SHORT, ( void* )( sizeof( Index ) * firstIndex ) );
+    bindArrayBuffer( 0u );
+    glBindBufferARB( GL_ELEMENT_ARRAY_BUFFER_ARB, 0 );
+}
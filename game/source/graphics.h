@@ -16,9 +16,17 @@ typedef enum
 {
     VertexFormat_None,
     VertexFormat_2d,
+    VertexFormat_Stroke,
     VertexFormat_Count
 } VertexFormat;
 
+typedef enum
+{
+    PrimitiveType_Triangles,
+    PrimitiveType_TriangleFan,
+    PrimitiveType_Count
+} PrimitiveType;
+
 typedef enum
 {
     SamplerState_ClampU_ClampV_Nearest,
@@ -33,6 +41,16 @@ typedef struct
     float2  texCoord;
 } Vertex2d;
 
+// one side of a stroke point. a segment is drawn from the two vertices of each end, so every point is uploaded
+// once and the pen shader only keeps the part of the page that is drawn in this frame
+typedef struct
+{
+    float4  point;      // position.xy normal.xy
+    float4  arc;        // point on the page, stroke start on the page, stroke length, side (1 or -1)
+    float2  pen;        // half pen width, variance
+    float3  color;
+} StrokeVertex;
+
 typedef uint16 Index;
 
 typedef struct
@@ -49,17 +67,42 @@ typedef struct
     Index*      pIndexData;
 } Mesh2dLock;
 
+typedef struct
+{
+    uint    vertexCapacity;
+    uint    indexCapacity;
+    uint    vertexBufferId;
+    uint    indexBufferId;
+} StrokeMesh;
+
+typedef struct
+{
+    void*   pData;          // write the vertices here before drawing them
+    uint    offset;         // bytes from the start of the dynamic buffer
+    uint    vertexSize;
+    uint    vertexCount;
+} DynamicVertices;
+
 
 void graphics_init();
 void graphics_done();
 
 void graphics_resetState();
 
+// the dynamic vertices of a frame are released for reuse by this without waiting for the gpu. call it once after the last draw of each frame
+void graphics_finishFrame();
+
+// the dynamic vertices of a frame have room for the most the renderer draws in one frame, asking for more asserts.
+// returns FALSE in that case if asserts are disabled. the vertices are only valid in the current frame
+int graphics_allocDynamicVertices( DynamicVertices* pVertices, uint vertexSize, uint vertexCount );
+void graphics_drawDynamicVertices( const DynamicVertices* pVertices, VertexFormat format, PrimitiveType primitiveType );
+
 void graphics_clear( float r, float g, float b, float a );
 void graphics_drawFullscreenQuad();
 void graphics_drawQuad( const float2* pVertices, float u0, float v0, float u1, float v1 );
 void graphics_drawCircle( const float2* pPos, float radius );
 
+
 void graphics_setRenderTarget( RenderTarget* pTarget );
 void graphics_setShader( Shader* pShader );
 
@@ -75,5 +118,11 @@ int graphics_lockMesh2d( Mesh2dLock* pLock, Mesh2d* pMesh );
 void graphics_unlockMesh2d( Mesh2d* pMesh );
 void graphics_drawMesh2d( const Mesh2d* pMesh );
 
+void graphics_createStrokeMesh( StrokeMesh* pMesh, uint vertexCapacity, uint indexCapacity );
+void graphics_destroyStrokeMesh( StrokeMesh* pMesh );
+void graphics_writeStrokeMesh( StrokeMesh* pMesh, uint firstVertex, const StrokeVertex* pVertices, uint vertexCount, uint firstIndex, const Index* pIndices, uint indexCount );
+// draws the triangles of indexCount indices starting at firstIndex
+void graphics_drawStrokeMesh( const StrokeMesh* pMesh, uint firstIndex, uint indexCount );
+
 #endif
 
@@ -0,0 +1,243 @@
+#include "jobsystem.h"
+#include "platform.h"
+#include "atomic.h"
+#include "debug.h"
+
+enum
+{
+	JobCacheLineSize		= 64u,
+	JobIdleSpinCount		= 64u,		// failed steals before an idle worker starts to sleep
+	JobMaxIdleSleepTime		= 1000000u	// ns
+};
+
+enum
+{
+	JobThread_Unregistered	= 0u,
+	JobThread_Ignored		= MaxJobThreads + 1u
+};
+
+typedef struct
+{
+	JobFunction		pFunction;
+	void*			pArgument;
+	uint			first;
+	uint			count;
+	JobCounter*		pCounter;
+} Job;
+
+// the owner pushes and pops at the bottom, thieves take from the top. both ends are short critical sections
+// behind a spin lock, so a deque is only ever contended by a steal
+typedef struct
+{
+	volatile uint32	lock;
+	uint32			top;
+	uint32			bottom;
+	Job				jobs[ JobQueueCapacity ];
+	uint8			padding[ JobCacheLineSize ];
+} JobQueue;
+
+typedef struct
+{
+	JobQueue		queues[ MaxJobThreads ];
+	volatile uint32	threadCount;		// registered queues
+	ThreadHandle	workers[ MaxJobWorkers ];
+	uint			workerCount;
+	volatile uint32	stopWorkers;
+} JobSystem;
+
+static JobSystem s_jobSystem;
+
+// the queue of the calling thread + 1
+static SYS_THREAD_LOCAL uint32 s_jobThreadIndex = JobThread_Unregistered;
+
+static void jobqueue_lock( JobQueue* pQueue )
+{
+	while( atomic_exchange( &pQueue->lock, 1u ) )
+	{
+		while( atomic_loadAcquire( &pQueue->lock ) )
+		{
+		}
+	}
+}
+
+static void jobqueue_unlock( JobQueue* pQueue )
+{
+	atomic_storeRelease( &pQueue->lock, 0u );
+}
+
+static int jobqueue_push( JobQueue* pQueue, const Job* pJob )
+{
+	jobqueue_lock( pQueue );
+	const int result = pQueue->bottom - pQueue->top < JobQueueCapacity;
+	if( result )
+	{
+		pQueue->jobs[ pQueue->bottom & ( JobQueueCapacity - 1u ) ] = *pJob;
+		pQueue->bottom++;
+	}
+	jobqueue_unlock( pQueue );
+	return result;
+}
+
+static int jobqueue_pop( JobQueue* pQueue, Job* pJob )
+{
+	jobqueue_lock( pQueue );
+	const int result = pQueue->bottom != pQueue->top;
+	if( result )
+	{
+		pQueue->bottom--;
+		*pJob = pQueue->jobs[ pQueue->bottom & ( JobQueueCapacity - 1u ) ];
+	}
+	jobqueue_unlock( pQueue );
+	return result;
+}
+
+static int jobqueue_steal( JobQueue* pQueue, Job* pJob )
+{
+	// a queue that is busy right now is skipped instead of waited for:
+	if( atomic_exchange( &pQueue->lock, 1u ) )
+	{
+		return FALSE;
+	}
+	const int result = pQueue->bottom != pQueue->top;
+	if( result )
+	{
+		*pJob = pQueue->jobs[ pQueue->top & ( JobQueueCapacity - 1u ) ];
+		pQueue->top++;
+	}
+	jobqueue_unlock( pQueue );
+	return result;
+}
+
+static JobQueue* jobsystem_getQueue()
+{
+	if( s_jobThreadIndex == JobThread_Unregistered )
+	{
+		const uint32 index = atomic_fetchAdd( &s_jobSystem.threadCount, 1u );
+		s_jobThreadIndex = index < MaxJobThreads ? index + 1u : JobThread_Ignored;
+	}
+
+	return s_jobThreadIndex != JobThread_Ignored ? &s_jobSystem.queues[ s_jobThreadIndex - 1u ] : NULL;
+}
+
+static void jobsystem_execute( const Job* pJob )
+{
+	pJob->pFunction( pJob->pArgument, pJob->first, pJob->count );
+	atomic_fetchAdd( &pJob->pCounter->count, 0xffffffffu );
+}
+
+// the newest own job or the oldest one of another thread. returns FALSE if there was nothing to do
+static int jobsystem_runOne( JobQueue* pOwnQueue )
+{
+	Job job;
+	if( pOwnQueue && jobqueue_pop( pOwnQueue, &job ) )
+	{
+		jobsystem_execute( &job );
+		return TRUE;
+	}
+
+	// start at the own neighbour, so the thieves don't all go for the same queue:
+	const uint threadCount = uint_min( atomic_loadAcquire( &s_jobSystem.threadCount ), MaxJobThreads );
+	const uint start = pOwnQueue ? (uint)( pOwnQueue - s_jobSystem.queues ) + 1u : 0u;
+	for( uint i = 0u; i < threadCount; ++i )
+	{
+		JobQueue* pQueue = &s_jobSystem.queues[ ( start + i ) % threadCount ];
+		if( pQueue != pOwnQueue && jobqueue_steal( pQueue, &job ) )
+		{
+			jobsystem_execute( &job );
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void jobsystem_workerThread( void* pArgument )
+{
+	SYS_USE_ARGUMENT( pArgument );
+
+	JobQueue* pQueue = jobsystem_getQueue();
+
+	uint idleCount = 0u;
+	while( !atomic_loadAcquire( &s_jobSystem.stopWorkers ) )
+	{
+		if( jobsystem_runOne( pQueue ) )
+		{
+			idleCount = 0u;
+		}
+		else if( ++idleCount > JobIdleSpinCount )
+		{
+			// there is no wake up signal, an idle worker polls slower and slower. the waiting thread runs the jobs meanwhile
+			const uint sleepTime = uint_min( ( idleCount - JobIdleSpinCount ) * 10000u, JobMaxIdleSleepTime );
+			sys_sleepUntil( sys_getTime() + sleepTime );
+		}
+	}
+}
+
+void jobsystem_init( uint workerCount )
+{
+	s_jobSystem.stopWorkers = 0u;
+	s_jobSystem.workerCount = uint_min( workerCount, MaxJobWorkers );
+	for( uint i = 0u; i < s_jobSystem.workerCount; ++i )
+	{
+		s_jobSystem.workers[ i ] = sys_createThread( jobsystem_workerThread, NULL );
+	}
+}
+
+void jobsystem_done()
+{
+	atomic_storeRelease( &s_jobSystem.stopWorkers, 1u );
+	for( uint i = 0u; i < s_jobSystem.workerCount; ++i )
+	{
+		sys_joinThread( s_jobSystem.workers[ i ] );
+	}
+	s_jobSystem.workerCount = 0u;
+}
+
+uint jobsystem_getThreadCount()
+{
+	return s_jobSystem.workerCount + 1u;
+}
+
+void jobsystem_run( JobFunction pFunction, void* pArgument, uint first, uint count, JobCounter* pCounter )
+{
+	Job job;
+	job.pFunction	= pFunction;
+	job.pArgument	= pArgument;
+	job.first		= first;
+	job.count		= count;
+	job.pCounter	= pCounter;
+
+	atomic_fetchAdd( &pCounter->count, 1u );
+
+	JobQueue* pQueue = jobsystem_getQueue();
+	if( !pQueue || !jobqueue_push( pQueue, &job ) )
+	{
+		jobsystem_execute( &job );
+	}
+}
+
+void jobsystem_wait( JobCounter* pCounter )
+{
+	JobQueue* pQueue = jobsystem_getQueue();
+	while( atomic_loadAcquire( &pCounter->count ) != 0u )
+	{
+		// the last jobs of the counter may be running on other threads, nothing left to help with then:
+		jobsystem_runOne( pQueue );
+	}
+}
+
+void jobsystem_parallelFor( JobFunction pFunction, void* pArgument, uint count )
+{
+	const uint jobCount = uint_min( count, jobsystem_getThreadCount() * JobsPerThread );
+
+	JobCounter counter;
+	counter.count = 0u;
+
+	uint first = 0u;
+	for( uint i = 0u; i < jobCount; ++i )
+	{
+		const uint end = ( count * ( i + 1u ) ) / jobCount;
+		jobsystem_run( pFunction, pArgument, first, end - first, &counter );
+		first = end;
+	}
+	jobsystem_wait( &counter );
+}
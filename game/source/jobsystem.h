@@ -0,0 +1,39 @@
+#ifndef JOBSYSTEM_H_INCLUDED
+#define JOBSYSTEM_H_INCLUDED
+
+#include "types.h"
+
+// a small work stealing scheduler: every thread that queues jobs gets its own deque, it takes the newest job
+// from there while idle threads steal the oldest. a thread waiting for a counter runs jobs instead of blocking,
+// so the jobs of a batch always finish (even without any workers)
+enum
+{
+	MaxJobWorkers			= 8u,
+	MaxJobThreads			= MaxJobWorkers + 8u,	// workers plus the threads that queue jobs
+	JobQueueCapacity		= 256u,					// per thread, has to be a power of two. a full queue runs the job right away
+	JobsPerThread			= 4u					// parallelFor splits into this many jobs per thread
+};
+
+typedef void ( *JobFunction )( void* pArgument, uint first, uint count );
+
+// the number of unfinished jobs of a batch. starts at zero, the jobs add to it when they are queued
+typedef struct
+{
+	volatile uint32		count;
+} JobCounter;
+
+void	jobsystem_init( uint workerCount );
+void	jobsystem_done();
+
+// the number of threads that can run jobs at the same time: the workers and the calling thread
+uint	jobsystem_getThreadCount();
+
+void	jobsystem_run( JobFunction pFunction, void* pArgument, uint first, uint count, JobCounter* pCounter );
+
+// runs queued jobs until the counter is zero
+void	jobsystem_wait( JobCounter* pCounter );
+
+// calls pFunction on ranges that cover [0,count) and waits for all of them
+void	jobsystem_parallelFor( JobFunction pFunction, void* pArgument, uint count );
+
+#endif
@@ -0,0 +1,259 @@
+#include "level.h"
+#include "platform.h"
+#include "vector.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct
+{
+	char			fileName[ 64u ];
+	const void*		pData;
+	uint			size;
+	const World*	pWorld;			// validated once when the file is mapped
+	uint			refCount;
+} MappedLevel;
+
+static MappedLevel s_levels[ MaxMappedLevels ];
+
+static int level_areObstaclesValid( const World* pWorld )
+{
+	for( uint i = 0u; i < pWorld->obstacleCount; ++i )
+	{
+		const uint shape = pWorld->obstacleShape[ i ];
+		switch( pWorld->obstacleType[ i ] )
+		{
+		case ObstacleType_Circle:
+			if( shape >= pWorld->circleCount )
+			{
+				return FALSE;
+			}
+			break;
+
+		case ObstacleType_Capsule:
+			if( shape >= pWorld->capsuleCount )
+			{
+				return FALSE;
+			}
+			break;
+
+		case ObstacleType_Polygon:
+			if( shape >= pWorld->polygonCount )
+			{
+				return FALSE;
+			}
+			break;
+
+		default:
+			return FALSE;
+		}
+	}
+
+	for( uint i = 0u; i < pWorld->polygonCount; ++i )
+	{
+		if( pWorld->polygons[ i ].vertexCount < 3u || pWorld->polygons[ i ].vertexCount > MaxPolygonVertices )
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// walks the whole tree like a query that hits every node: every node has to be reached exactly once (no cycles or
+// shared children), the traversal stack must not overflow and the leaves may only reference valid obstacles
+static int level_isBvhValid( const World* pWorld )
+{
+	for( uint i = 0u; i < pWorld->obstacleCount; ++i )
+	{
+		if( pWorld->bvhObstacles[ i ] >= pWorld->obstacleCount )
+		{
+			return FALSE;
+		}
+	}
+
+	if( pWorld->bvhNodeCount == 0u )
+	{
+		return TRUE;
+	}
+
+	uint8 isReached[ MaxWorldBvhNodes ];
+	memset( isReached, 0, sizeof( isReached ) );
+
+	uint16 stack[ WorldBvhStackSize ];
+	uint stackSize = 0u;
+	stack[ stackSize++ ] = 0u;
+	isReached[ 0u ] = TRUE;
+	uint reachedCount = 1u;
+	while( stackSize > 0u )
+	{
+		const WorldBvhNode* pNode = &pWorld->bvhNodes[ stack[ --stackSize ] ];
+		if( pNode->count > 0u )
+		{
+			if( (uint)pNode->first + pNode->count > pWorld->obstacleCount )
+			{
+				return FALSE;
+			}
+			continue;
+		}
+
+		const uint child = pNode->first;
+		if( child + 1u >= pWorld->bvhNodeCount || isReached[ child ] || isReached[ child + 1u ] || stackSize + 2u > SYS_COUNTOF( stack ) )
+		{
+			return FALSE;
+		}
+		isReached[ child ] = TRUE;
+		isReached[ child + 1u ] = TRUE;
+		reachedCount += 2u;
+		stack[ stackSize++ ] = (uint16)( child + 1u );
+		stack[ stackSize++ ] = (uint16)child;
+	}
+	return reachedCount == pWorld->bvhNodeCount;
+}
+
+const World* level_getWorld( const void* pData, uint size )
+{
+	if( size < LevelFileWorldOffset + sizeof( World ) )
+	{
+		return 0;
+	}
+
+	const LevelFileHeader* pHeader = (const LevelFileHeader*)pData;
+	if( pHeader->magic != LevelFileMagic || pHeader->version != LevelFileVersion ||
+		pHeader->worldOffset != LevelFileWorldOffset || pHeader->worldSize != sizeof( World ) )
+	{
+		return 0;
+	}
+
+	// every count and index is checked so that a broken file can't make the queries read outside of the world:
+	const World* pWorld = (const World*)( (const uint8*)pData + pHeader->worldOffset );
+	if( pWorld->obstacleCount > MaxWorldObstacles || pWorld->circleCount > MaxWorldObstacles ||
+		pWorld->capsuleCount > MaxWorldObstacles || pWorld->polygonCount > MaxWorldPolygons ||
+		pWorld->bvhNodeCount > MaxWorldBvhNodes || pWorld->spawnPointCount > MaxWorldSpawnPoints ||
+		pWorld->itemSiteCount > MaxWorldItemSites || pWorld->freeCellCount > MaxWorldFreeCells )
+	{
+		return 0;
+	}
+
+	if( !level_areObstaclesValid( pWorld ) || !level_isBvhValid( pWorld ) )
+	{
+		return 0;
+	}
+
+	return pWorld;
+}
+
+void level_buildArena( World* pWorld )
+{
+	float2 borderMin;
+	float2_set( &borderMin, -20.0f, -20.0f );
+	float2 borderMax;
+	float2_set( &borderMax,  20.0f,  20.0f );
+	world_init( pWorld, &borderMin, &borderMax );
+
+	const Circle rocks[] =
+	{
+		{ { -10.0f, -10.0f }, 2.5f },
+		{ {  10.0f, -10.0f }, 2.5f },
+		{ {  10.0f,  10.0f }, 2.5f },
+		{ { -10.0f,  10.0f }, 2.5f }
+	};
+	for( uint i = 0u; i < SYS_COUNTOF( rocks ); ++i )
+	{
+		world_addCircle( pWorld, &rocks[ i ] );
+	}
+	world_build( pWorld );
+}
+
+int level_write( const World* pWorld, const char* pFileName )
+{
+	uint8 header[ LevelFileWorldOffset ];
+	memset( header, 0, sizeof( header ) );
+
+	LevelFileHeader* pHeader = (LevelFileHeader*)header;
+	pHeader->magic			= LevelFileMagic;
+	pHeader->version		= LevelFileVersion;
+	pHeader->worldOffset	= LevelFileWorldOffset;
+	pHeader->worldSize		= sizeof( World );
+
+	FILE* pFile = fopen( pFileName, "wb" );
+	if( !pFile )
+	{
+		SYS_TRACE_ERROR( "Could not open file '%s'\n", pFileName );
+		return FALSE;
+	}
+
+	const int result = fwrite( header, sizeof( header ), 1u, pFile ) == 1u && fwrite( pWorld, sizeof( World ), 1u, pFile ) == 1u;
+	fclose( pFile );
+	return result;
+}
+
+const World* level_acquire( const char* pFileName )
+{
+	MappedLevel* pFreeLevel = 0;
+	for( uint i = 0u; i < SYS_COUNTOF( s_levels ); ++i )
+	{
+		MappedLevel* pLevel = &s_levels[ i ];
+		if( pLevel->refCount == 0u )
+		{
+			pFreeLevel = pFreeLevel ? pFreeLevel : pLevel;
+		}
+		else if( strcmp( pLevel->fileName, pFileName ) == 0 )
+		{
+			pLevel->refCount++;
+			return pLevel->pWorld;
+		}
+	}
+
+	if( !pFreeLevel )
+	{
+		SYS_TRACE_WARNING( "too many mapped levels!\n" );
+		return 0;
+	}
+	if( strlen( pFileName ) >= sizeof( pFreeLevel->fileName ) )
+	{
+		SYS_TRACE_WARNING( "level file name '%s' is too long\n", pFileName );
+		return 0;
+	}
+
+	uint size = 0u;
+	const void* pData = sys_mapFile( pFileName, &size );
+	if( !pData )
+	{
+		return 0;
+	}
+
+	const World* pWorld = level_getWorld( pData, size );
+	if( !pWorld )
+	{
+		SYS_TRACE_WARNING( "'%s' is not a valid level file (version %u)\n", pFileName, LevelFileVersion );
+		sys_unmapFile( pData, size );
+		return 0;
+	}
+
+	copyString( pFreeLevel->fileName, sizeof( pFreeLevel->fileName ), pFileName );
+	pFreeLevel->pData		= pData;
+	pFreeLevel->size		= size;
+	pFreeLevel->pWorld		= pWorld;
+	pFreeLevel->refCount	= 1u;
+	return pWorld;
+}
+
+void level_release( const World* pWorld )
+{
+	for( uint i = 0u; i < SYS_COUNTOF( s_levels ); ++i )
+	{
+		MappedLevel* pLevel = &s_levels[ i ];
+		if( pLevel->refCount > 0u && pLevel->pWorld == pWorld )
+		{
+			if( --pLevel->refCount == 0u )
+			{
+				sys_unmapFile( pLevel->pData, pLevel->size );
+				pLevel->pData	= 0;
+				pLevel->pWorld	= 0;
+			}
+			return;
+		}
+	}
+	SYS_TRACE_WARNING( "released world is not a mapped level!\n" );
+}
@@ -0,0 +1,40 @@
+#ifndef LEVEL_H_INCLUDED
+#define LEVEL_H_INCLUDED
+
+#include "types.h"
+#include "world.h"
+
+// a level file is a header followed by the raw World image. the world has no pointers and fixed capacities,
+// so a mapped file is used as it is: loading is one mmap and the cost doesn't depend on the level size
+enum
+{
+	LevelFileMagic			= 0x4c564c50u,		// 'PLVL' on little endian machines, files from other byte orders fail the check
+	LevelFileVersion		= 2u,				// has to be bumped for every change to the World layout
+	LevelFileWorldOffset	= 64u,
+	MaxMappedLevels			= 8u
+};
+
+static const char s_arenaLevelFileName[] = "./level/arena.lvl";
+
+typedef struct
+{
+	uint32	magic;
+	uint32	version;
+	uint32	worldOffset;
+	uint32	worldSize;		// sizeof( World ) of the writer
+} LevelFileHeader;
+
+// returns the world inside the file data (no copy) or 0 if the data isn't a level of this version
+const World*	level_getWorld( const void* pData, uint size );
+
+// the built in arena, used when there is no level file
+void			level_buildArena( World* pWorld );
+
+int				level_write( const World* pWorld, const char* pFileName );
+
+// the first acquire of a file maps it, later ones share that mapping (e.g. all matches on the same level).
+// every acquire needs a release, the last one unmaps the file. only call these from one thread
+const World*	level_acquire( const char* pFileName );
+void			level_release( const World* pWorld );
+
+#endif
@@ -6,14 +6,36 @@
 
 #include "renderer.h"
 #include "font.h"
+#include "platform.h"
+#include "bot.h"
+#include "server.h"
+#include "jobsystem.h"
+#include "level.h"
+#include "atomic.h"
+#include "framepacer.h"
+#include "profile.h"
+#include "trace.h"
 
 #include <GL/gl.h>
 #include <GL/glext.h>
+#include <GL/glx.h>
+#include <X11/Xlib.h>
 #include <SDL/SDL.h>
 #include <sys/soundcard.h>
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
 
 #ifndef SYS_BUILD_MASTER
 //#   define TEST_RENDERER
@@ -34,6 +56,7 @@ static uint s_callbackCount=0u;
 static void soundCallback( void* pUserData, Uint8* pStream, int size )
 {
     SYS_USE_ARGUMENT( pUserData );
+    SYS_PROFILE_THREAD_NAME( "sound" );
 s_callbackCount++;
     SYS_ASSERT( size >= 0 );
 
@@ -54,16 +77,17 @@ s_callbackCount++;
     }
 }
 
-void sys_trace( const char* pFormat, ... )
+void sys_writeTrace( const char* pText )
 {
-    va_list arg_list;
-    va_start( arg_list, pFormat );
-    vprintf( pFormat, arg_list );
-    va_end( arg_list );
+    fputs( pText, stdout );
 }
 
 void sys_exit( int exitcode ) 
 {
+#ifdef SYS_TRACE_ENABLED
+    // the message that explains the exit is probably still queued:
+    trace_flush();
+#endif
     exit( exitcode );
 }
 
@@ -77,6 +101,91 @@ int sys_getScreenHeight()
     return ScreenHeight;
 }
 
+const void* sys_mapFile( const char* pFileName, uint* pSize )
+{
+    const int file = open( pFileName, O_RDONLY );
+    if( file < 0 )
+    {
+        return 0;
+    }
+
+    struct stat fileStat;
+    if( fstat( file, &fileStat ) != 0 || fileStat.st_size <= 0 || (uint64)fileStat.st_size > 0xffffffffu )
+    {
+        close( file );
+        return 0;
+    }
+
+    // the mapping stays valid after the file is closed. clean pages are shared with every other mapping of the file:
+    const size_t size = (size_t)fileStat.st_size;
+    void* pData = mmap( 0, size, PROT_READ, MAP_SHARED, file, 0 );
+    close( file );
+    if( pData == MAP_FAILED )
+    {
+        return 0;
+    }
+
+    *pSize = (uint)size;
+    return pData;
+}
+
+void sys_unmapFile( const void* pData, uint size )
+{
+    munmap( (void*)(uintptr_t)pData, size );
+}
+
+typedef struct
+{
+    ThreadFunction  pFunction;
+    void*           pArgument;
+} ThreadStart;
+
+static void* threadStartFunction( void* pUserData )
+{
+    const ThreadStart start = *( ThreadStart* )pUserData;
+    free( pUserData );
+    start.pFunction( start.pArgument );
+    return NULL;
+}
+
+ThreadHandle sys_createThread( ThreadFunction pFunction, void* pArgument )
+{
+    ThreadStart* pStart = ( ThreadStart* )malloc( sizeof( ThreadStart ) );
+    pStart->pFunction   = pFunction;
+    pStart->pArgument   = pArgument;
+
+    pthread_t thread;
+    if( pthread_create( &thread, NULL, threadStartFunction, pStart ) != 0 )
+    {
+        SYS_BREAK( "pthread_create failed!\n" );
+    }
+    return ( ThreadHandle )thread;
+}
+
+void sys_joinThread( ThreadHandle thread )
+{
+    pthread_join( ( pthread_t )thread, NULL );
+}
+
+uint64 sys_getTime()
+{
+    struct timespec time;
+    clock_gettime( CLOCK_MONOTONIC, &time );
+    return ( uint64 )time.tv_sec * 1000000000u + ( uint64 )time.tv_nsec;
+}
+
+void sys_sleepUntil( uint64 time )
+{
+    struct timespec wakeTime;
+    wakeTime.tv_sec     = ( time_t )( time / 1000000000u );
+    wakeTime.tv_nsec    = ( long )( time % 1000000000u );
+
+    // the absolute wake time stays the same if a signal interrupts the sleep:
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, NULL ) == EINTR )
+    {
+    }
+}
+
 static void updateButtonMask( uint32* pButtonMask, uint32 button, int isDown )
 {
     uint32 buttonMask = *pButtonMask;
@@ -105,8 +214,476 @@ static void updateButtonMaskFromJoystick( uint32* pButtonMask, uint32 button, in
     *pButtonMask = buttonMask;
 }
 
-int main()
+enum
+{
+    // a match has room for MaxPlayer players (a snapshot carries all of them). the headless modes run many matches, each
+    // on its own port after NetworkPort. against a host its own player takes one of the slots of the first match
+    MaxHeadlessMatches  = 256u,
+    MaxBots             = MaxHeadlessMatches * MaxPlayer,
+    MaxLateServerTicks  = 5u
+};
+
+typedef struct
+{
+    Bot*                pBots;
+    FlowField*          pFlowFields;        // one per match
+} BotThinkJob;
+
+static Bot                      s_bots[ MaxBots ];
+static FlowField                s_botFlowFields[ MaxHeadlessMatches ];     // shared by the bots of a match
+static Server                   s_servers[ MaxHeadlessMatches ];
+static volatile sig_atomic_t    s_stopHeadless = 0;
+
+static void stopHeadless( int signalNumber )
+{
+    (void)signalNumber;
+    s_stopHeadless = 1;
+}
+
+static World s_arenaWorld;     // the built in arena, if there is no level file
+
+// the arena the server plays on: the level file, or the built in one if there is no file
+static const World* acquireArenaWorld()
+{
+    const World* pWorld = level_acquire( s_arenaLevelFileName );
+    if( !pWorld )
+    {
+        level_buildArena( &s_arenaWorld );
+        pWorld = &s_arenaWorld;
+    }
+    return pWorld;
+}
+
+static void releaseArenaWorld( const World* pWorld )
+{
+    if( pWorld != &s_arenaWorld )
+    {
+        level_release( pWorld );
+    }
+}
+
+static void botFieldJob( void* pArgument, uint first, uint count )
+{
+    const BotThinkJob* pJob = ( const BotThinkJob* )pArgument;
+    for( uint i = first; i < first + count; ++i )
+    {
+        flowfield_update( &pJob->pFlowFields[ i ], &pJob->pBots[ i * MaxPlayer ].client.gameState );
+    }
+}
+
+static void botThinkJob( void* pArgument, uint first, uint count )
+{
+    const BotThinkJob* pJob = ( const BotThinkJob* )pArgument;
+    for( uint i = first; i < first + count; ++i )
+    {
+        bot_think( &pJob->pBots[ i ], &pJob->pFlowFields[ i / MaxPlayer ] );
+    }
+}
+
+// paperbomb -bots <count> [server ip] [threads]: headless bot clients for load tests, runs until ctrl-c.
+// every MaxPlayer bots fill one match, the first one plays on NetworkPort, the next ones on the ports after it
+static int runBots( int argc, char** argv )
+{
+    const uint botCount     = argc > 2 ? (uint)atoi( argv[ 2 ] ) : 1u;
+    if( botCount > MaxBots )
+    {
+        SYS_TRACE_ERROR( "at most %u bots are supported, not %u\n", MaxBots, botCount );
+        return 1;
+    }
+    const uint matchCount   = ( botCount + MaxPlayer - 1u ) / MaxPlayer;
+    const char* pServerIP   = argc > 3 ? argv[ 3 ] : "127.0.0.1";
+    const uint threadCount  = uint_max( 1u, uint_min( argc > 4 ? (uint)atoi( argv[ 4 ] ) : 4u, MaxJobWorkers + 1u ) );
+
+    SYS_TRACE_DEBUG( "running %u bots in %u matches on %u threads against %s\n", botCount, matchCount, threadCount, pServerIP );
+    signal( SIGINT, stopHeadless );
+    signal( SIGTERM, stopHeadless );
+
+    // the bots navigate on the same level as the server:
+    const World* pWorld = acquireArenaWorld();
+
+    // the main thread does all the networking (the socket backend state is per thread), the decisions are jobs:
+    jobsystem_init( threadCount - 1u );
+    for( uint i = 0u; i < botCount; ++i )
+    {
+        IP4Address serverAddress;
+        serverAddress.address   = socket_parseIP( pServerIP );
+        serverAddress.port      = ( uint16 )( NetworkPort + i / MaxPlayer );
+        bot_create( &s_bots[ i ], &serverAddress, i );
+    }
+    for( uint i = 0u; i < matchCount; ++i )
+    {
+        flowfield_init( &s_botFlowFields[ i ], pWorld );
+    }
+
+    BotThinkJob thinkJob;
+    thinkJob.pBots          = s_bots;
+    thinkJob.pFlowFields    = s_botFlowFields;
+
+    const uint64 tickTime = 1000000000u / ClientTickRate;
+    uint64 nextTime = sys_getTime();
+    while( !s_stopHeadless )
+    {
+        jobsystem_parallelFor( botFieldJob, &thinkJob, matchCount );
+        jobsystem_parallelFor( botThinkJob, &thinkJob, botCount );
+        for( uint i = 0u; i < botCount; ++i )
+        {
+            bot_update( &s_bots[ i ] );
+        }
+
+        nextTime += tickTime;
+        sys_sleepUntil( nextTime );
+    }
+
+    for( uint i = 0u; i < botCount; ++i )
+    {
+        bot_destroy( &s_bots[ i ] );
+    }
+    jobsystem_done();
+
+    releaseArenaWorld( pWorld );
+    return 0;
+}
+
+typedef struct
+{
+    Server*         pServers;
+    const World*    pWorld;
+} ServerTickJob;
+
+static void serverTickJob( void* pArgument, uint first, uint count )
+{
+    const ServerTickJob* pJob = ( const ServerTickJob* )pArgument;
+    for( uint i = first; i < first + count; ++i )
+    {
+        server_tick( &pJob->pServers[ i ].gameState, pJob->pWorld );
+    }
+}
+
+// paperbomb -servers <count> [threads]: headless servers for load tests with -bots, runs until ctrl-c. server i hosts
+// one match on NetworkPort + i
+static int runServers( int argc, char** argv )
+{
+    const uint serverCount = argc > 2 ? (uint)atoi( argv[ 2 ] ) : 1u;
+    if( serverCount == 0u || serverCount > MaxHeadlessMatches )
+    {
+        SYS_TRACE_ERROR( "between 1 and %u servers are supported, not %u\n", MaxHeadlessMatches, serverCount );
+        return 1;
+    }
+    const uint threadCount = uint_max( 1u, uint_min( argc > 3 ? (uint)atoi( argv[ 3 ] ) : 4u, MaxJobWorkers + 1u ) );
+
+    SYS_TRACE_DEBUG( "running %u servers on ports %u to %u on %u threads\n", serverCount, NetworkPort, NetworkPort + serverCount - 1u, threadCount );
+    signal( SIGINT, stopHeadless );
+    signal( SIGTERM, stopHeadless );
+
+    const World* pWorld = acquireArenaWorld();
+
+    // the main thread does all the networking (the socket backend state is per thread), the matches tick as jobs:
+    jobsystem_init( threadCount - 1u );
+    for( uint i = 0u; i < serverCount; ++i )
+    {
+        server_create( &s_servers[ i ], ( uint16 )( NetworkPort + i ), ServerTickRate );
+    }
+
+    ServerTickJob tickJob;
+    tickJob.pServers    = s_servers;
+    tickJob.pWorld      = pWorld;
+
+    const uint64 tickTime = 1000000000u / ServerTickRate;
+    uint64 nextTime = sys_getTime();
+    while( !s_stopHeadless )
+    {
+        for( uint i = 0u; i < serverCount; ++i )
+        {
+            server_receive( &s_servers[ i ], pWorld );
+        }
+        jobsystem_parallelFor( serverTickJob, &tickJob, serverCount );
+        for( uint i = 0u; i < serverCount; ++i )
+        {
+            server_send( &s_servers[ i ] );
+        }
+
+        nextTime += tickTime;
+        const uint64 currentTime = sys_getTime();
+        if( currentTime > nextTime + MaxLateServerTicks * tickTime )
+        {
+            // the servers are overloaded: drop the missed ticks instead of running them back to back
+            nextTime = currentTime;
+        }
+        sys_sleepUntil( nextTime );
+    }
+
+    for( uint i = 0u; i < serverCount; ++i )
+    {
+        server_destroy( &s_servers[ i ] );
+    }
+    jobsystem_done();
+
+    releaseArenaWorld( pWorld );
+    return 0;
+}
+
+enum
+{
+    MaxReplayFrames     = 1u << 16u     // the frames after these are played but not measured
+};
+
+typedef enum
+{
+    ReplayTiming_Simulation,
+    ReplayTiming_Tessellation,
+    ReplayTiming_Submission,
+    ReplayTiming_Total,
+    ReplayTiming_Count
+} ReplayTiming;
+
+static uint32 s_replayFrameTimes[ ReplayTiming_Count ][ MaxReplayFrames ];     // ns
+
+static int compareFrameTimes( const void* pA, const void* pB )
+{
+    const uint32 a = *( const uint32* )pA;
+    const uint32 b = *( const uint32* )pB;
+    return ( a > b ) - ( a < b );
+}
+
+// paperbomb -replay <file>: plays a recorded match (see -record) with fixed time steps as fast as possible and prints the cpu
+// time per frame. renders into an offscreen pbuffer, so there is no window but it still needs an x server (xvfb is fine)
+static int runReplay( const char* pFileName )
+{
+    Display* pDisplay = XOpenDisplay( NULL );
+    if( !pDisplay )
+    {
+        SYS_TRACE_ERROR( "could not open the x display\n" );
+        return 1;
+    }
+
+    const int configAttributes[] =
+    {
+        GLX_DRAWABLE_TYPE,  GLX_PBUFFER_BIT,
+        GLX_RENDER_TYPE,    GLX_RGBA_BIT,
+        GLX_RED_SIZE,       8,
+        GLX_GREEN_SIZE,     8,
+        GLX_BLUE_SIZE,      8,
+        GLX_ALPHA_SIZE,     8,
+        None
+    };
+    int configCount = 0;
+    GLXFBConfig* pConfigs = glXChooseFBConfig( pDisplay, DefaultScreen( pDisplay ), configAttributes, &configCount );
+    if( !pConfigs || configCount == 0 )
+    {
+        SYS_TRACE_ERROR( "no pbuffer config\n" );
+        XCloseDisplay( pDisplay );
+        return 1;
+    }
+
+    const int pbufferAttributes[] =
+    {
+        GLX_PBUFFER_WIDTH,  ScreenWidth,
+        GLX_PBUFFER_HEIGHT, ScreenHeight,
+        None
+    };
+    const GLXPbuffer pbuffer = glXCreatePbuffer( pDisplay, pConfigs[ 0u ], pbufferAttributes );
+    const GLXContext glContext = pbuffer != None ? glXCreateNewContext( pDisplay, pConfigs[ 0u ], GLX_RGBA_TYPE, NULL, True ) : NULL;
+    XFree( pConfigs );
+    if( !glContext || !glXMakeContextCurrent( pDisplay, pbuffer, pbuffer, glContext ) )
+    {
+        SYS_TRACE_ERROR( "could not create the offscreen gl context\n" );
+        if( glContext )
+        {
+            glXDestroyContext( pDisplay, glContext );
+        }
+        if( pbuffer != None )
+        {
+            glXDestroyPbuffer( pDisplay, pbuffer );
+        }
+        XCloseDisplay( pDisplay );
+        return 1;
+    }
+
+    game_init();
+    if( !game_startReplay( pFileName ) )
+    {
+        SYS_TRACE_ERROR( "could not load replay '%s'\n", pFileName );
+        game_done();
+        glXMakeContextCurrent( pDisplay, None, None, NULL );
+        glXDestroyContext( pDisplay, glContext );
+        glXDestroyPbuffer( pDisplay, pbuffer );
+        XCloseDisplay( pDisplay );
+        return 1;
+    }
+    game_initRender();
+
+    uint frameCount = 0u;
+    while( !game_isReplayDone() )
+    {
+        GameInput gameInput;
+        memset( &gameInput, 0u, sizeof( gameInput ) );
+        gameInput.timeStep = GAMETIMESTEP;
+
+        const uint64 startTime = sys_getTime();
+        game_update( &gameInput );
+        const uint64 simulationTime = sys_getTime() - startTime;
+
+        game_render( GAMETIMESTEP );
+
+        // the gpu finishes outside of the measured time, otherwise a full queue blocks some random later frame:
+        glFinish();
+
+        if( frameCount < MaxReplayFrames )
+        {
+            const GameRenderTimings* pTimings = game_getRenderTimings();
+            s_replayFrameTimes[ ReplayTiming_Simulation ][ frameCount ]     = ( uint32 )simulationTime;
+            s_replayFrameTimes[ ReplayTiming_Tessellation ][ frameCount ]   = ( uint32 )pTimings->tessellationTime;
+            s_replayFrameTimes[ ReplayTiming_Submission ][ frameCount ]     = ( uint32 )pTimings->submissionTime;
+            s_replayFrameTimes[ ReplayTiming_Total ][ frameCount ]          = ( uint32 )( simulationTime + pTimings->tessellationTime + pTimings->submissionTime );
+            frameCount++;
+        }
+    }
+
+    game_doneRender();
+    game_done();
+
+    glXMakeContextCurrent( pDisplay, None, None, NULL );
+    glXDestroyContext( pDisplay, glContext );
+    glXDestroyPbuffer( pDisplay, pbuffer );
+    XCloseDisplay( pDisplay );
+
+    const uint desyncTick = game_getReplayDesyncTick();
+    if( desyncTick != 0u )
+    {
+        printf( "%s: the simulation doesn't match the recording at tick %u\n", pFileName, desyncTick );
+    }
+
+    static const char* s_timingNames[ ReplayTiming_Count ] = { "simulation", "tessellation", "submission", "total" };
+    printf( "%s: %u frames, cpu time per frame in ms\n", pFileName, frameCount );
+    printf( "%-14s %9s %9s %9s %9s\n", "", "avg", "median", "p99", "max" );
+    for( uint i = 0u; i < ReplayTiming_Count && frameCount > 0u; ++i )
+    {
+        uint32* pTimes = s_replayFrameTimes[ i ];
+        uint64 sum = 0u;
+        for( uint j = 0u; j < frameCount; ++j )
+        {
+            sum += pTimes[ j ];
+        }
+        qsort( pTimes, frameCount, sizeof( pTimes[ 0u ] ), compareFrameTimes );
+
+        printf( "%-14s %9.4f %9.4f %9.4f %9.4f\n", s_timingNames[ i ], ( double )sum * 1e-6 / ( double )frameCount,
+            ( double )pTimes[ frameCount / 2u ] * 1e-6, ( double )pTimes[ ( frameCount * 99u ) / 100u ] * 1e-6, ( double )pTimes[ frameCount - 1u ] * 1e-6 );
+    }
+    return desyncTick != 0u ? 1 : 0;
+}
+
+#if !defined( FONT_EDITOR ) && !defined( TEST_RENDERER )
+#   define RENDER_THREAD    // the editors render on the main thread
+#endif
+
+enum
+{
+    FallbackRefreshRate = 60u       // sdl 1.2 can't query the display mode, the render thread measures it with vsync
+};
+
+static volatile uint32 s_renderFrameCount = 0u;
+
+#ifdef RENDER_THREAD
+static volatile uint32  s_stopRenderThread = 0u;
+static Display*         s_pDisplay = NULL;
+static GLXDrawable      s_drawable;
+static GLXContext       s_glContext;
+
+// all gl work happens here, so waiting for vsync in the swap never delays input and network on the main thread
+static void renderThreadFunction( void* pUserData )
+{
+    SYS_USE_ARGUMENT( pUserData );
+
+    SYS_PROFILE_THREAD_NAME( "render" );
+
+    glXMakeCurrent( s_pDisplay, s_drawable, s_glContext );
+    game_initRender();
+
+    // with vsync the swap already waits for the display, the pacer only keeps the thread from spinning without it:
+    FramePacer framePacer;
+    framepacer_init( &framePacer, FallbackRefreshRate );
+    uint64 lastFrameTime = sys_getTime();
+
+    while( !atomic_loadAcquire( &s_stopRenderThread ) )
+    {
+        const float timeStep = framepacer_getElapsedTime( &lastFrameTime );
+
+        renderer_setVariance(0.0f);
+        game_render( timeStep );
+        const uint64 swapStartTime = sys_getTime();
+        glXSwapBuffers( s_pDisplay, s_drawable );
+
+        atomic_storeRelease( &s_renderFrameCount, s_renderFrameCount + 1u );
+        framepacer_waitForSwap( &framePacer, swapStartTime );
+    }
+
+    game_doneRender();
+    glXMakeCurrent( s_pDisplay, None, NULL );
+}
+#endif
+
+// the value after the option pName (anywhere after the positional arguments), 0 if there is none
+static const char* findOptionValue( int argc, char** argv, const char* pName )
+{
+    for( int i = 1; i + 1 < argc; ++i )
+    {
+        if( strcmp( argv[ i ], pName ) == 0 )
+        {
+            return argv[ i + 1 ];
+        }
+    }
+    return NULL;
+}
+
+int main( int argc, char** argv )
 {
+#ifdef SYS_TRACE_ENABLED
+    // -trace <file> writes the trace messages to a file instead of stdout:
+    trace_init( findOptionValue( argc, argv, "-trace" ) );
+#endif
+
+    if( argc > 1 && strcmp( argv[ 1 ], "-bots" ) == 0 )
+    {
+        const int result = runBots( argc, argv );
+#ifdef SYS_TRACE_ENABLED
+        trace_done();
+#endif
+        return result;
+    }
+
+    if( argc > 1 && strcmp( argv[ 1 ], "-servers" ) == 0 )
+    {
+        const int result = runServers( argc, argv );
+#ifdef SYS_TRACE_ENABLED
+        trace_done();
+#endif
+        return result;
+    }
+
+    const char* pReplayFileName = findOptionValue( argc, argv, "-replay" );
+    if( pReplayFileName )
+    {
+        const int result = runReplay( pReplayFileName );
+#ifdef SYS_TRACE_ENABLED
+        trace_done();
+#endif
+        return result;
+    }
+
+#ifdef SYS_PROFILE_ENABLED
+    // -profile <file> writes a chrome trace of the whole session:
+    const char* pProfileFileName = findOptionValue( argc, argv, "-profile" );
+    if( pProfileFileName && profile_init( pProfileFileName ) )
+    {
+        SYS_PROFILE_THREAD_NAME( "main" );
+    }
+#endif
+
+#ifdef RENDER_THREAD
+    // sdl uses the display on the main thread, the render thread swaps on it:
+    XInitThreads();
+#endif
+
     if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER | SDL_INIT_JOYSTICK ) < 0 )
     {
         SYS_BREAK( "SDL_Init failed!\n" );
@@ -132,15 +709,37 @@ int main()
 
     game_init();
 
+    // -record <file> writes the next match for -replay:
+    const char* pRecordFileName = findOptionValue( argc, argv, "-record" );
+    if( pRecordFileName )
+    {
+        game_recordNextMatch( pRecordFileName );
+    }
+
+#ifdef RENDER_THREAD
+    // the context moves to the render thread:
+    s_pDisplay  = glXGetCurrentDisplay();
+    s_drawable  = glXGetCurrentDrawable();
+    s_glContext = glXGetCurrentContext();
+    glXMakeCurrent( s_pDisplay, None, NULL );
+
+    const ThreadHandle renderThread = sys_createThread( renderThreadFunction, NULL );
+
+    FramePacer framePacer;
+    framepacer_init( &framePacer, ClientTickRate );
+#else
+    game_initRender();
+#endif
+
     SDL_PauseAudio( 0 );
 
-    uint32 lastTime = SDL_GetTicks();
+    uint64 lastTime = sys_getTime();
     uint32 buttonMask = 0u;
     uint32 joystickButtonMask = 0u; 
 
 #ifndef SYS_BUILD_MASTER
-    uint32 lastTimingTime = lastTime;
-    uint32 timingFrameCount = 0u;
+    uint64 lastTimingTime = lastTime;
+    uint32 lastTimingFrameCount = 0u;
 #endif
 
     SDL_JoystickEventState( SDL_ENABLE );
@@ -162,23 +761,26 @@ int main()
     int quit = 0;
     do
     {
-        uint32 currentTime = SDL_GetTicks();
-
-        const float timeStep = ( float )( currentTime - lastTime ) / 1000.0f;
-        lastTime = currentTime;
+        const float timeStep = framepacer_getElapsedTime( &lastTime );
 
 #ifndef SYS_BUILD_MASTER
-        if( currentTime - lastTimingTime > 500u )
+        const uint64 currentTime = lastTime;
+        if( currentTime - lastTimingTime > 500000000u )
         {
-            const float timingTimeSpan = ( float )( currentTime - lastTimingTime ) / 1000.0f;
-            const float currentFps = ( float )( timingFrameCount ) / timingTimeSpan;
+            const float timingTimeSpan = ( float )( currentTime - lastTimingTime ) * 1e-9f;
+            const uint32 timingFrameCount = atomic_loadAcquire( &s_renderFrameCount );
+            const float currentFps = ( float )( timingFrameCount - lastTimingFrameCount ) / timingTimeSpan;
 
             char windowTitle[ 100u ];
             sprintf( windowTitle, "fps=%f cb=%i", currentFps, s_callbackCount );
             SDL_WM_SetCaption( windowTitle, 0 );
     
             lastTimingTime = currentTime;
-            timingFrameCount = 0u;
+            lastTimingFrameCount = timingFrameCount;
+
+#ifdef SYS_PROFILE_ENABLED
+            profile_flush();
+#endif
         }
 #endif
 
@@ -523,20 +1125,20 @@ int main()
         //frame.playerPos = s_game.player[ 0u ].position;
         renderer_drawFrame( &frame );
 #else
-        renderer_setVariance(0.0f);
         GameInput gameInput;
         memset( &gameInput, 0u, sizeof( gameInput ) );
         gameInput.timeStep = timeStep;
         gameInput.buttonMask = buttonMask | joystickButtonMask;
 
         game_update( &gameInput );
-
-        game_render();
 #endif
-        SDL_GL_SwapBuffers();
 
-#ifndef SYS_BUILD_MASTER
-        timingFrameCount++;
+#ifdef RENDER_THREAD
+        // the render thread picks up the published state. without the swap to block on, the updates are paced here:
+        framepacer_waitForFrame( &framePacer );
+#else
+        SDL_GL_SwapBuffers();
+        s_renderFrameCount++;
 #endif
     }
     while( !quit );
@@ -544,6 +1146,19 @@ int main()
     // :TODO: nicer fade out..
     SDL_PauseAudio( 1 );
 
+#ifdef RENDER_THREAD
+    atomic_storeRelease( &s_stopRenderThread, 1u );
+    sys_joinThread( renderThread );
+#else
+    game_doneRender();
+#endif
     game_done();
+
+#ifdef SYS_PROFILE_ENABLED
+    profile_done();
+#endif
+#ifdef SYS_TRACE_ENABLED
+    trace_done();
+#endif
 }
 
@@ -10,12 +10,22 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifdef SYS_SOCKET_IO_URING
+#	include "socket_uring.h"
+#endif
+
 void socket_init()
 {
+#ifdef SYS_SOCKET_IO_URING
+	socket_uring_init();
+#endif
 }
 
 void socket_done()
 {
+#ifdef SYS_SOCKET_IO_URING
+	socket_uring_done();
+#endif
 }
 
 uint32 socket_getAnyIP()
@@ -47,11 +57,22 @@ Socket socket_create()
 	const int flags = fcntl( s, F_GETFL, 0 );
 	fcntl( s, F_SETFL, flags | O_NONBLOCK );
 
+#ifdef SYS_SOCKET_IO_URING
+	socket_uring_attach( s );
+#endif
+
 	return s;
 }
 
 void socket_destroy( Socket s )
 {
+#ifdef SYS_SOCKET_IO_URING
+	if( socket_uring_isAttached( s ) )
+	{
+		socket_uring_detach( s );
+	}
+#endif
+
 	shutdown( s, SHUT_RDWR );
 	close( s );
 }
@@ -80,6 +101,13 @@ int	socket_send( Socket s, const IP4Address* pTo, const void* pData, uint size )
 		return 0;
 	}
 
+#ifdef SYS_SOCKET_IO_URING
+	if( socket_uring_isAttached( s ) )
+	{
+		return socket_uring_send( s, pTo, pData, size );
+	}
+#endif
+
 	struct sockaddr_in addr;
 	memset( &addr, 0, sizeof( addr ) );
 
@@ -105,6 +133,13 @@ int	socket_send( Socket s, const IP4Address* pTo, const void* pData, uint size )
 
 int	socket_receive( Socket s, void* pData, uint size, IP4Address* pFrom )
 {
+#ifdef SYS_SOCKET_IO_URING
+	if( socket_uring_isAttached( s ) )
+	{
+		return socket_uring_receive( s, pData, size, pFrom );
+	}
+#endif
+
 	struct sockaddr_storage addr;
 	socklen_t addrLength = sizeof( addr );
 	memset( &addr, 0, sizeof( addr ) );
@@ -134,3 +169,12 @@ int	socket_receive( Socket s, void* pData, uint size, IP4Address* pFrom )
 	}
 }
 
+void socket_flush()
+{
+#ifdef SYS_SOCKET_IO_URING
+	if( socket_uring_isActive() )
+	{
+		socket_uring_flush();
+	}
+#endif
+}
@@ -0,0 +1,774 @@
+#include "socket_uring.h"
+#include "debug.h"
+
+#ifdef SYS_SOCKET_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <unistd.h>
+
+enum
+{
+	UringQueueDepth		= 256u,
+	UringBufferCount	= 256u,		// has to be a power of two
+	UringBufferSize		= 2048u,
+	UringBufferGroup	= 0u,
+	UringMaxSockets		= 64u,
+	UringPendingCount	= 256u,		// has to be a power of two
+	UringSendSlotCount	= 128u,
+	UringSendDataSize	= 1536u,
+	UringMaxSocketFd	= 4096u		// sockets with a higher file descriptor use the plain calls
+};
+
+typedef enum
+{
+	UringOp_Receive		= 1,
+	UringOp_Send		= 2,
+	UringOp_Cancel		= 3,
+	UringOp_Probe		= 4
+} UringOp;
+
+typedef struct
+{
+	Socket			socket;
+	uint			generation;
+	int				isReceiving;
+	int				isArmed;
+	struct msghdr	receiveHeader;		// referenced by the kernel as long as the multishot receive is armed
+
+	uint16			pendingBuffers[ UringPendingCount ];
+	uint			pendingRead;
+	uint			pendingWrite;
+} UringSocket;
+
+typedef struct
+{
+	struct msghdr		header;
+	struct iovec		data;
+	struct sockaddr_in	address;
+	uint8				buffer[ UringSendDataSize ];
+} UringSendSlot;
+
+typedef struct
+{
+	int							ringFd;
+
+	uint8*						pSqRing;
+	size_t						sqRingSize;
+	uint8*						pCqRing;
+	size_t						cqRingSize;
+
+	uint32*						pSqHead;
+	uint32*						pSqTail;
+	uint32						sqMask;
+	uint32						sqEntries;
+	uint32						sqTail;
+	uint						sqPending;
+	struct io_uring_sqe*		pSqes;
+	size_t						sqeSize;
+
+	uint32*						pCqHead;
+	uint32*						pCqTail;
+	uint32						cqMask;
+	struct io_uring_cqe*		pCqes;
+
+	struct io_uring_buf_ring*	pBufferRing;
+	uint16						bufferTail;
+	uint8						receiveBuffers[ UringBufferCount ][ UringBufferSize ];
+
+	UringSocket					sockets[ UringMaxSockets ];
+
+	UringSendSlot				sendSlots[ UringSendSlotCount ];
+	uint16						freeSendSlots[ UringSendSlotCount ];
+	uint						freeSendSlotCount;
+
+	uint						droppedCount;
+} Uring;
+
+static SYS_THREAD_LOCAL Uring*	s_pUring = 0;
+static SYS_THREAD_LOCAL uint	s_uringRefCount = 0u;
+
+// the ring each socket is attached to, by file descriptor. 0 for the sockets that use the plain calls.
+// only the thread of the ring writes its entries
+static Uring*					s_socketRings[ UringMaxSocketFd ];
+
+static inline Uring* uring_getSocketRing( Socket socket )
+{
+	if( socket < 0 || (uint)socket >= UringMaxSocketFd )
+	{
+		return 0;
+	}
+	return __atomic_load_n( &s_socketRings[ socket ], __ATOMIC_RELAXED );
+}
+
+static inline void uring_setSocketRing( Socket socket, Uring* pUring )
+{
+	__atomic_store_n( &s_socketRings[ socket ], pUring, __ATOMIC_RELAXED );
+}
+
+static inline uint64 uring_userData( UringOp op, uint generation, uint index )
+{
+	return ( (uint64)op << 48u ) | ( (uint64)( generation & 0xffffu ) << 32u ) | (uint64)index;
+}
+
+static int uring_enter( uint toSubmit, uint minComplete, uint flags )
+{
+	const long result = syscall( __NR_io_uring_enter, s_pUring->ringFd, toSubmit, minComplete, flags, NULL, 0 );
+	if( result < 0 )
+	{
+		if( errno != EINTR && errno != EAGAIN && errno != EBUSY )
+		{
+			SYS_TRACE_ERROR( "io_uring_enter failed (errno=%i)\n", errno );
+		}
+		return 0;
+	}
+	return (int)result;
+}
+
+static void uring_submit( uint minComplete )
+{
+	const uint flags = minComplete > 0u ? IORING_ENTER_GETEVENTS : 0u;
+	if( s_pUring->sqPending == 0u && minComplete == 0u )
+	{
+		return;
+	}
+
+	const int submitted = uring_enter( s_pUring->sqPending, minComplete, flags );
+	s_pUring->sqPending -= uint_min( (uint)submitted, s_pUring->sqPending );
+}
+
+static struct io_uring_sqe* uring_getSqe()
+{
+	Uring* pUring = s_pUring;
+	if( pUring->sqTail - __atomic_load_n( pUring->pSqHead, __ATOMIC_ACQUIRE ) >= pUring->sqEntries )
+	{
+		uring_submit( 0u );
+		if( pUring->sqTail - __atomic_load_n( pUring->pSqHead, __ATOMIC_ACQUIRE ) >= pUring->sqEntries )
+		{
+			return 0;
+		}
+	}
+
+	struct io_uring_sqe* pSqe = &pUring->pSqes[ pUring->sqTail & pUring->sqMask ];
+	memset( pSqe, 0, sizeof( *pSqe ) );
+	return pSqe;
+}
+
+static void uring_pushSqe()
+{
+	s_pUring->sqTail++;
+	s_pUring->sqPending++;
+	__atomic_store_n( s_pUring->pSqTail, s_pUring->sqTail, __ATOMIC_RELEASE );
+}
+
+static void uring_recycleBuffer( uint16 bufferId )
+{
+	Uring* pUring = s_pUring;
+	struct io_uring_buf* pBuffer = &pUring->pBufferRing->bufs[ pUring->bufferTail & ( UringBufferCount - 1u ) ];
+	pBuffer->addr	= (uint64)(size_t)pUring->receiveBuffers[ bufferId ];
+	pBuffer->len	= UringBufferSize;
+	pBuffer->bid	= bufferId;
+	pUring->bufferTail++;
+	__atomic_store_n( &pUring->pBufferRing->tail, pUring->bufferTail, __ATOMIC_RELEASE );
+}
+
+static UringSocket* uring_findSocket( Socket socket )
+{
+	for( uint i = 0u; i < SYS_COUNTOF( s_pUring->sockets ); ++i )
+	{
+		if( s_pUring->sockets[ i ].socket == socket )
+		{
+			return &s_pUring->sockets[ i ];
+		}
+	}
+	return 0;
+}
+
+static void uring_armReceive( UringSocket* pSocket )
+{
+	struct io_uring_sqe* pSqe = uring_getSqe();
+	if( !pSqe )
+	{
+		return;
+	}
+
+	const uint index = (uint)( pSocket - s_pUring->sockets );
+
+	memset( &pSocket->receiveHeader, 0, sizeof( pSocket->receiveHeader ) );
+	pSocket->receiveHeader.msg_namelen = sizeof( struct sockaddr_in );
+
+	pSqe->opcode	= IORING_OP_RECVMSG;
+	pSqe->fd		= pSocket->socket;
+	pSqe->addr		= (uint64)(size_t)&pSocket->receiveHeader;
+	pSqe->len		= 1u;
+	pSqe->flags		= IOSQE_BUFFER_SELECT;
+	pSqe->buf_group	= UringBufferGroup;
+	pSqe->ioprio	= IORING_RECV_MULTISHOT;
+	pSqe->user_data	= uring_userData( UringOp_Receive, pSocket->generation, index );
+	uring_pushSqe();
+
+	pSocket->isArmed = TRUE;
+	pSocket->isReceiving = TRUE;
+}
+
+static void uring_handleReceive( const struct io_uring_cqe* pCqe, uint generation, uint index )
+{
+	const int hasBuffer = ( pCqe->flags & IORING_CQE_F_BUFFER ) != 0u;
+	const uint16 bufferId = (uint16)( pCqe->flags >> IORING_CQE_BUFFER_SHIFT );
+
+	UringSocket* pSocket = index < UringMaxSockets ? &s_pUring->sockets[ index ] : 0;
+	if( !pSocket || pSocket->socket == InvalidSocket || ( pSocket->generation & 0xffffu ) != generation )
+	{
+		// completion of an already destroyed socket:
+		if( hasBuffer )
+		{
+			uring_recycleBuffer( bufferId );
+		}
+		return;
+	}
+
+	if( hasBuffer )
+	{
+		if( pCqe->res >= 0 && pSocket->pendingWrite - pSocket->pendingRead < UringPendingCount )
+		{
+			pSocket->pendingBuffers[ pSocket->pendingWrite & ( UringPendingCount - 1u ) ] = bufferId;
+			pSocket->pendingWrite++;
+		}
+		else
+		{
+			s_pUring->droppedCount++;
+			uring_recycleBuffer( bufferId );
+		}
+	}
+
+	if( !( pCqe->flags & IORING_CQE_F_MORE ) )
+	{
+		// the multishot receive terminated (e.g. no buffers left) and has to be rearmed:
+		pSocket->isArmed = FALSE;
+	}
+}
+
+static void uring_reapCompletions()
+{
+	Uring* pUring = s_pUring;
+	uint32 head = *pUring->pCqHead;
+	const uint32 tail = __atomic_load_n( pUring->pCqTail, __ATOMIC_ACQUIRE );
+
+	while( head != tail )
+	{
+		const struct io_uring_cqe* pCqe = &pUring->pCqes[ head & pUring->cqMask ];
+		const UringOp op = (UringOp)( pCqe->user_data >> 48u );
+		const uint generation = (uint)( ( pCqe->user_data >> 32u ) & 0xffffu );
+		const uint index = (uint)( pCqe->user_data & 0xffffffffu );
+
+		switch( op )
+		{
+		case UringOp_Receive:
+			uring_handleReceive( pCqe, generation, index );
+			break;
+
+		case UringOp_Send:
+			if( pCqe->res < 0 )
+			{
+				SYS_TRACE_WARNING( "io_uring send failed (error=%i)\n", -pCqe->res );
+			}
+			SYS_ASSERT( index < UringSendSlotCount );
+			pUring->freeSendSlots[ pUring->freeSendSlotCount++ ] = (uint16)index;
+			break;
+
+		default:
+			break;
+		}
+		head++;
+	}
+
+	__atomic_store_n( pUring->pCqHead, head, __ATOMIC_RELEASE );
+
+	for( uint i = 0u; i < SYS_COUNTOF( pUring->sockets ); ++i )
+	{
+		UringSocket* pSocket = &pUring->sockets[ i ];
+		if( pSocket->socket != InvalidSocket && pSocket->isReceiving && !pSocket->isArmed )
+		{
+			uring_armReceive( pSocket );
+		}
+	}
+}
+
+// kernels before 6.0 accept the buffer ring but reject multishot receives. arm one on an unbound socket and cancel it:
+// a supported receive waits and gets canceled, an unsupported one fails right away
+static int uring_probeMultishotReceive()
+{
+	const int probeSocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if( probeSocket < 0 )
+	{
+		return FALSE;
+	}
+
+	struct msghdr probeHeader;
+	memset( &probeHeader, 0, sizeof( probeHeader ) );
+	probeHeader.msg_namelen = sizeof( struct sockaddr_in );
+
+	struct io_uring_sqe* pSqe = uring_getSqe();
+	pSqe->opcode	= IORING_OP_RECVMSG;
+	pSqe->fd		= probeSocket;
+	pSqe->addr		= (uint64)(size_t)&probeHeader;
+	pSqe->len		= 1u;
+	pSqe->flags		= IOSQE_BUFFER_SELECT;
+	pSqe->buf_group	= UringBufferGroup;
+	pSqe->ioprio	= IORING_RECV_MULTISHOT;
+	pSqe->user_data	= uring_userData( UringOp_Probe, 0u, 0u );
+	uring_pushSqe();
+
+	pSqe = uring_getSqe();
+	pSqe->opcode	= IORING_OP_ASYNC_CANCEL;
+	pSqe->fd		= -1;
+	pSqe->addr		= uring_userData( UringOp_Probe, 0u, 0u );
+	pSqe->user_data	= uring_userData( UringOp_Cancel, 0u, 0u );
+	uring_pushSqe();
+
+	uring_submit( 0u );
+	if( s_pUring->sqPending > 0u )
+	{
+		close( probeSocket );
+		return FALSE;
+	}
+
+	// the cancel always completes, so this can't wait forever:
+	Uring* pUring = s_pUring;
+	int receiveResult = -EINVAL;
+	uint completionCount = 0u;
+	while( completionCount < 2u )
+	{
+		uint32 head = *pUring->pCqHead;
+		const uint32 tail = __atomic_load_n( pUring->pCqTail, __ATOMIC_ACQUIRE );
+		if( head == tail )
+		{
+			uring_enter( 0u, 1u, IORING_ENTER_GETEVENTS );
+			continue;
+		}
+		while( head != tail )
+		{
+			const struct io_uring_cqe* pCqe = &pUring->pCqes[ head & pUring->cqMask ];
+			if( ( pCqe->user_data >> 48u ) == UringOp_Probe )
+			{
+				if( pCqe->flags & IORING_CQE_F_BUFFER )
+				{
+					uring_recycleBuffer( (uint16)( pCqe->flags >> IORING_CQE_BUFFER_SHIFT ) );
+				}
+				receiveResult = pCqe->res;
+			}
+			completionCount++;
+			head++;
+		}
+		__atomic_store_n( pUring->pCqHead, head, __ATOMIC_RELEASE );
+	}
+
+	close( probeSocket );
+	return receiveResult == -ECANCELED;
+}
+
+static void uring_destroy()
+{
+	Uring* pUring = s_pUring;
+	if( !pUring )
+	{
+		return;
+	}
+
+	for( uint i = 0u; i < UringMaxSockets; ++i )
+	{
+		if( pUring->sockets[ i ].socket != InvalidSocket )
+		{
+			uring_setSocketRing( pUring->sockets[ i ].socket, 0 );
+		}
+	}
+
+	if( pUring->pSqes )
+	{
+		munmap( pUring->pSqes, pUring->sqeSize );
+	}
+	if( pUring->pCqRing && pUring->pCqRing != pUring->pSqRing )
+	{
+		munmap( pUring->pCqRing, pUring->cqRingSize );
+	}
+	if( pUring->pSqRing )
+	{
+		munmap( pUring->pSqRing, pUring->sqRingSize );
+	}
+	if( pUring->pBufferRing )
+	{
+		munmap( pUring->pBufferRing, UringBufferCount * sizeof( struct io_uring_buf ) );
+	}
+	if( pUring->ringFd >= 0 )
+	{
+		close( pUring->ringFd );
+	}
+
+	munmap( pUring, sizeof( Uring ) );
+	s_pUring = 0;
+}
+
+static int uring_create()
+{
+	void* pMemory = mmap( NULL, sizeof( Uring ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if( pMemory == MAP_FAILED )
+	{
+		return FALSE;
+	}
+
+	s_pUring = (Uring*)pMemory;
+	Uring* pUring = s_pUring;
+	pUring->ringFd = -1;
+
+	struct io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+	params.flags = IORING_SETUP_COOP_TASKRUN;
+
+	long ringFd = syscall( __NR_io_uring_setup, UringQueueDepth, &params );
+	if( ringFd < 0 && errno == EINVAL )
+	{
+		// older kernel: try again without cooperative task running:
+		memset( &params, 0, sizeof( params ) );
+		ringFd = syscall( __NR_io_uring_setup, UringQueueDepth, &params );
+	}
+	if( ringFd < 0 )
+	{
+		SYS_TRACE_WARNING( "io_uring is not available (errno=%i)\n", errno );
+		return FALSE;
+	}
+	pUring->ringFd = (int)ringFd;
+
+	pUring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof( uint32 );
+	pUring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+	if( params.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		pUring->sqRingSize = pUring->cqRingSize = ( pUring->sqRingSize > pUring->cqRingSize ? pUring->sqRingSize : pUring->cqRingSize );
+	}
+
+	void* pSqRing = mmap( NULL, pUring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, pUring->ringFd, IORING_OFF_SQ_RING );
+	if( pSqRing == MAP_FAILED )
+	{
+		return FALSE;
+	}
+	pUring->pSqRing = (uint8*)pSqRing;
+
+	if( params.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		pUring->pCqRing = pUring->pSqRing;
+	}
+	else
+	{
+		void* pCqRing = mmap( NULL, pUring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, pUring->ringFd, IORING_OFF_CQ_RING );
+		if( pCqRing == MAP_FAILED )
+		{
+			return FALSE;
+		}
+		pUring->pCqRing = (uint8*)pCqRing;
+	}
+
+	pUring->sqeSize = params.sq_entries * sizeof( struct io_uring_sqe );
+	void* pSqes = mmap( NULL, pUring->sqeSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, pUring->ringFd, IORING_OFF_SQES );
+	if( pSqes == MAP_FAILED )
+	{
+		return FALSE;
+	}
+	pUring->pSqes = (struct io_uring_sqe*)pSqes;
+
+	pUring->pSqHead		= (uint32*)(void*)( pUring->pSqRing + params.sq_off.head );
+	pUring->pSqTail		= (uint32*)(void*)( pUring->pSqRing + params.sq_off.tail );
+	pUring->sqMask		= *(uint32*)(void*)( pUring->pSqRing + params.sq_off.ring_mask );
+	pUring->sqEntries	= params.sq_entries;
+	pUring->sqTail		= *pUring->pSqTail;
+
+	uint32* pSqArray = (uint32*)(void*)( pUring->pSqRing + params.sq_off.array );
+	for( uint32 i = 0u; i < params.sq_entries; ++i )
+	{
+		pSqArray[ i ] = i;
+	}
+
+	pUring->pCqHead		= (uint32*)(void*)( pUring->pCqRing + params.cq_off.head );
+	pUring->pCqTail		= (uint32*)(void*)( pUring->pCqRing + params.cq_off.tail );
+	pUring->cqMask		= *(uint32*)(void*)( pUring->pCqRing + params.cq_off.ring_mask );
+	pUring->pCqes		= (struct io_uring_cqe*)(void*)( pUring->pCqRing + params.cq_off.cqes );
+
+	// register the receive buffers as provided buffer ring:
+	void* pBufferRing = mmap( NULL, UringBufferCount * sizeof( struct io_uring_buf ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if( pBufferRing == MAP_FAILED )
+	{
+		return FALSE;
+	}
+	pUring->pBufferRing = (struct io_uring_buf_ring*)pBufferRing;
+
+	struct io_uring_buf_reg bufferRegistration;
+	memset( &bufferRegistration, 0, sizeof( bufferRegistration ) );
+	bufferRegistration.ring_addr	= (uint64)(size_t)pBufferRing;
+	bufferRegistration.ring_entries	= UringBufferCount;
+	bufferRegistration.bgid			= UringBufferGroup;
+
+	if( syscall( __NR_io_uring_register, pUring->ringFd, IORING_REGISTER_PBUF_RING, &bufferRegistration, 1 ) < 0 )
+	{
+		SYS_TRACE_WARNING( "io_uring buffer ring registration failed (errno=%i)\n", errno );
+		return FALSE;
+	}
+
+	for( uint i = 0u; i < UringBufferCount; ++i )
+	{
+		uring_recycleBuffer( (uint16)i );
+	}
+
+	for( uint i = 0u; i < UringSendSlotCount; ++i )
+	{
+		pUring->freeSendSlots[ i ] = (uint16)( UringSendSlotCount - 1u - i );
+	}
+	pUring->freeSendSlotCount = UringSendSlotCount;
+
+	for( uint i = 0u; i < UringMaxSockets; ++i )
+	{
+		pUring->sockets[ i ].socket = InvalidSocket;
+	}
+
+	if( !uring_probeMultishotReceive() )
+	{
+		SYS_TRACE_WARNING( "io_uring multishot receive is not supported, using the socket backend\n" );
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void socket_uring_init()
+{
+	if( s_uringRefCount == 0u )
+	{
+		if( !uring_create() )
+		{
+			uring_destroy();
+		}
+	}
+	s_uringRefCount++;
+}
+
+void socket_uring_done()
+{
+	if( s_uringRefCount == 0u )
+	{
+		return;
+	}
+
+	s_uringRefCount--;
+	if( s_uringRefCount == 0u && s_pUring )
+	{
+		// wait for the queued sends:
+		uring_submit( 0u );
+		const uint outstandingSends = UringSendSlotCount - s_pUring->freeSendSlotCount;
+		if( outstandingSends > 0u )
+		{
+			uring_enter( 0u, outstandingSends, IORING_ENTER_GETEVENTS );
+			uring_reapCompletions();
+		}
+
+		if( s_pUring->droppedCount > 0u )
+		{
+			SYS_TRACE_WARNING( "io_uring dropped %u datagrams\n", s_pUring->droppedCount );
+		}
+		uring_destroy();
+	}
+}
+
+int socket_uring_isActive()
+{
+	return s_pUring != 0;
+}
+
+int socket_uring_isAttached( Socket socket )
+{
+	const Uring* pUring = uring_getSocketRing( socket );
+	// the completions of a socket go to the ring of the thread that created it, no other thread may use it:
+	SYS_ASSERT( !pUring || pUring == s_pUring );
+	return pUring != 0;
+}
+
+int socket_uring_attach( Socket socket )
+{
+	if( !s_pUring || socket < 0 || (uint)socket >= UringMaxSocketFd )
+	{
+		return FALSE;
+	}
+
+	UringSocket* pSocket = uring_findSocket( InvalidSocket );
+	if( !pSocket )
+	{
+		SYS_TRACE_WARNING( "all %u io_uring sockets are in use, socket %i uses the plain calls\n", UringMaxSockets, socket );
+		return FALSE;
+	}
+
+	pSocket->socket			= socket;
+	pSocket->generation++;
+	pSocket->isReceiving	= FALSE;
+	pSocket->isArmed		= FALSE;
+	pSocket->pendingRead	= 0u;
+	pSocket->pendingWrite	= 0u;
+	uring_setSocketRing( socket, s_pUring );
+
+	// the receive is armed on the first receive call (client sockets are bound by their first send)
+	return TRUE;
+}
+
+void socket_uring_detach( Socket socket )
+{
+	SYS_ASSERT( socket_uring_isAttached( socket ) );
+	UringSocket* pSocket = uring_findSocket( socket );
+	if( !pSocket )
+	{
+		return;
+	}
+
+	if( pSocket->isArmed )
+	{
+		struct io_uring_sqe* pSqe = uring_getSqe();
+		if( pSqe )
+		{
+			pSqe->opcode	= IORING_OP_ASYNC_CANCEL;
+			pSqe->fd		= -1;
+			pSqe->addr		= uring_userData( UringOp_Receive, pSocket->generation, (uint)( pSocket - s_pUring->sockets ) );
+			pSqe->user_data	= uring_userData( UringOp_Cancel, 0u, 0u );
+			uring_pushSqe();
+		}
+	}
+
+	// the socket is about to be closed: get the last sends out first
+	uring_submit( 0u );
+
+	while( pSocket->pendingRead != pSocket->pendingWrite )
+	{
+		uring_recycleBuffer( pSocket->pendingBuffers[ pSocket->pendingRead & ( UringPendingCount - 1u ) ] );
+		pSocket->pendingRead++;
+	}
+
+	uring_setSocketRing( socket, 0 );
+	pSocket->socket			= InvalidSocket;
+	pSocket->isReceiving	= FALSE;
+	pSocket->isArmed		= FALSE;
+}
+
+void socket_uring_flush()
+{
+	if( s_pUring )
+	{
+		uring_submit( 0u );
+	}
+}
+
+int socket_uring_send( Socket socket, const IP4Address* pTo, const void* pData, uint size )
+{
+	Uring* pUring = s_pUring;
+	if( size > UringSendDataSize )
+	{
+		return -1;
+	}
+
+	if( pUring->freeSendSlotCount == 0u )
+	{
+		// all slots in flight: submit and pick up what already completed
+		uring_submit( 1u );
+		uring_reapCompletions();
+		if( pUring->freeSendSlotCount == 0u )
+		{
+			return 0;
+		}
+	}
+
+	struct io_uring_sqe* pSqe = uring_getSqe();
+	if( !pSqe )
+	{
+		return 0;
+	}
+
+	const uint16 slotIndex = pUring->freeSendSlots[ --pUring->freeSendSlotCount ];
+	UringSendSlot* pSlot = &pUring->sendSlots[ slotIndex ];
+
+	memcpy( pSlot->buffer, pData, size );
+
+	memset( &pSlot->address, 0, sizeof( pSlot->address ) );
+	pSlot->address.sin_family		= AF_INET;
+	pSlot->address.sin_addr.s_addr	= pTo->address;
+	pSlot->address.sin_port			= htons( pTo->port );
+
+	pSlot->data.iov_base = pSlot->buffer;
+	pSlot->data.iov_len	 = size;
+
+	memset( &pSlot->header, 0, sizeof( pSlot->header ) );
+	pSlot->header.msg_name		= &pSlot->address;
+	pSlot->header.msg_namelen	= sizeof( pSlot->address );
+	pSlot->header.msg_iov		= &pSlot->data;
+	pSlot->header.msg_iovlen	= 1u;
+
+	pSqe->opcode	= IORING_OP_SENDMSG;
+	pSqe->fd		= socket;
+	pSqe->addr		= (uint64)(size_t)&pSlot->header;
+	pSqe->len		= 1u;
+	pSqe->user_data	= uring_userData( UringOp_Send, 0u, slotIndex );
+	uring_pushSqe();
+
+	// the datagram is queued and goes out with the next flush
+	return (int)size;
+}
+
+int socket_uring_receive( Socket socket, void* pData, uint size, IP4Address* pFrom )
+{
+	UringSocket* pSocket = uring_findSocket( socket );
+	if( !pSocket )
+	{
+		return -1;
+	}
+
+	if( !pSocket->isArmed )
+	{
+		uring_armReceive( pSocket );
+	}
+
+	if( pSocket->pendingRead == pSocket->pendingWrite )
+	{
+		uring_reapCompletions();
+	}
+	if( pSocket->pendingRead == pSocket->pendingWrite )
+	{
+		// one kernel round trip per drained queue (not per datagram): submit pending requests and run completion work
+		uring_submit( 0u );
+		uring_enter( 0u, 0u, IORING_ENTER_GETEVENTS );
+		uring_reapCompletions();
+	}
+	if( pSocket->pendingRead == pSocket->pendingWrite )
+	{
+		return 0;
+	}
+
+	const uint16 bufferId = pSocket->pendingBuffers[ pSocket->pendingRead & ( UringPendingCount - 1u ) ];
+	pSocket->pendingRead++;
+
+	const uint8* pBuffer = s_pUring->receiveBuffers[ bufferId ];
+	const struct io_uring_recvmsg_out* pHeader = (const struct io_uring_recvmsg_out*)(const void*)pBuffer;
+	const uint8* pName = pBuffer + sizeof( struct io_uring_recvmsg_out );
+	const uint8* pPayload = pName + pSocket->receiveHeader.msg_namelen + pSocket->receiveHeader.msg_controllen;
+
+	if( pHeader->namelen >= sizeof( struct sockaddr_in ) )
+	{
+		const struct sockaddr_in* pAddr = (const struct sockaddr_in*)(const void*)pName;
+		pFrom->address	= pAddr->sin_addr.s_addr;
+		pFrom->port		= ntohs( pAddr->sin_port );
+	}
+
+	const uint availableSize = (uint)( UringBufferSize - ( pPayload - pBuffer ) );
+	const uint payloadSize = uint_min( uint_min( pHeader->payloadlen, availableSize ), size );
+	memcpy( pData, pPayload, payloadSize );
+
+	uring_recycleBuffer( bufferId );
+
+	return (int)payloadSize;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SOCKET_URING_H_INCLUDED
+#define SOCKET_URING_H_INCLUDED
+
+#include "socket.h"
+
+// io_uring datagram backend. there is one ring per thread: all sockets created on a thread complete into it,
+// and only that thread may use them.
+void	socket_uring_init();
+void	socket_uring_done();
+int		socket_uring_isActive();
+
+// returns FALSE if the thread has no ring or it is full, the socket uses the plain calls then
+int		socket_uring_attach( Socket socket );
+void	socket_uring_detach( Socket socket );
+int		socket_uring_isAttached( Socket socket );
+
+int		socket_uring_send( Socket socket, const IP4Address* pTo, const void* pData, uint size );
+int		socket_uring_receive( Socket socket, void* pData, uint size, IP4Address* pFrom );
+void	socket_uring_flush();
+
+#endif
@@ -1,8 +1,26 @@
 #ifndef SYS_SYS_H_INCLUDED
 #define SYS_SYS_H_INCLUDED
 
+#include "types.h"
+
 int sys_getScreenWidth();
 int sys_getScreenHeight();
 
-#endif
+// maps the whole file read only. returns 0 if the file can't be opened or is empty
+const void* sys_mapFile( const char* pFileName, uint* pSize );
+void sys_unmapFile( const void* pData, uint size );
+
+// writes a finished trace line to the console or debugger
+void sys_writeTrace( const char* pText );
+
+typedef void ( *ThreadFunction )( void* pArgument );
+typedef uint64 ThreadHandle;
 
+ThreadHandle sys_createThread( ThreadFunction pFunction, void* pArgument );
+void sys_joinThread( ThreadHandle thread );
+
+// monotonic clock in nanoseconds
+uint64 sys_getTime();
+void sys_sleepUntil( uint64 time );
+
+#endif
@@ -0,0 +1,205 @@
+#include "profile.h"
+
+#ifdef SYS_PROFILE_ENABLED
+
+#include "platform.h"
+#include "spscring.h"
+#include "atomic.h"
+#include "debug.h"
+
+#include <stdio.h>
+#include <string.h>
+
+enum
+{
+	ProfileThread_Unregistered	= 0u,
+	ProfileThread_Ignored		= MaxProfileThreads + 1u
+};
+
+typedef struct
+{
+	const char*		pName;
+	uint64			startTime;
+	uint64			endTime;
+} ProfileEvent;
+
+typedef struct
+{
+	SpscRing		events;		// the thread pushes, profile_flush pops
+	ProfileEvent	eventBuffer[ ProfileEventCapacity ];
+	volatile uint32	droppedEventCount;
+	char			name[ 32u ];
+	volatile uint32	hasName;
+	int				isNameWritten;	// only used by profile_flush
+	uint32			reportedDroppedEventCount;	// only used by profile_flush
+} ProfileThread;
+
+static ProfileThread	s_profileThreads[ MaxProfileThreads ];
+static volatile uint32	s_profileThreadCount = 0u;
+static volatile uint32	s_isProfiling = 0u;
+static FILE*			s_pProfileFile = NULL;
+static uint64			s_profileStartTime = 0u;
+static int				s_isFirstProfileEvent = TRUE;
+
+// the index of the calling thread + 1
+static SYS_THREAD_LOCAL uint32 s_profileThreadIndex = ProfileThread_Unregistered;
+
+int profile_init( const char* pFileName )
+{
+	SYS_ASSERT( !s_isProfiling );
+
+	s_pProfileFile = fopen( pFileName, "w" );
+	if( !s_pProfileFile )
+	{
+		SYS_TRACE_ERROR( "could not open profile file '%s'\n", pFileName );
+		return FALSE;
+	}
+
+	// all rings are ready before anything is recorded, so threads only have to claim one:
+	for( uint i = 0u; i < MaxProfileThreads; ++i )
+	{
+		ProfileThread* pThread = &s_profileThreads[ i ];
+		spscring_init( &pThread->events, pThread->eventBuffer, sizeof( pThread->eventBuffer[ 0u ] ), SYS_COUNTOF( pThread->eventBuffer ) );
+		pThread->droppedEventCount	= 0u;
+		pThread->hasName			= 0u;
+		pThread->isNameWritten		= FALSE;
+		pThread->reportedDroppedEventCount = 0u;
+	}
+
+	// the json array format, the events of every flush are appended:
+	fputs( "[\n", s_pProfileFile );
+	s_isFirstProfileEvent	= TRUE;
+	s_profileStartTime		= sys_getTime();
+	atomic_storeRelease( &s_isProfiling, 1u );
+	return TRUE;
+}
+
+void profile_done()
+{
+	if( !s_isProfiling )
+	{
+		return;
+	}
+
+	profile_flush();
+	atomic_storeRelease( &s_isProfiling, 0u );
+
+	fputs( "\n]\n", s_pProfileFile );
+	fclose( s_pProfileFile );
+	s_pProfileFile = NULL;
+}
+
+static ProfileThread* profile_getThread()
+{
+	if( s_profileThreadIndex == ProfileThread_Unregistered )
+	{
+		const uint32 index = atomic_fetchAdd( &s_profileThreadCount, 1u );
+		s_profileThreadIndex = index < MaxProfileThreads ? index + 1u : ProfileThread_Ignored;
+	}
+
+	return s_profileThreadIndex != ProfileThread_Ignored ? &s_profileThreads[ s_profileThreadIndex - 1u ] : NULL;
+}
+
+void profile_setThreadName( const char* pName )
+{
+	if( !atomic_loadAcquire( &s_isProfiling ) )
+	{
+		return;
+	}
+
+	ProfileThread* pThread = profile_getThread();
+	if( pThread && !pThread->hasName )
+	{
+		copyString( pThread->name, sizeof( pThread->name ), pName );
+		atomic_storeRelease( &pThread->hasName, 1u );
+	}
+}
+
+void profile_beginScope( ProfileScope* pScope, const char* pName )
+{
+	if( !atomic_loadAcquire( &s_isProfiling ) )
+	{
+		pScope->pName = NULL;
+		return;
+	}
+
+	pScope->pName		= pName;
+	pScope->startTime	= sys_getTime();
+}
+
+void profile_endScope( ProfileScope* pScope )
+{
+	if( !pScope->pName )
+	{
+		return;
+	}
+
+	ProfileThread* pThread = profile_getThread();
+	if( !pThread )
+	{
+		return;
+	}
+
+	ProfileEvent event;
+	event.pName		= pScope->pName;
+	event.startTime	= pScope->startTime;
+	event.endTime	= sys_getTime();
+	if( !spscring_push( &pThread->events, &event ) )
+	{
+		// nobody flushed for too long
+		atomic_storeRelease( &pThread->droppedEventCount, pThread->droppedEventCount + 1u );
+	}
+}
+
+static void profile_writeSeparator()
+{
+	if( !s_isFirstProfileEvent )
+	{
+		fputs( ",\n", s_pProfileFile );
+	}
+	s_isFirstProfileEvent = FALSE;
+}
+
+void profile_flush()
+{
+	if( !s_isProfiling )
+	{
+		return;
+	}
+
+	const uint threadCount = uint_min( atomic_loadAcquire( &s_profileThreadCount ), MaxProfileThreads );
+	for( uint i = 0u; i < threadCount; ++i )
+	{
+		ProfileThread* pThread = &s_profileThreads[ i ];
+
+		if( !pThread->isNameWritten && atomic_loadAcquire( &pThread->hasName ) )
+		{
+			profile_writeSeparator();
+			fprintf( s_pProfileFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", i, pThread->name );
+			pThread->isNameWritten = TRUE;
+		}
+
+		// chrome wants microseconds:
+		ProfileEvent event;
+		while( spscring_pop( &pThread->events, &event ) )
+		{
+			profile_writeSeparator();
+			fprintf( s_pProfileFile, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				event.pName, i, (double)( event.startTime - s_profileStartTime ) * 1e-3, (double)( event.endTime - event.startTime ) * 1e-3 );
+		}
+
+		// the gaps in the trace are marked where they were noticed, so they aren't mistaken for idle time:
+		const uint32 droppedEventCount = atomic_loadAcquire( &pThread->droppedEventCount );
+		if( droppedEventCount != pThread->reportedDroppedEventCount )
+		{
+			const uint32 newDroppedEventCount = droppedEventCount - pThread->reportedDroppedEventCount;
+			SYS_TRACE_WARNING( "profiler dropped %u events of thread %u\n", newDroppedEventCount, i );
+			profile_writeSeparator();
+			fprintf( s_pProfileFile, "{\"name\":\"dropped %u events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+				newDroppedEventCount, i, (double)( sys_getTime() - s_profileStartTime ) * 1e-3 );
+			pThread->reportedDroppedEventCount = droppedEventCount;
+		}
+	}
+}
+
+#endif
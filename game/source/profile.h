@@ -0,0 +1,47 @@
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+#include "types.h"
+
+// SYS_PROFILE_BEGIN( "name" ) records the time until SYS_PROFILE_END(), one pair per block with an end before every
+// return in between (msvc c has no cleanup attribute to end it automatically). the events go into a lock free ring
+// per thread and profile_flush() writes them as chrome trace events (chrome://tracing, perfetto).
+// compiled out without SYS_PROFILE_ENABLED (master builds)
+
+#ifdef SYS_PROFILE_ENABLED
+
+enum
+{
+	MaxProfileThreads		= 16u,		// threads after these aren't recorded
+	ProfileEventCapacity	= 16384u	// per thread between two flushes, has to be a power of two
+};
+
+typedef struct
+{
+	const char*		pName;		// has to be a string literal (only the pointer is stored)
+	uint64			startTime;
+} ProfileScope;
+
+// starts writing a trace file, nothing is recorded before
+int		profile_init( const char* pFileName );
+void	profile_done();
+
+// names the calling thread in the trace
+void	profile_setThreadName( const char* pName );
+
+void	profile_beginScope( ProfileScope* pScope, const char* pName );
+void	profile_endScope( ProfileScope* pScope );
+
+// writes the events of all threads recorded so far. call it from one thread only
+void	profile_flush();
+
+#   define SYS_PROFILE_THREAD_NAME( name )	profile_setThreadName( name )
+#   define SYS_PROFILE_BEGIN( name )		ProfileScope profileScope; profile_beginScope( &profileScope, name )
+#   define SYS_PROFILE_END()				profile_endScope( &profileScope )
+#else
+#   define SYS_PROFILE_THREAD_NAME( name )
+#   define SYS_PROFILE_BEGIN( name )
+#   define SYS_PROFILE_END()
+#endif
+
+#endif
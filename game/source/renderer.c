@@ -3,10 +3,12 @@
 #include "platform.h"
 #include "debug.h"
 #include "vector.h"
+#include "profile.h"
 
 #include "shader.h"
 #include "graphics.h"
 #include "rendertarget.h"
+#include "commandlist.h"
 
 #include "paper_glsl.h"
 #include "pen_glsl.h"
@@ -28,7 +30,29 @@ enum
 {
     MaxPointCount = 1024u,
     MaxCommandCount = 256u,
-    MaxBurnHoleCount = 32u
+    MaxBurnHoleCount = 32u,
+    MaxStrokeVertexCount = 2u * MaxPointCount,   // both sides of each point
+    MaxStrokeIndexCount = 6u * MaxPointCount     // two triangles per segment
+};
+
+// the pages are rendered before the screen reads them
+enum
+{
+    RenderPass_Page,
+    RenderPass_Screen
+};
+
+enum
+{
+    PageLayer_Clear,
+    PageLayer_Draw,
+    PageLayer_Debug
+};
+
+enum
+{
+    ScreenLayer_Page,
+    ScreenLayer_FlippedPage
 };
 
 typedef struct
@@ -36,14 +60,6 @@ typedef struct
     uint    dummy;
 } Mesh;
 
-typedef struct 
-{
-    float           progress;           // current position [0..length]
-    uint            activeSegment;
-    float           segmentProgress;    // 0..length of active segment
-    float           length;
-} Stroke;
-
 typedef struct 
 {
     float           width;
@@ -141,9 +157,13 @@ typedef struct
 
     float           flipTime;
 
-    uint            currentCommand;
-    float           currentCommandTime;
-    Stroke          currentStroke;
+    // the strokes of the current page are uploaded once and the pen shader draws the part between two lengths
+    // along all strokes of the page:
+    uint            uploadedCommandCount;
+    uint            strokeVertexCount;
+    uint            strokeSegmentCount;
+    float           pageStrokeLength;
+    float           drawnStrokeLength;
     StrokeBuffer    strokeBuffer;
 
     PenDefinition   pens[ Pen_Count ];
@@ -151,6 +171,14 @@ typedef struct
 
     Mesh2d          pageFlipMesh;
 
+    StrokeMesh      strokeMesh;
+    StrokeVertex    strokeVertices[ MaxStrokeVertexCount ];
+    Index           strokeIndices[ MaxStrokeIndexCount ];
+    float           strokeSegmentEnds[ MaxPointCount ];     // in the order of the mesh, so it is sorted
+
+    // all draws of a frame, submitted by renderer_drawFrame:
+    CommandList     commandList;
+
     float           strokeDrawSpeed;
     float           delayAfterFlip;
     float           delayAfterDraw;
@@ -262,8 +290,10 @@ static void createPageFlipMesh( Mesh2d* pMesh, uint meshWidth, uint meshHeight )
 
 void renderer_init()
 {
+    graphics_init();
+
     SYS_VERIFY( shader_create( &s_renderer.paperShader, &s_shader_paper, 1u, 1u, 0u ) );
-    SYS_VERIFY( shader_create( &s_renderer.penShader, &s_shader_pen, 0u, 2u, 0u ) );
+    SYS_VERIFY( shader_create( &s_renderer.penShader, &s_shader_pen, 0u, 1u, 0u ) );
     SYS_VERIFY( shader_create( &s_renderer.pageShader, &s_shader_page, 0u, 0u, 3u ) );
     SYS_VERIFY( shader_create( &s_renderer.pageFlipShader, &s_shader_pageflip, 1u, 0u, 2u ) );
     SYS_VERIFY( shader_create( &s_renderer.burnHoleShader, &s_shader_burnhole, 0u, 2u, 1u ) );
@@ -293,7 +323,13 @@ void renderer_init()
     s_renderer.currentPage = 0u;
     s_renderer.lastPage = 1u;
     
-    s_renderer.currentCommand = 0u;
+    graphics_createStrokeMesh( &s_renderer.strokeMesh, MaxStrokeVertexCount, MaxStrokeIndexCount );
+    commandlist_init( &s_renderer.commandList );
+    s_renderer.uploadedCommandCount = 0u;
+    s_renderer.strokeVertexCount = 0u;
+    s_renderer.strokeSegmentCount = 0u;
+    s_renderer.pageStrokeLength = 0.0f;
+    s_renderer.drawnStrokeLength = 0.0f;
 
     s_renderer.pageNumber = 0u;
 
@@ -331,6 +367,8 @@ void renderer_init()
 void renderer_done()
 {
     // :TODO:
+    graphics_destroyStrokeMesh( &s_renderer.strokeMesh );
+    graphics_done();
 }
 
 static float getDelayValue( const float2* pKeys, float maxValue, float x )
@@ -414,10 +452,8 @@ static void drawBurnHole( const BurnHole* pBurnHole )
     }
     
     Page* pPage = &s_renderer.pages[ s_renderer.currentPage ];
-    graphics_setRenderTarget( &pPage->burnTarget );
-    graphics_setShader( &s_renderer.burnHoleShader );
-    graphics_setBlendMode( BlendMode_Over );
-    graphics_setFsTexture( 0, s_renderer.noiseTarget.id, SamplerState_MirrorU_MirrorV_Bilinear );
+    RenderCommand* pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_Quad, RenderPass_Page, PageLayer_Draw, &pPage->burnTarget, &s_renderer.burnHoleShader, BlendMode_Over );
+    rendercommand_setTexture( pCommand, 0, s_renderer.noiseTarget.id, SamplerState_MirrorU_MirrorV_Bilinear );
 
     const float initialSize=pBurnHole->initialSize;
     const float rot=pBurnHole->rot;
@@ -429,8 +465,8 @@ static void drawBurnHole( const BurnHole* pBurnHole )
     const float us=(len+2.0f*s)/10.0f;
     const float vs=2.0f*s/10.0f;
     
-    graphics_setFp4f(0u,start.x,start.y,end.x,end.y);
-    graphics_setFp4f(1u,size,0.0f,0.0f,0.0f);
+    rendercommand_setFp4f(pCommand,0u,start.x,start.y,end.x,end.y);
+    rendercommand_setFp4f(pCommand,1u,size,0.0f,0.0f,0.0f);
 
     float2 dir;
     float2_normalize(float2_sub(&dir, &end, &start));
@@ -438,7 +474,7 @@ static void drawBurnHole( const BurnHole* pBurnHole )
     float2 normal;
     float2_perpendicular(&normal, &dir);
     
-    float2 v[4u];
+    float2* v = pCommand->data.quad.vertices;
     float2_addScaled1f(&v[0u], &start, &normal,  s);
     float2_addScaled1f(&v[1u], &start, &normal, -s);
     float2_addScaled1f(&v[2u], &end, &normal, -s);
@@ -456,7 +492,8 @@ static void drawBurnHole( const BurnHole* pBurnHole )
     float2x2_rotationY(&rotM,rot);
 /*    float2x2_transform(&uv0,&rotM,&uv0);
     float2x2_transform(&uv1,&rotM,&uv1);*/
-    graphics_drawQuad(v,uv0.x,uv0.y,uv1.x,uv1.y);
+    pCommand->data.quad.uv0 = uv0;
+    pCommand->data.quad.uv1 = uv1;
 }
 
 static void renderer_updatePageFlip( float timeStep )
@@ -477,6 +514,11 @@ static void renderer_updatePageFlip( float timeStep )
 
 void renderer_flipPage()
 {
+    SYS_PROFILE_BEGIN( "renderer_flipPage" );
+
+    // anything still pending belongs to the old page and reads its stroke mesh:
+    commandlist_submit( &s_renderer.commandList );
+
     // 
     if( s_renderer.flipTime >= 0.0f )
     {
@@ -486,24 +528,23 @@ void renderer_flipPage()
     s_renderer.lastPage = s_renderer.currentPage;
     s_renderer.currentPage = 1 - s_renderer.currentPage;
 
-    //s_renderer.currentStroke.pDefinition = 0;
-    s_renderer.currentCommand = 0u;
     clearStrokeBuffer( &s_renderer.strokeBuffer );
+    s_renderer.uploadedCommandCount = 0u;
+    s_renderer.strokeVertexCount = 0u;
+    s_renderer.strokeSegmentCount = 0u;
+    s_renderer.pageStrokeLength = 0.0f;
+    s_renderer.drawnStrokeLength = 0.0f;
 
     setPageState( PageState_BeforeDraw );
 
     Page* pPage = &s_renderer.pages[ s_renderer.currentPage ];
     
     // clear current page:
-    graphics_setRenderTarget( &pPage->fgTarget );
-    graphics_setBlendMode( BlendMode_Disabled );
-    graphics_setShader( 0 );
-
-    // 
-    graphics_clear( 0.0f, 0.0f, 0.0f, 0.0f );
+    RenderCommand* pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_Clear, RenderPass_Page, PageLayer_Clear, &pPage->fgTarget, 0, BlendMode_Disabled );
+    float4_set( &pCommand->data.clearColor, 0.0f, 0.0f, 0.0f, 0.0f );
 
-    graphics_setRenderTarget( &pPage->burnTarget );
-    graphics_clear( 0.0f, 0.0f, 0.0f, 0.0f );
+    pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_Clear, RenderPass_Page, PageLayer_Clear, &pPage->burnTarget, 0, BlendMode_Disabled );
+    float4_set( &pCommand->data.clearColor, 0.0f, 0.0f, 0.0f, 0.0f );
 
     for( uint i = 0u; i < SYS_COUNTOF(s_renderer.burnHoles); ++i )
     {
@@ -540,6 +581,7 @@ void renderer_flipPage()
 
     s_renderer.currentVariance=oldVariance;
     //font_
+    SYS_PROFILE_END();
 }
 
 static void transformPoint( float2* pTarget, const float2* pSource, float variance )
@@ -1064,251 +1106,187 @@ void renderer_addCommandStroke( const float2* pPoints, const uint8* pCommands, u
     }
 }
 
-static void startStroke( uint pointIndex, uint pointCount )
+static void setStrokeVertex( StrokeVertex* pVertex, const float2* pPoint, const float2* pNormal, float arc, float strokeStart, float strokeLength, float side, float halfWidth, float variance, const float3* pColor )
 {
-    SYS_ASSERT( pointCount >= 2u );
-
-    Stroke* pStroke = &s_renderer.currentStroke;
-
-    pStroke->progress           = 0.0f;
-    pStroke->activeSegment      = 0u;
-    pStroke->segmentProgress    = 0.0f;
-
-    // compute total length of this stroke:
-    float strokeLength = 0.0f;
-
-    float2 segmentStart = s_renderer.strokeBuffer.points[ pointIndex ];
-    for( uint i = 1u; i < pointCount; ++i )
-    {
-        const float2 segmentEnd = s_renderer.strokeBuffer.points[ pointIndex + i ];
-        float segmentLength = float2_distance( &segmentStart, &segmentEnd );
-
-        strokeLength += segmentLength;
-        segmentStart = segmentEnd;
-    }
-    pStroke->length = strokeLength;
-
-	SYS_ASSERT( strokeLength < 100000.0f );
-
-    //SYS_TRACE_DEBUG( "Starting new stroke (length=%.2f #segments=%i)\n", strokeLength, pointCount - 1u );
+    float4_set( &pVertex->point, pPoint->x, pPoint->y, pNormal->x, pNormal->y );
+    float4_set( &pVertex->arc, arc, strokeStart, strokeLength, side );
+    pVertex->pen.x = halfWidth;
+    pVertex->pen.y = variance;
+    pVertex->color = *pColor;
 }
 
-static int advanceStroke( float* pRemainingTime, float timeStep )
+// appends the strokes added since the last call to the stroke mesh. the first pass over the points of a stroke
+// finds the segment ends along the page and the stroke length, the second one writes two vertices per point and
+// six indices per segment
+static void uploadStrokes()
 {
-    // draw stroke..
-    Page* pPage = &s_renderer.pages[ s_renderer.currentPage ];
-    Stroke* pStroke = &s_renderer.currentStroke;
-    const StrokeCommand* pCommand = &s_renderer.strokeBuffer.commands[ s_renderer.currentCommand ];
-
-    if( !pCommand || pCommand->type != StrokeCommandType_Draw )
-    {
-        SYS_TRACE_ERROR( "no active stroke!\n" );
-        return FALSE;
-    }
-    
-    const StrokeDrawCommandData* pDrawCommand = &pCommand->data.draw;
-
-    graphics_setRenderTarget( &pPage->fgTarget );
-    graphics_setShader( &s_renderer.penShader );
-    graphics_setBlendMode( BlendMode_Over );
-
-    const PenDefinition* pPen = &s_renderer.pens[ pDrawCommand->penId ];
-    const float variance = pDrawCommand->variance;
-
-    // set constant shader parameters:
-    graphics_setFp4f( 0u, 0.5f * pPen->width, variance, 0.05f * variance, 0.0f );
-    graphics_setFp4f( 1u, pPen->color.x, pPen->color.y, pPen->color.z, 1.0f );
-
-    float currentProgress = pStroke->progress;
-    const float strokeLength = pStroke->length;
-    
-    float newProgress;
-    if( s_renderer.strokeDrawSpeed <= 0.0f )
-    {
-        // always finish the whole stroke:
-        newProgress = strokeLength;
-
-        // and we don't need any time:
-        *pRemainingTime = timeStep;
-    }
-    else
+    const uint commandCount = s_renderer.strokeBuffer.commandCount;
+    if( s_renderer.uploadedCommandCount >= commandCount )
     {
-        // how long until we reach the end of this stroke?:
-        const float remainingStrokeTime = ( strokeLength - pStroke->progress ) / s_renderer.strokeDrawSpeed;        
-        const float usedTime = float_min( timeStep, remainingStrokeTime );
-
-        newProgress = pStroke->progress + usedTime * s_renderer.strokeDrawSpeed;
-        *pRemainingTime = timeStep - usedTime;
+        return;
     }
 
-//    SYS_TRACE_DEBUG( "advancing stroke from %f to %f! length=%f\n", currentProgress, newProgress, strokeLength );
-
-    if( newProgress <= currentProgress )
-    {
-        return TRUE;
-    }
+    SYS_PROFILE_BEGIN( "uploadStrokes" );
 
-    const uint segmentCount = pDrawCommand->pointCount - 1u;
-    float remainingLength = newProgress - currentProgress;
+    const uint firstVertex = s_renderer.strokeVertexCount;
+    const uint firstIndex = 6u * s_renderer.strokeSegmentCount;
+    const float ws = 2.0f * ( 64.0f / sys_getScreenWidth() );
 
-    const float2* pStrokePoints = &s_renderer.strokeBuffer.points[ pDrawCommand->pointIndex ];
-    const float2* pStrokeNormals = &s_renderer.strokeBuffer.pointNormals[ pDrawCommand->pointIndex ];
-    
-    while( pStroke->activeSegment < segmentCount && remainingLength > 0.0f )
+    for( uint i = s_renderer.uploadedCommandCount; i < commandCount; ++i )
     {
-        const float2 segmentStart = pStrokePoints[ pStroke->activeSegment ];
-        const float2 segmentEnd = pStrokePoints[ pStroke->activeSegment + 1u ];
-        const float2 segmentNormalStart = pStrokeNormals[ pStroke->activeSegment ];
-        const float2 segmentNormalEnd = pStrokeNormals[ pStroke->activeSegment + 1u ];
-
-        // get remaining length in current segment:
-        float activeSegmentLength = float2_distance( &segmentStart, &segmentEnd );
-
-        if( activeSegmentLength <= 0.0f )
+        const StrokeCommand* pCommand = &s_renderer.strokeBuffer.commands[ i ];
+        if( pCommand->type != StrokeCommandType_Draw )
         {
-            break;
+            continue;
         }
 
-        float remainingSegmentLength = activeSegmentLength - pStroke->segmentProgress;
-        const float segmentAdvance = float_min( remainingSegmentLength, remainingLength );
-
-        // draw segment part:
-        const float partStart = pStroke->segmentProgress;
-        const float partEnd = partStart + segmentAdvance;
-
-        const float strokeU0 = currentProgress / strokeLength;
-        const float strokeU1 = ( currentProgress + segmentAdvance ) / strokeLength;
+        const StrokeDrawCommandData* pDrawCommand = &pCommand->data.draw;
+        SYS_ASSERT( pDrawCommand->pointCount >= 2u );
 
-        const float segmentU0 = partStart / activeSegmentLength;
-        const float segmentU1 = partEnd / activeSegmentLength;
-        
-        // draw the active segment between partStart and partEnd:
-        //SYS_TRACE_DEBUG( "drawing segment part from %f to %f!\n", partStart / activeSegmentLength, partEnd / activeSegmentLength );
-           
-        // compute part 
-
-        // :todo: draw start and end parts if this is the start/end of the segment
-
-        // compute coordinates of quad enclosing the segment part:
-        float2 segmentDir;
-        float2_normalize( float2_sub( &segmentDir, &segmentEnd, &segmentStart ) );
-    
-        float2 normalStart, normalEnd;
-        float2_lerp( &normalStart, &segmentNormalStart, &segmentNormalEnd, segmentU0 );
-        float2_lerp( &normalEnd, &segmentNormalStart, &segmentNormalEnd, segmentU1 );
+        const PenDefinition* pPen = &s_renderer.pens[ pDrawCommand->penId ];
+        const float halfWidth = ws * pPen->width;
+        const float variance = pDrawCommand->variance;
 
-        float2 startPos, endPos;
-        float2_addScaled1f( &startPos, &segmentStart, &segmentDir, partStart );
-        float2_addScaled1f( &endPos, &segmentStart, &segmentDir, partEnd );
+        const float2* pStrokePoints = &s_renderer.strokeBuffer.points[ pDrawCommand->pointIndex ];
+        const float2* pStrokeNormals = &s_renderer.strokeBuffer.pointNormals[ pDrawCommand->pointIndex ];
+        const uint pointCount = pDrawCommand->pointCount;
+        const uint segmentCount = pointCount - 1u;
 
-        const float ws = 2.0f * ( 64.0f / sys_getScreenWidth() );
-        
-        float2 vertices[ 4u ];
-        float2_addScaled1f( &vertices[ 0u ], &startPos, &normalStart,  ws * pPen->width );
-        float2_addScaled1f( &vertices[ 1u ], &startPos, &normalStart, -ws * pPen->width );
-        float2_addScaled1f( &vertices[ 2u ], &endPos, &normalEnd, -ws * pPen->width );
-        float2_addScaled1f( &vertices[ 3u ], &endPos, &normalEnd,  ws * pPen->width );
-
-        const float u0 = strokeU0;
-        const float u1 = strokeU1;
+        SYS_ASSERT( s_renderer.strokeVertexCount + 2u * pointCount <= MaxStrokeVertexCount );
+        SYS_ASSERT( s_renderer.strokeSegmentCount + segmentCount <= MaxPointCount );
 
-        //SYS_TRACE_DEBUG( "u0=%f u1=%f v0=%f,%f v3=%f,%f\n", u0, u1, vertices[ 0u ].x, vertices[ 0u ].y, vertices[ 3u ].x, vertices[ 3u ].y );
+        const float strokeStart = s_renderer.pageStrokeLength;
+        float* pSegmentEnds = &s_renderer.strokeSegmentEnds[ s_renderer.strokeSegmentCount ];
+        float segmentEnd = strokeStart;
+        float strokeLength = 0.0f;
+        for( uint j = 0u; j < segmentCount; ++j )
+        {
+            const float segmentLength = float2_distance( &pStrokePoints[ j ], &pStrokePoints[ j + 1u ] );
+            segmentEnd += segmentLength;
+            strokeLength += segmentLength;
+            pSegmentEnds[ j ] = segmentEnd;
+        }
+        SYS_ASSERT( strokeLength < 100000.0f );
 
-        graphics_drawQuad( vertices, u0, 0.0f, u1, 1.0f );
-        
-        pStroke->segmentProgress += segmentAdvance;
-        remainingLength -= segmentAdvance;
-        currentProgress += segmentAdvance;
+        const uint strokeVertex = s_renderer.strokeVertexCount;
+        StrokeVertex* pVertices = &s_renderer.strokeVertices[ strokeVertex ];
+        for( uint j = 0u; j < pointCount; ++j )
+        {
+            const float arc = j > 0u ? pSegmentEnds[ j - 1u ] : strokeStart;
+            setStrokeVertex( &pVertices[ 2u * j ],      &pStrokePoints[ j ], &pStrokeNormals[ j ], arc, strokeStart, strokeLength,  1.0f, halfWidth, variance, &pPen->color );
+            setStrokeVertex( &pVertices[ 2u * j + 1u ], &pStrokePoints[ j ], &pStrokeNormals[ j ], arc, strokeStart, strokeLength, -1.0f, halfWidth, variance, &pPen->color );
+        }
 
-        if( segmentAdvance >= remainingSegmentLength )
+        // same triangles as graphics_drawQuad:
+        Index* pIndices = &s_renderer.strokeIndices[ 6u * s_renderer.strokeSegmentCount ];
+        for( uint j = 0u; j < segmentCount; ++j )
         {
-            // next segment:
-            pStroke->activeSegment++;
-            pStroke->segmentProgress = 0.0f;
+            const Index start = (Index)( strokeVertex + 2u * j );
+            pIndices[ 6u * j + 0u ] = start;
+            pIndices[ 6u * j + 1u ] = (Index)( start + 1u );
+            pIndices[ 6u * j + 2u ] = (Index)( start + 3u );
+            pIndices[ 6u * j + 3u ] = start;
+            pIndices[ 6u * j + 4u ] = (Index)( start + 3u );
+            pIndices[ 6u * j + 5u ] = (Index)( start + 2u );
         }
-    }
 
-    if( newProgress < strokeLength )
-    {
-        pStroke->progress = newProgress;  
-        return TRUE;
+        s_renderer.strokeVertexCount += 2u * pointCount;
+        s_renderer.strokeSegmentCount += segmentCount;
+        s_renderer.pageStrokeLength += strokeLength;
     }
+    s_renderer.uploadedCommandCount = commandCount;
 
-    return FALSE;
+    const uint indexCount = 6u * s_renderer.strokeSegmentCount - firstIndex;
+    graphics_writeStrokeMesh( &s_renderer.strokeMesh, firstVertex, &s_renderer.strokeVertices[ firstVertex ], s_renderer.strokeVertexCount - firstVertex,
+        firstIndex, &s_renderer.strokeIndices[ firstIndex ], indexCount );
+    SYS_PROFILE_END();
 }
 
-#ifndef SYS_BUILD_MASTER
-void renderer_drawCircle(const float2* pPos, float radius,const float3* pColor)
+// the number of segments of the page that end at or before arc
+static uint countStrokeSegmentsBefore( float arc )
 {
-    Page* pPage = &s_renderer.pages[ s_renderer.currentPage ];
-    graphics_setRenderTarget( &pPage->fgTarget );
-    graphics_setShader( &s_renderer.debugPenShader );
-    graphics_setBlendMode( BlendMode_Over );
+    uint low = 0u;
+    uint high = s_renderer.strokeSegmentCount;
+    while( low < high )
+    {
+        const uint middle = ( low + high ) / 2u;
+        if( s_renderer.strokeSegmentEnds[ middle ] <= arc )
+        {
+            low = middle + 1u;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
 
-    graphics_setFp4f( 0u, pColor->x, pColor->y, pColor->z, 1.0f );
-    graphics_drawCircle(pPos,radius);
+static int isPageDrawn()
+{
+    return s_renderer.drawnStrokeLength >= s_renderer.pageStrokeLength;
 }
-#endif
 
-static void startDrawCommand()
+static void advanceStrokes( float timeStep )
 {
-    if( s_renderer.currentCommand >= s_renderer.strokeBuffer.commandCount )
+    SYS_PROFILE_BEGIN( "advanceStrokes" );
+
+    uploadStrokes();
+
+    float newLength;
+    if( s_renderer.strokeDrawSpeed <= 0.0f )
     {
-        return;
+        // always finish all strokes:
+        newLength = s_renderer.pageStrokeLength;
+    }
+    else
+    {
+        newLength = float_min( s_renderer.pageStrokeLength, s_renderer.drawnStrokeLength + timeStep * s_renderer.strokeDrawSpeed );
     }
-    const StrokeCommand* pCurrentCommand = &s_renderer.strokeBuffer.commands[ s_renderer.currentCommand ];
 
-    switch( pCurrentCommand->type )
+    if( newLength <= s_renderer.drawnStrokeLength )
     {
-    case StrokeCommandType_Draw:
-        startStroke( pCurrentCommand->data.draw.pointIndex, pCurrentCommand->data.draw.pointCount );
-        break;
+        SYS_PROFILE_END();
+        return;
+    }
 
-    case StrokeCommandType_Delay:
-        
-        break;
+    // only the segments touching the part between the old and the new length are drawn, the pen shader drops
+    // the rest of their pixels. the end of the page is drawn inclusive:
+    const uint firstSegment = countStrokeSegmentsBefore( s_renderer.drawnStrokeLength );
+    const uint endSegment = uint_min( countStrokeSegmentsBefore( newLength ) + 1u, s_renderer.strokeSegmentCount );
+    const float drawEnd = newLength < s_renderer.pageStrokeLength ? newLength : newLength + 1.0f;
 
-    default:
-        break;
-    }
+    Page* pPage = &s_renderer.pages[ s_renderer.currentPage ];
+    RenderCommand* pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_StrokeMesh, RenderPass_Page, PageLayer_Draw, &pPage->fgTarget, &s_renderer.penShader, BlendMode_Over );
+    rendercommand_setFp4f( pCommand, 0u, s_renderer.drawnStrokeLength, drawEnd, 0.0f, 0.0f );
+    pCommand->data.strokeMesh.pMesh = &s_renderer.strokeMesh;
+    pCommand->data.strokeMesh.firstIndex = 6u * firstSegment;
+    pCommand->data.strokeMesh.indexCount = 6u * ( endSegment - firstSegment );
+
+    s_renderer.drawnStrokeLength = newLength;
+    SYS_PROFILE_END();
 }
 
-static void updateDrawCommands( float timeStep )
+#ifndef SYS_BUILD_MASTER
+void renderer_drawCircle(const float2* pPos, float radius,const float3* pColor)
 {
-    while( timeStep > 0.0f && s_renderer.currentCommand < s_renderer.strokeBuffer.commandCount )
-    {
-        const StrokeCommand* pCurrentCommand = &s_renderer.strokeBuffer.commands[ s_renderer.currentCommand ];
-//        SYS_TRACE_DEBUG( "command %i/%i remaining time = %f\n", s_renderer.currentCommand, s_renderer.strokeBuffer.commandCount, timeStep );
-        switch( pCurrentCommand->type )
-        {
-        case StrokeCommandType_Draw:
-            if( !advanceStroke( &timeStep, timeStep ) )
-            {
-                s_renderer.currentCommand++;
-                startDrawCommand();
-            }
-            break;
-
-        case StrokeCommandType_Delay:
-            // done..
-            s_renderer.currentCommand++;
-            startDrawCommand();
-            break;
-
-        default:
-            break;
-        }
-    }
+    Page* pPage = &s_renderer.pages[ s_renderer.currentPage ];
+    RenderCommand* pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_Circle, RenderPass_Page, PageLayer_Debug, &pPage->fgTarget, &s_renderer.debugPenShader, BlendMode_Over );
+    rendercommand_setFp4f( pCommand, 0u, pColor->x, pColor->y, pColor->z, 1.0f );
+    pCommand->data.circle.pos = *pPos;
+    pCommand->data.circle.radius = radius;
 }
+#endif
 
 void renderer_flush()
 {
-    startDrawCommand();
-    updateDrawCommands( 0.0f );
+    uploadStrokes();
 }
 
 void renderer_updateState( float timeStep )
 {
+    SYS_PROFILE_BEGIN( "renderer_updateState" );
+
     float newStateTime = s_renderer.stateTime + timeStep;
     switch( s_renderer.pageState )
     {
@@ -1316,7 +1294,6 @@ void renderer_updateState( float timeStep )
         if( newStateTime >= s_renderer.delayAfterFlip )
         {
             setPageState( PageState_Draw );
-            startDrawCommand();
             
             newStateTime -= s_renderer.delayAfterFlip;
             renderer_updateState( newStateTime );
@@ -1329,7 +1306,8 @@ void renderer_updateState( float timeStep )
 
     case PageState_Draw:
         // until the last stroke is done..
-        if( s_renderer.currentCommand >= s_renderer.strokeBuffer.commandCount )
+        uploadStrokes();
+        if( isPageDrawn() )
         {
             setPageState( PageState_AfterDraw );
             renderer_updateState( timeStep );
@@ -1337,7 +1315,7 @@ void renderer_updateState( float timeStep )
         else
         {
             // update current stroke.. 
-            updateDrawCommands( timeStep );
+            advanceStrokes( timeStep );
             // don't flip immediately..
         }
         break;
@@ -1361,6 +1339,7 @@ void renderer_updateState( float timeStep )
     default:
         break;
     }
+    SYS_PROFILE_END();
 }
 
 void renderer_updatePage( float timeStep )
@@ -1420,19 +1399,14 @@ void renderer_drawFrame( const FrameData* pFrame )
     SYS_USE_ARGUMENT( pFrame );
 
     // now render the final screen 
-    graphics_setRenderTarget( 0 );
-
-    graphics_setBlendMode( BlendMode_Disabled );
 
     // render paper:
-    graphics_setShader( &s_renderer.pageShader );
+    RenderCommand* pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_FullscreenQuad, RenderPass_Screen, ScreenLayer_Page, 0, &s_renderer.pageShader, BlendMode_Disabled );
 
     const Page* pCurrentPage=&s_renderer.pages[s_renderer.currentPage];
-    graphics_setFsTexture(0,pCurrentPage->bgTarget.id,SamplerState_ClampU_ClampV_Nearest);
-    graphics_setFsTexture(1,pCurrentPage->fgTarget.id,SamplerState_ClampU_ClampV_Nearest);
-    graphics_setFsTexture(2,pCurrentPage->burnTarget.id,SamplerState_ClampU_ClampV_Nearest);
-    
-    graphics_drawFullscreenQuad();
+    rendercommand_setTexture(pCommand,0,pCurrentPage->bgTarget.id,SamplerState_ClampU_ClampV_Nearest);
+    rendercommand_setTexture(pCommand,1,pCurrentPage->fgTarget.id,SamplerState_ClampU_ClampV_Nearest);
+    rendercommand_setTexture(pCommand,2,pCurrentPage->burnTarget.id,SamplerState_ClampU_ClampV_Nearest);
 
     // render the flipped page on top:
     if( s_renderer.flipTime >= 0.0f )
@@ -1440,18 +1414,21 @@ void renderer_drawFrame( const FrameData* pFrame )
         const float flipProgress=float_saturate( s_renderer.flipTime / s_renderer.flipDuration );
         //SYS_TRACE_DEBUG( "%f (%f/%f)\n", flipProgress, s_renderer.flipTime, s_renderer.flipDuration );
 
-        graphics_setShader( &s_renderer.pageFlipShader );
+        pCommand = commandlist_add( &s_renderer.commandList, RenderCommandType_Mesh2d, RenderPass_Screen, ScreenLayer_FlippedPage, 0, &s_renderer.pageFlipShader, BlendMode_Disabled );
 
         const Page* pLastPage=&s_renderer.pages[s_renderer.lastPage];
-        graphics_setFsTexture(0,pLastPage->bgTarget.id,SamplerState_ClampU_ClampV_Trilinear);
-        graphics_setFsTexture(1,pLastPage->fgTarget.id,SamplerState_ClampU_ClampV_Trilinear);
-        graphics_setFsTexture(2,pLastPage->burnTarget.id,SamplerState_ClampU_ClampV_Trilinear);
+        rendercommand_setTexture(pCommand,0,pLastPage->bgTarget.id,SamplerState_ClampU_ClampV_Trilinear);
+        rendercommand_setTexture(pCommand,1,pLastPage->fgTarget.id,SamplerState_ClampU_ClampV_Trilinear);
+        rendercommand_setTexture(pCommand,2,pLastPage->burnTarget.id,SamplerState_ClampU_ClampV_Trilinear);
 
         float3 flipParams;
         computeFlipParams( &flipParams, flipProgress );
-        graphics_setVp4f( 0u, flipParams.x, flipParams.y, flipParams.z, 0.0f );
-        graphics_drawMesh2d( &s_renderer.pageFlipMesh ); 
+        rendercommand_setVp4f( pCommand, 0u, flipParams.x, flipParams.y, flipParams.z, 0.0f );
+        pCommand->data.pMesh2d = &s_renderer.pageFlipMesh;
     }
+
+    commandlist_submit( &s_renderer.commandList );
+    graphics_finishFrame();
 }
 
 void renderer_addCircle( const Circle* pCircle )
@@ -22,6 +22,11 @@ int rendertarget_create( RenderTarget* pTarget, int width, int height, PixelForm
     pTarget->height = height;
     pTarget->format = format;
 
+    // the graphics layer caches these bindings, so they are restored afterwards:
+    int currentTexture, currentFramebuffer;
+    glGetIntegerv( GL_TEXTURE_BINDING_2D, &currentTexture );
+    glGetIntegerv( GL_FRAMEBUFFER_BINDING, &currentFramebuffer );
+
     // create the color buffer:
     glGenTextures( 1, &pTarget->colorBuffer0 );
     glBindTexture( GL_TEXTURE_2D, pTarget->colorBuffer0 );
@@ -31,7 +36,7 @@ int rendertarget_create( RenderTarget* pTarget, int width, int height, PixelForm
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
 //    glTexParameteri( GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE );
     glTexImage2D( GL_TEXTURE_2D, 0, glFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
-    glBindTexture( GL_TEXTURE_2D, 0 );
+    glBindTexture( GL_TEXTURE_2D, ( uint )currentTexture );
                                         
     // todo: optional depth buffer..
 
@@ -45,11 +50,11 @@ int rendertarget_create( RenderTarget* pTarget, int width, int height, PixelForm
     if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
     {
         SYS_TRACE_ERROR( "Could not create framebuffer!\n" );
+        glBindFramebuffer( GL_FRAMEBUFFER, ( uint )currentFramebuffer );
         return FALSE;
     }
                                                                                                 
-    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-    glBindTexture( GL_TEXTURE_2D, 0 );
+    glBindFramebuffer( GL_FRAMEBUFFER, ( uint )currentFramebuffer );
 
     return TRUE;
 }
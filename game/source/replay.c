@@ -0,0 +1,332 @@
+#include "replay.h"
+#include "platform.h"
+#include "input.h"
+#include "debug.h"
+
+#include <string.h>
+
+enum
+{
+	ReplayFirstInputId			= 2u,		// the client sends input 2 in its first tick, so tick i of a replay is input i + 2
+	ReplayCheckMaxTickGap		= 10u * ServerTickRate,
+	ReplayCheckMaxButtonRuns	= 8u,		// inputs with different buttons between two snapshots
+	ReplayCheckMaxCandidates	= 256u		// input orders simulated for the ticks between two snapshots
+};
+
+// the address of the own player in the simulation, only compared with itself
+static const IP4Address s_replayAddress = { InvalidIP, 0u };
+
+int replay_startRecording( ReplayRecorder* pRecorder, const char* pFileName )
+{
+	pRecorder->tickCount = 0u;
+	pRecorder->pFile = fopen( pFileName, "wb" );
+	if( !pRecorder->pFile )
+	{
+		SYS_TRACE_ERROR( "Could not open file '%s'\n", pFileName );
+		return FALSE;
+	}
+
+	uint8 header[ ReplayFileTickOffset ];
+	memset( header, 0, sizeof( header ) );
+
+	ReplayFileHeader* pHeader = (ReplayFileHeader*)header;
+	pHeader->magic		= ReplayFileMagic;
+	pHeader->version	= ReplayFileVersion;
+	pHeader->tickOffset	= ReplayFileTickOffset;
+	pHeader->tickSize	= sizeof( ReplayTick );
+
+	if( fwrite( header, sizeof( header ), 1u, pRecorder->pFile ) != 1u )
+	{
+		replay_stopRecording( pRecorder );
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void replay_recordTick( ReplayRecorder* pRecorder, uint buttonMask, const ClientGameState* pGameState )
+{
+	if( !pRecorder->pFile )
+	{
+		return;
+	}
+
+	ReplayTick tick;
+	memset( &tick, 0, sizeof( tick ) );
+	tick.buttonMask	= buttonMask;
+	tick.gameState	= *pGameState;
+
+	if( fwrite( &tick, sizeof( tick ), 1u, pRecorder->pFile ) != 1u )
+	{
+		SYS_TRACE_WARNING( "replay recording stopped after %u ticks, the file can't be written\n", pRecorder->tickCount );
+		replay_stopRecording( pRecorder );
+		return;
+	}
+	pRecorder->tickCount++;
+}
+
+void replay_stopRecording( ReplayRecorder* pRecorder )
+{
+	if( pRecorder->pFile )
+	{
+		fclose( pRecorder->pFile );
+		pRecorder->pFile = NULL;
+	}
+}
+
+int replay_load( Replay* pReplay, const char* pFileName )
+{
+	pReplay->pData = sys_mapFile( pFileName, &pReplay->size );
+	if( !pReplay->pData )
+	{
+		return FALSE;
+	}
+
+	const ReplayFileHeader* pHeader = (const ReplayFileHeader*)pReplay->pData;
+	if( pReplay->size < ReplayFileTickOffset || pHeader->magic != ReplayFileMagic || pHeader->version != ReplayFileVersion ||
+		pHeader->tickOffset != ReplayFileTickOffset || pHeader->tickSize != sizeof( ReplayTick ) )
+	{
+		SYS_TRACE_WARNING( "'%s' is not a valid replay file (version %u)\n", pFileName, ReplayFileVersion );
+		replay_unload( pReplay );
+		return FALSE;
+	}
+
+	pReplay->pTicks		= (const ReplayTick*)( (const uint8*)pReplay->pData + ReplayFileTickOffset );
+	pReplay->tickCount	= ( pReplay->size - ReplayFileTickOffset ) / (uint)sizeof( ReplayTick );
+	return TRUE;
+}
+
+void replay_unload( Replay* pReplay )
+{
+	if( pReplay->pData )
+	{
+		sys_unmapFile( pReplay->pData, pReplay->size );
+		pReplay->pData = NULL;
+	}
+	pReplay->pTicks		= NULL;
+	pReplay->tickCount	= 0u;
+}
+
+void replaycheck_init( ReplayCheck* pCheck )
+{
+	server_initGameState( &pCheck->states[ 0u ], ServerTickRate );
+	pCheck->stateCount	= 1u;
+	pCheck->playerIndex	= MaxPlayer;
+	pCheck->inputId		= 0u;
+	pCheck->isActive	= TRUE;
+}
+
+static uint replaycheck_getButtons( const Replay* pReplay, uint inputId )
+{
+	const uint tickIndex = inputId - ReplayFirstInputId;
+	return tickIndex < pReplay->tickCount ? ( pReplay->pTicks[ tickIndex ].buttonMask & Button_PlayerMask ) : 0u;
+}
+
+static void replaycheck_stop( ReplayCheck* pCheck, uint32 tick, const char* pReason )
+{
+	SYS_TRACE_WARNING( "the replay is only checked up to tick %u: %s\n", tick, pReason );
+	SYS_USE_ARGUMENT( tick );
+	SYS_USE_ARGUMENT( pReason );
+	pCheck->isActive = FALSE;
+}
+
+// keeps the candidate state for the next tick, unless an equal one is already kept. returns FALSE if there are too many
+static int replaycheck_keepCandidate( ReplayCheck* pCheck, uint* pNextStateCount )
+{
+	for( uint i = 0u; i < *pNextStateCount; ++i )
+	{
+		if( memcmp( &pCheck->nextStates[ i ], &pCheck->candidateState, sizeof( pCheck->candidateState ) ) == 0 )
+		{
+			return TRUE;
+		}
+	}
+	if( *pNextStateCount == ReplayCheckMaxStates )
+	{
+		return FALSE;
+	}
+	pCheck->nextStates[ ( *pNextStateCount )++ ] = pCheck->candidateState;
+	return TRUE;
+}
+
+int replaycheck_tick( ReplayCheck* pCheck, ClientGameState* pState, const Replay* pReplay, uint tickIndex, const World* pWorld )
+{
+	SYS_ASSERT( tickIndex < pReplay->tickCount );
+	const ClientGameState* pRecordedState = &pReplay->pTicks[ tickIndex ].gameState;
+	const uint32 lastTick = pCheck->states[ 0u ].id;
+	if( !pCheck->isActive || pRecordedState->id <= lastTick )
+	{
+		return FALSE;
+	}
+	if( pRecordedState->id & ServerFlagOffline )
+	{
+		pCheck->isActive = FALSE;
+		return FALSE;
+	}
+	if( pRecordedState->id - lastTick > ReplayCheckMaxTickGap )
+	{
+		replaycheck_stop( pCheck, lastTick, "too many snapshots are missing" );
+		return FALSE;
+	}
+
+	uint playerIndex = MaxPlayer;
+	for( uint i = 0u; i < SYS_COUNTOF( pRecordedState->player ); ++i )
+	{
+		if( pRecordedState->player[ i ].state == PlayerState_InActive )
+		{
+			continue;
+		}
+		if( playerIndex < MaxPlayer )
+		{
+			replaycheck_stop( pCheck, lastTick, "another player joined the match" );
+			return FALSE;
+		}
+		playerIndex = i;
+	}
+	if( pCheck->playerIndex < MaxPlayer && playerIndex != pCheck->playerIndex )
+	{
+		replaycheck_stop( pCheck, lastTick, "the own player left the match" );
+		return FALSE;
+	}
+
+	ClientState inputs[ ReplayCheckMaxButtonRuns ];
+	uint runCount = 0u;
+	uint inputId = 0u;
+	uint32 inputTick = pRecordedState->id + 1u;
+	if( playerIndex < MaxPlayer )
+	{
+		const ClientPlayer* pPlayer = &pRecordedState->player[ playerIndex ];
+
+		// the snapshot only has the low bits of the input id:
+		const uint firstInputId = uint_max( pCheck->inputId, ReplayFirstInputId );
+		inputId = pCheck->inputId + (uint16)( pPlayer->inputId - (uint16)pCheck->inputId );
+
+		// the first snapshot of the player isn't always the one of the tick it joined in. it spawned in that tick,
+		// and the age counts the ticks since then including the current one:
+		inputTick = lastTick + 1u;
+		if( pCheck->playerIndex == MaxPlayer )
+		{
+			inputTick = pRecordedState->id + 1u - pPlayer->age / pCheck->states[ 0u ].tickScale;
+			if( inputTick <= lastTick || inputTick > pRecordedState->id )
+			{
+				replaycheck_stop( pCheck, lastTick, "the own player joined in an unknown tick" );
+				return FALSE;
+			}
+		}
+
+		// the server used one of the inputs between the last known one and this one in each tick without a snapshot.
+		// consecutive inputs with the same buttons simulate the same, each run of them is one candidate input:
+		for( uint id = firstInputId; id <= inputId; ++id )
+		{
+			const uint buttonMask = replaycheck_getButtons( pReplay, id );
+			if( runCount == 0u || buttonMask != inputs[ runCount - 1u ].buttonMask )
+			{
+				if( runCount == ReplayCheckMaxButtonRuns )
+				{
+					replaycheck_stop( pCheck, lastTick, "too many button changes between two snapshots" );
+					return FALSE;
+				}
+				ClientState* pInput = &inputs[ runCount++ ];
+				memset( pInput, 0, sizeof( *pInput ) );
+				pInput->flags		= ClientStateFlag_Online;
+				pInput->buttonMask	= (uint8)buttonMask;
+				copyString( pInput->name, sizeof( pInput->name ), pPlayer->name );
+			}
+			inputs[ runCount - 1u ].id = id;
+		}
+		if( runCount == 0u )
+		{
+			replaycheck_stop( pCheck, lastTick, "the snapshot has an unknown input" );
+			return FALSE;
+		}
+	}
+
+	// every order of the runs over the ticks without a snapshot is a candidate. runStarts[ i ] is the first of these
+	// ticks that uses run i, runs can be skipped:
+	const uint tickCount = pRecordedState->id - uint_min( inputTick, pRecordedState->id );
+	uint candidateCount = 1u;
+	for( uint i = 1u; i < runCount && candidateCount <= ReplayCheckMaxCandidates; ++i )
+	{
+		candidateCount = candidateCount * ( tickCount + i ) / i;
+	}
+	if( candidateCount > ReplayCheckMaxCandidates )
+	{
+		replaycheck_stop( pCheck, lastTick, "too many button changes without a snapshot" );
+		return FALSE;
+	}
+
+	uint nextStateCount = 0u;
+	for( uint state = 0u; state < pCheck->stateCount; ++state )
+	{
+		uint runStarts[ ReplayCheckMaxButtonRuns ];
+		memset( runStarts, 0, sizeof( runStarts ) );
+		for( uint candidate = 0u; candidate < candidateCount; ++candidate )
+		{
+			ServerGameState* pGameState = &pCheck->candidateState;
+			*pGameState = pCheck->states[ state ];
+			for( uint32 tick = lastTick + 1u; tick <= pRecordedState->id; ++tick )
+			{
+				if( tick >= inputTick )
+				{
+					uint run = runCount - 1u;
+					if( tick < pRecordedState->id )
+					{
+						run = 0u;
+						while( run + 1u < runCount && runStarts[ run + 1u ] <= tick - inputTick )
+						{
+							run++;
+						}
+					}
+					server_receiveInput( pGameState, &inputs[ run ], &s_replayAddress, pWorld );
+				}
+				server_tick( pGameState, pWorld );
+			}
+
+			// without any match the check reports the first candidate:
+			ClientGameState snapshot;
+			server_getSnapshot( &snapshot, pGameState );
+			if( state == 0u && candidate == 0u )
+			{
+				*pState = snapshot;
+			}
+			if( snapshot.hash == pRecordedState->hash )
+			{
+				if( !replaycheck_keepCandidate( pCheck, &nextStateCount ) )
+				{
+					replaycheck_stop( pCheck, lastTick, "too many input orders match the snapshots" );
+					return FALSE;
+				}
+				*pState = snapshot;
+			}
+
+			// the next non-decreasing run starts, the first run always starts at the first tick:
+			if( runCount > 1u )
+			{
+				uint i = runCount - 1u;
+				while( i > 1u && runStarts[ i ] == tickCount )
+				{
+					i--;
+				}
+				runStarts[ i ]++;
+				for( uint j = i + 1u; j < runCount; ++j )
+				{
+					runStarts[ j ] = runStarts[ i ];
+				}
+			}
+		}
+	}
+
+	if( nextStateCount == 0u )
+	{
+		// the desync is reported by the client, the check can't go on from here:
+		pCheck->isActive = FALSE;
+		return TRUE;
+	}
+
+	for( uint i = 0u; i < nextStateCount; ++i )
+	{
+		pCheck->states[ i ] = pCheck->nextStates[ i ];
+	}
+	pCheck->stateCount	= nextStateCount;
+	pCheck->playerIndex	= playerIndex;
+	pCheck->inputId		= inputId;
+	return TRUE;
+}
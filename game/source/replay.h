@@ -0,0 +1,81 @@
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+#include "types.h"
+#include "client.h"
+#include "server.h"
+
+#include <stdio.h>
+
+// a replay file is a header followed by one ReplayTick per client tick of a match: the buttons of the player and the
+// newest snapshot the client had after the tick. playing it back needs neither a server nor the network
+enum
+{
+	ReplayFileMagic			= 0x59525050u,		// 'PPRY' on little endian machines
+	ReplayFileVersion		= 2u,				// has to be bumped for every change to ClientGameState
+	ReplayFileTickOffset	= 64u
+};
+
+typedef struct
+{
+	uint32	magic;
+	uint32	version;
+	uint32	tickOffset;
+	uint32	tickSize;		// sizeof( ReplayTick ) of the writer
+} ReplayFileHeader;
+
+typedef struct
+{
+	uint32			buttonMask;
+	ClientGameState	gameState;
+} ReplayTick;
+
+typedef struct
+{
+	FILE*			pFile;
+	uint			tickCount;
+} ReplayRecorder;
+
+int		replay_startRecording( ReplayRecorder* pRecorder, const char* pFileName );
+void	replay_recordTick( ReplayRecorder* pRecorder, uint buttonMask, const ClientGameState* pGameState );
+void	replay_stopRecording( ReplayRecorder* pRecorder );
+
+typedef struct
+{
+	const void*			pData;
+	uint				size;
+	const ReplayTick*	pTicks;
+	uint				tickCount;
+} Replay;
+
+// maps the file, the ticks are used from the mapping. the tick count follows from the file size,
+// so the file of a crashed recording still plays up to its last complete tick
+int		replay_load( Replay* pReplay, const char* pFileName );
+void	replay_unload( Replay* pReplay );
+
+// runs the recorded buttons of the own player through a new simulation, so its snapshots can be checked against the
+// recorded ones. the inputs of other players are not recorded, the check stops when a second player is in the match.
+// without a snapshot for every tick, more than one order of the inputs can match, all of them are simulated on
+enum
+{
+	ReplayCheckMaxStates	= 8u
+};
+
+typedef struct
+{
+	ServerGameState		states[ ReplayCheckMaxStates ];		// the simulations that matched all snapshots so far
+	ServerGameState		nextStates[ ReplayCheckMaxStates ];
+	ServerGameState		candidateState;
+	uint				stateCount;
+	uint				playerIndex;		// of the own player, MaxPlayer before it joined
+	uint				inputId;			// the last input the simulation used, 0 before the first
+	int					isActive;			// FALSE once the replay can't be checked any further
+} ReplayCheck;
+
+void	replaycheck_init( ReplayCheck* pCheck );
+
+// simulates up to the snapshot of the tick and writes the simulated one to pState. returns FALSE if the tick has no
+// new snapshot or the replay can't be checked from here on
+int		replaycheck_tick( ReplayCheck* pCheck, ClientGameState* pState, const Replay* pReplay, uint tickIndex, const World* pWorld );
+
+#endif
@@ -4,9 +4,37 @@
 #include "vector.h"
 #include "matrix.h"
 #include "geometry.h"
+#include "statehash.h"
+#include "fixed.h"
 #include "debug.h"
+#include "profile.h"
+
+#include <string.h>
 
 static const float s_playerBulletProofAge = 1.0f;
+static const float s_steerSpeed		= 0.08f;
+static const float s_steerDamping	= 0.8f;
+static const float s_maxSpeed		= 0.3f;
+static const float s_maxSteer		= (float)PI * 0.2f;
+static const float s_acceleration	= 0.03f;
+static const float s_forwardDamping	= 0.96f;
+static const float s_sideDamping	= 0.8f;
+
+enum
+{
+	TimerType_Bomb		= 0u,
+	TimerType_Explosion	= 1u << 8u,
+	TimerType_Mask		= 0xff00u,
+	TimerIndex_Mask		= 0x00ffu
+};
+
+enum
+{
+	SpawnCandidateCount	= 8u		// free cells tried per spawn on levels without spawn points
+};
+
+// the address of the player on the local connection, no socket ever receives from it
+static const IP4Address s_localAddress = { InvalidIP, 0u };
 
 static const float2 s_playerStartPositions[] =
 {
@@ -24,84 +52,221 @@ static const float s_playerStartDirections[] =
 	(float)PI * 0.25f * 7.0f
 };
 
-static void bomb_explode( ServerExplosion* pExplosion, const ServerBomb* pBomb, const World* pWorld )
+#ifdef SYS_SIM_FIXED_POINT
+// the simulation state stays on the q16.16 grid: every float in it is the exact value of a fixed point number,
+// and everything that isn't plain ieee arithmetic (sin/cos and the movement code) runs in fixed point
+static inline float sim_snap( float value )
 {
-	if( !pExplosion )
+	return fixed_toFloat( fixed_fromFloat( value ) );
+}
+
+static inline void sim_snap2( float2* pValue )
+{
+	pValue->x = sim_snap( pValue->x );
+	pValue->y = sim_snap( pValue->y );
+}
+
+static inline void sim_rotate( float2* pValue, float angle )
+{
+	fixed2 value;
+	fixed2_fromFloat2( &value, pValue );
+	fixed2_rotate( &value, fixed_fromFloat( angle ) );
+	fixed2_toFloat2( pValue, &value );
+}
+
+static inline uint8 sim_quantizeAngle( float angle )
+{
+	// same mapping as angle_quantize
+	fixed value = fixed_fromFloat( angle ) % FixedTwoPi;
+	if( value < 0 )
 	{
-		return;
+		value += FixedTwoPi;
 	}
+	return (uint8)( (int64)value * 255 / FixedTwoPi );
+}
+#else
+static inline float sim_snap( float value )
+{
+	return value;
+}
 
- 	pExplosion->player		= pBomb->player;
-	pExplosion->position	= pBomb->position;
-	pExplosion->direction	= pBomb->direction;
-	pExplosion->time		= GAMETIMESTEP;
+static inline void sim_snap2( float2* pValue )
+{
+	SYS_USE_ARGUMENT( pValue );
+}
 
-	const float2 borderLines[] = 
+static inline void sim_rotate( float2* pValue, float angle )
+{
+	float2_rotate( pValue, angle );
+}
+
+static inline uint8 sim_quantizeAngle( float angle )
+{
+	return angle_quantize( angle );
+}
+#endif
+
+static uint32 sim_random( ServerGameState* pState )
+{
+	// xorshift32, rand() differs between the c runtimes
+	uint32 x = pState->randomState;
+	x ^= x << 13u;
+	x ^= x >> 17u;
+	x ^= x << 5u;
+	pState->randomState = x;
+	return x;
+}
+
+static float sim_randomRange( ServerGameState* pState, float min, float max )
+{
+	const fixed t = (fixed)( sim_random( pState ) >> 16u );
+	return fixed_toFloat( fixed_fromFloat( min ) + fixed_mul( fixed_fromFloat( max ) - fixed_fromFloat( min ), t ) );
+}
+
+static inline uint sim_toTicks( const ServerGameState* pState, float time )
+{
+	return (uint)( time * (float)pState->tickRate + 0.5f );
+}
+
+typedef struct
+{
+	uint	bombs[ MaxBombs ];		// bomb indices of all detonations in this tick, wave after wave
+	uint	count;
+	int		isQueued[ MaxBombs ];
+
+} DetonationQueue;
+
+static void detonationqueue_clear( DetonationQueue* pQueue )
+{
+	pQueue->count = 0u;
+	for( uint i = 0u; i < SYS_COUNTOF( pQueue->isQueued ); ++i )
 	{
-		{ pWorld->borderMin.x, pWorld->borderMin.y }, { pWorld->borderMax.x, pWorld->borderMin.y },
-		{ pWorld->borderMax.x, pWorld->borderMin.y }, { pWorld->borderMax.x, pWorld->borderMax.y },
-		{ pWorld->borderMax.x, pWorld->borderMax.y }, { pWorld->borderMin.x, pWorld->borderMax.y },
-		{ pWorld->borderMin.x, pWorld->borderMax.y }, { pWorld->borderMin.x, pWorld->borderMin.y },
-	};
+		pQueue->isQueued[ i ] = FALSE;
+	}
+}
 
-	Line line;
-	line.a = pExplosion->position;
-	float direction = pExplosion->direction;
-	for( uint i = 0u; i < 4u; ++i )
+static void detonationqueue_push( DetonationQueue* pQueue, uint bombIndex )
+{
+	if( pQueue->isQueued[ bombIndex ] )
 	{
-		float2_set( &line.b, 1000.0f, 0.0f );
-		float2_rotate( &line.b, direction );
+		return;
+	}
 
-		float minDistace = pBomb->length;
-		for( uint j = 0u; j < SYS_COUNTOF( pWorld->rockz ); ++j )
-		{
-			float distance;
-			if( isCircleCircleIntersectingWithDistance( &pWorld->rockz[ j ], &line, &distance ) )
-			{
-				minDistace = float_min( minDistace, distance );
-			}
-		}
+	// every bomb is queued at most once per tick so this can't overflow:
+	SYS_ASSERT( pQueue->count < SYS_COUNTOF( pQueue->bombs ) );
+	pQueue->isQueued[ bombIndex ] = TRUE;
+	pQueue->bombs[ pQueue->count++ ] = bombIndex;
+}
 
-		for( uint j = 0u; j < SYS_COUNTOF( borderLines ); j += 2u )
+static void detonationqueue_sortWave( DetonationQueue* pQueue, uint waveStart, uint waveEnd )
+{
+	// bombs of one wave go off in index order, independent of the order they were hit in:
+	for( uint i = waveStart + 1u; i < waveEnd; ++i )
+	{
+		const uint bombIndex = pQueue->bombs[ i ];
+		uint j = i;
+		while( j > waveStart && pQueue->bombs[ j - 1u ] > bombIndex )
 		{
-			Line boderLine;
-			boderLine.a = borderLines[ j ];
-			boderLine.b = borderLines[ j + 1u ];
-
-			float distance;
-			if( isLineLineIntersectingWithDistance( &line, &boderLine, &distance ) )
-			{
-				minDistace = float_min( minDistace, distance );
-			}
+			pQueue->bombs[ j ] = pQueue->bombs[ j - 1u ];
+			j--;
 		}
+		pQueue->bombs[ j ] = bombIndex;
+	}
+}
+
+static void explosion_init( ServerExplosion* pExplosion, const ServerBomb* pBomb )
+{
+ 	pExplosion->player		= pBomb->player;
+	pExplosion->position	= pBomb->position;
+	pExplosion->direction	= pBomb->direction;
 
-		pExplosion->length[ i ] = minDistace;
-		direction += HALFPI;
+	for( uint i = 0u; i < SYS_COUNTOF( pExplosion->length ); ++i )
+	{
+		pExplosion->length[ i ] = pBomb->length;
 	}
 }
 
-static void bomb_update( ServerBomb* pBomb, ServerExplosion* pExplosion, const World* pWorld )
+static void explosion_castRays( ServerExplosion* const* ppExplosions, uint explosionCount, const World* pWorld )
 {
-	pBomb->time += GAMETIMESTEP;
-	if( pBomb->time >= s_bombTime )
+	const Line borderLines[] = 
+	{
+		{ { pWorld->borderMin.x, pWorld->borderMin.y }, { pWorld->borderMax.x, pWorld->borderMin.y } },
+		{ { pWorld->borderMax.x, pWorld->borderMin.y }, { pWorld->borderMax.x, pWorld->borderMax.y } },
+		{ { pWorld->borderMax.x, pWorld->borderMax.y }, { pWorld->borderMin.x, pWorld->borderMax.y } },
+		{ { pWorld->borderMin.x, pWorld->borderMax.y }, { pWorld->borderMin.x, pWorld->borderMin.y } },
+	};
+
+	// one ray per explosion arm, all arms of the wave are tested against each obstacle together:
+	RayBatch rays;
+	raybatch_clear( &rays );
+	SYS_ASSERT( explosionCount * 4u <= RayBatchCapacity );
+	for( uint i = 0u; i < explosionCount; ++i )
 	{
-		if( pExplosion )
+		const ServerExplosion* pExplosion = ppExplosions[ i ];
+		float direction = pExplosion->direction;
+		for( uint j = 0u; j < 4u; ++j )
 		{
-			bomb_explode( pExplosion, pBomb, pWorld );
+			Line ray;
+			ray.a = pExplosion->position;
+			float2_set( &ray.b, 1000.0f, 0.0f );
+			sim_rotate( &ray.b, direction );
+			raybatch_add( &rays, &ray, pExplosion->length[ j ] );
+			direction += HALFPI;
 		}
+	}
+
+	world_castRays( pWorld, &rays );
+	raybatch_intersectLines( &rays, borderLines, SYS_COUNTOF( borderLines ) );
 
-		pBomb->time = 0.0f;
+	for( uint i = 0u; i < explosionCount * 4u; ++i )
+	{
+		ppExplosions[ i / 4u ]->length[ i % 4u ] = rays.distance[ i ];
 	}
 }
 
-static void bomb_place( ServerBomb* pBomb, uint player, const float2* pPosition, float direction, float length, const World* pWorld )
+static void explosion_getCapsules( Capsule* pCapsule0, Capsule* pCapsule1, const ServerExplosion* pExplosion )
+{
+	pCapsule0->radius = s_explosionRadius;
+	pCapsule1->radius = s_explosionRadius;
+
+	float2 length0;
+	float2_set( &length0, pExplosion->length[ 0u ], 0.0f );
+	sim_rotate( &length0, pExplosion->direction );
+
+	float2 length1;
+	float2_set( &length1, pExplosion->length[ 2u ], 0.0f );
+	sim_rotate( &length1, pExplosion->direction );
+
+	float2_add( &pCapsule0->line.a, &pExplosion->position, &length0 );
+	float2_sub( &pCapsule0->line.b, &pExplosion->position, &length1 );
+
+	float2 length2;
+	float2_set( &length2, 0.0f, pExplosion->length[ 1u ] );
+	sim_rotate( &length2, pExplosion->direction );
+
+	float2 length3;
+	float2_set( &length3, 0.0f, pExplosion->length[ 3u ] );
+	sim_rotate( &length3, pExplosion->direction );
+
+	float2_add( &pCapsule1->line.a, &pExplosion->position, &length2 );
+	float2_sub( &pCapsule1->line.b, &pExplosion->position, &length3 );
+}
+
+static void bomb_place( ServerBomb* pBomb, uint bombIndex, ServerGameState* pState, uint player, const float2* pPosition, float direction, float length, const World* pWorld )
 {
+	const uint timer = timerwheel_add( &pState->timers, sim_toTicks( pState, s_bombTime ), TimerType_Bomb | bombIndex );
+	if( timer == InvalidTimer )
+	{
+		return;
+	}
+
 	float2 offset;
 	float2_set( &offset, -s_bombCarOffset, 0.0f );
-	float2_rotate( &offset, direction );
+	sim_rotate( &offset, direction );
 
 	pBomb->position = *pPosition;
 	float2_add( &pBomb->position, &pBomb->position, &offset );
+	sim_snap2( &pBomb->position );
 
 	pBomb->position.x = float_clamp( pBomb->position.x, pWorld->borderMin.x + s_bombRadius, pWorld->borderMax.x - s_bombRadius );
 	pBomb->position.y = float_clamp( pBomb->position.y, pWorld->borderMin.y + s_bombRadius, pWorld->borderMax.y - s_bombRadius );
@@ -109,14 +274,15 @@ static void bomb_place( ServerBomb* pBomb, uint player, const float2* pPosition,
 	pBomb->player		= player;
 	pBomb->direction	= direction;
 	pBomb->length		= length;
-	pBomb->time			= GAMETIMESTEP;
+	pBomb->startTick	= pState->timers.currentTick;
+	pBomb->timer		= timer;
 }
 
 static ServerBomb* find_free_bomb( ServerBomb* pBombs, uint size )
 {
 	for( uint i = 0u; i < size; ++i )
 	{
-		if( pBombs[ i ].time == 0.0f )
+		if( pBombs[ i ].timer == InvalidTimer )
 		{
 			return &pBombs[ i ];
 		}
@@ -128,7 +294,7 @@ static ServerExplosion* find_free_explosion( ServerExplosion* pExplosions, uint
 {
 	for( uint i = 0u; i < size; ++i )
 	{
-		if( pExplosions[ i ].time == 0.0f )
+		if( pExplosions[ i ].timer == InvalidTimer )
 		{
 			return &pExplosions[ i ];
 		}
@@ -136,70 +302,331 @@ static ServerExplosion* find_free_explosion( ServerExplosion* pExplosions, uint
 	return 0;
 }
 
-static void player_init( ServerPlayer* pPlayer, const IP4Address* pAddress )
+static uint server_getBombCircles( CircleBatch* pCircles, uint* pBombIndices, const ServerGameState* pState, const DetonationQueue* pQueue )
+{
+	// active bombs that are not going off in this tick already, pBombIndices maps batch to bomb index
+	circlebatch_clear( pCircles );
+	for( uint i = 0u; i < SYS_COUNTOF( pState->bombs ); ++i )
+	{
+		const ServerBomb* pBomb = &pState->bombs[ i ];
+		if( pBomb->timer == InvalidTimer || ( pQueue && pQueue->isQueued[ i ] ) )
+		{
+			continue;
+		}
+
+		Circle bombCircle;
+		bombCircle.center = pBomb->position;
+		bombCircle.radius = s_bombRadius;
+		pBombIndices[ circlebatch_add( pCircles, &bombCircle ) ] = i;
+	}
+	return pCircles->count;
+}
+
+static ServerExplosion* server_startExplosion( ServerGameState* pState, const ServerBomb* pBomb )
+{
+	ServerExplosion* pExplosion = find_free_explosion( pState->explosions, SYS_COUNTOF( pState->explosions ) );
+	if( !pExplosion )
+	{
+		return 0;
+	}
+
+	const uint explosionIndex = (uint)( pExplosion - pState->explosions );
+	const uint timer = timerwheel_add( &pState->timers, sim_toTicks( pState, s_explosionTime ), TimerType_Explosion | explosionIndex );
+	if( timer == InvalidTimer )
+	{
+		return 0;
+	}
+
+	explosion_init( pExplosion, pBomb );
+	pExplosion->startTick	= pState->timers.currentTick;
+	pExplosion->timer		= timer;
+	pExplosion->hasHit		= FALSE;
+	return pExplosion;
+}
+
+static void server_resolveDetonations( ServerGameState* pState, DetonationQueue* pQueue, const World* pWorld )
+{
+	// breadth first: all bombs of a wave explode together, the bombs they hit form the next wave
+	uint waveStart = 0u;
+	while( waveStart < pQueue->count )
+	{
+		const uint waveEnd = pQueue->count;
+		detonationqueue_sortWave( pQueue, waveStart, waveEnd );
+
+		ServerExplosion* waveExplosions[ MaxBombs ];
+		uint waveExplosionCount = 0u;
+		for( uint i = waveStart; i < waveEnd; ++i )
+		{
+			ServerBomb* pBomb = &pState->bombs[ pQueue->bombs[ i ] ];
+
+			// a bomb set off by an explosion still has its fuse running:
+			timerwheel_remove( &pState->timers, pBomb->timer );
+			pBomb->timer = InvalidTimer;
+
+			ServerExplosion* pExplosion = server_startExplosion( pState, pBomb );
+			if( pExplosion )
+			{
+				waveExplosions[ waveExplosionCount++ ] = pExplosion;
+			}
+			else
+			{
+				pState->droppedExplosions++;
+				SYS_TRACE_WARNING( "no free explosion for bomb %u! (%u dropped so far)\n", pQueue->bombs[ i ], pState->droppedExplosions );
+			}
+		}
+
+		explosion_castRays( waveExplosions, waveExplosionCount, pWorld );
+
+		CircleBatch bombCircles;
+		uint bombIndices[ MaxBombs ];
+		if( server_getBombCircles( &bombCircles, bombIndices, pState, pQueue ) == 0u )
+		{
+			break;
+		}
+
+		for( uint i = 0u; i < waveExplosionCount; ++i )
+		{
+			Capsule capsule0;
+			Capsule capsule1;
+			explosion_getCapsules( &capsule0, &capsule1, waveExplosions[ i ] );
+
+			uint32 hitMask = circlebatch_intersectCapsule( &bombCircles, &capsule0 ) | circlebatch_intersectCapsule( &bombCircles, &capsule1 );
+			for( uint j = 0u; hitMask != 0u; ++j, hitMask >>= 1u )
+			{
+				if( hitMask & 1u )
+				{
+					detonationqueue_push( pQueue, bombIndices[ j ] );
+				}
+			}
+		}
+
+		waveStart = waveEnd;
+	}
+}
+
+static inline uint8 tick_age( uint32 currentTick, uint32 startTick )
+{
+	// 1 in the tick the entity was created, 0 is reserved for free slots
+	return (uint8)uint_min( currentTick - startTick + 1u, 255u );
+}
+
+static void player_init( ServerPlayer* pPlayer, const IP4Address* pAddress, const char* pName )
 {
 	pPlayer->playerState	= PlayerState_Active;
 
+	// the name comes from the network and doesn't have to be terminated:
+	for( uint i = 0u; i < sizeof( pPlayer->name ); ++i )
+	{
+		pPlayer->name[ i ] = i + 1u < sizeof( pPlayer->name ) ? pName[ i ] : '\0';
+	}
+
 	pPlayer->address		= *pAddress;
 	pPlayer->lastButtonMask	= 0u;
 	pPlayer->state.id		= 0u;
 	pPlayer->frags			= 0u;
 }
 
-static void player_respawn( ServerPlayer* pPlayer, const float2* pPosition, float direction )
+static void player_respawn( ServerPlayer* pPlayer, const float2* pPosition, float direction, uint32 currentTick )
 {
-	pPlayer->age			= 0.0f;
+	pPlayer->spawnTick		= currentTick;
 	pPlayer->steer			= 0.0f;
 	pPlayer->velocity.x		= 0.0f;
-	pPlayer->position.y		= 0.0f;
+	pPlayer->velocity.y		= 0.0f;
 	pPlayer->position		= *pPosition;
-	pPlayer->direction		= direction;
+	pPlayer->direction		= sim_snap( direction );
 	pPlayer->maxBombs		= StartBombs;
 	pPlayer->bombLength		= s_startBombLength;
+	sim_snap2( &pPlayer->position );
 }
 
-static void player_update( ServerPlayer* pPlayer, uint index, ServerBomb* pBomb, uint activeBombs, World* pWorld )
+// squared distance from the position to the closest live bomb, explosion or other player
+static float server_getSpawnClearance( const ServerGameState* pState, uint playerIndex, const float2* pPosition )
 {
-	const float steerSpeed		= 0.08f;
-	const float steerDamping	= 0.8f;
-	const float maxSpeed		= 0.3f;
-	const float maxSteer		= (float)PI * 0.2f;
+	float clearance = 1e30f;
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
+	{
+		if( i != playerIndex && pState->player[ i ].playerState != PlayerState_InActive )
+		{
+			clearance = float_min( clearance, float2_squareDistance( pPosition, &pState->player[ i ].position ) );
+		}
+	}
+	for( uint i = 0u; i < SYS_COUNTOF( pState->bombs ); ++i )
+	{
+		if( pState->bombs[ i ].timer != InvalidTimer )
+		{
+			clearance = float_min( clearance, float2_squareDistance( pPosition, &pState->bombs[ i ].position ) );
+		}
+	}
+	for( uint i = 0u; i < SYS_COUNTOF( pState->explosions ); ++i )
+	{
+		if( pState->explosions[ i ].timer != InvalidTimer )
+		{
+			Capsule capsule0;
+			Capsule capsule1;
+			explosion_getCapsules( &capsule0, &capsule1, &pState->explosions[ i ] );
 
-	const uint buttonMask		= pPlayer->state.buttonMask;
-	const uint buttonDownMask	= buttonMask & ~pPlayer->lastButtonMask;
-	pPlayer->lastButtonMask		= buttonMask; 
+			float2 closest;
+			getLineClosestPoint( &closest, &capsule0.line, pPosition );
+			clearance = float_min( clearance, float2_squareDistance( pPosition, &closest ) );
+			getLineClosestPoint( &closest, &capsule1.line, pPosition );
+			clearance = float_min( clearance, float2_squareDistance( pPosition, &closest ) );
+		}
+	}
+	return clearance;
+}
 
-	pPlayer->age += GAMETIMESTEP;
+// cars on free cells start facing the middle of the world, on the same diagonals as the default start positions
+static float player_getSpawnDirection( const float2* pPosition, const World* pWorld )
+{
+	const float centerX = 0.5f * ( pWorld->borderMin.x + pWorld->borderMax.x );
+	const float centerY = 0.5f * ( pWorld->borderMin.y + pWorld->borderMax.y );
+	const int facesLeft	= pPosition->x > centerX;
+	const int facesDown	= pPosition->y > centerY;
 
-	if( buttonMask & ButtonMask_Left )
+	if( facesDown )
 	{
-		pPlayer->steer = float_min( pPlayer->steer + steerSpeed, maxSteer );
+		return s_playerStartDirections[ facesLeft ? 2u : 3u ];
 	}
-	else if( buttonMask & ButtonMask_Right )
+	return s_playerStartDirections[ facesLeft ? 1u : 0u ];
+}
+
+static void player_spawn( ServerPlayer* pPlayer, uint playerIndex, ServerGameState* pState, const World* pWorld )
+{
+	const uint candidateCount = pWorld->spawnPointCount > 0u ? pWorld->spawnPointCount : ( pWorld->freeCellCount > 0u ? SpawnCandidateCount : 0u );
+	if( candidateCount == 0u )
+	{
+		player_respawn( pPlayer, &s_playerStartPositions[ playerIndex ], s_playerStartDirections[ playerIndex ], pState->timers.currentTick );
+		return;
+	}
+
+	// the candidate furthest away from everything dangerous wins:
+	float2 bestPosition;
+	float2_set( &bestPosition, 0.0f, 0.0f );
+	float bestDirection = 0.0f;
+	float bestClearance = -1.0f;
+	for( uint i = 0u; i < candidateCount; ++i )
+	{
+		float2 position;
+		float direction;
+		if( pWorld->spawnPointCount > 0u )
+		{
+			position	= pWorld->spawnPoints[ i ].position;
+			direction	= pWorld->spawnPoints[ i ].direction;
+		}
+		else
+		{
+			position	= pWorld->freeCells[ sim_random( pState ) % pWorld->freeCellCount ];
+			direction	= player_getSpawnDirection( &position, pWorld );
+		}
+
+		const float clearance = server_getSpawnClearance( pState, playerIndex, &position );
+		if( clearance > bestClearance )
+		{
+			bestPosition	= position;
+			bestDirection	= direction;
+			bestClearance	= clearance;
+		}
+	}
+
+	player_respawn( pPlayer, &bestPosition, bestDirection, pState->timers.currentTick );
+}
+
+#ifdef SYS_SIM_FIXED_POINT
+static fixed fixed_powUint( fixed value, uint exponent )
+{
+	fixed result = FixedOne;
+	for( uint i = 0u; i < exponent; ++i )
 	{
-		pPlayer->steer = float_max( pPlayer->steer - steerSpeed, -maxSteer );
+		result = fixed_mul( result, value );
+	}
+	return result;
+}
+
+static void player_move( ServerPlayer* pPlayer, float2* pDisplacement, int steerInput, int accelerationInput, uint tickScale )
+{
+	// same integration as the float version below, in q16.16:
+	const fixed scale = (fixed)tickScale;
+
+	fixed steer = fixed_fromFloat( pPlayer->steer );
+	if( steerInput > 0 )
+	{
+		steer = fixed_min( steer + fixed_fromFloat( s_steerSpeed ) * scale, fixed_fromFloat( s_maxSteer ) );
+	}
+	else if( steerInput < 0 )
+	{
+		steer = fixed_max( steer - fixed_fromFloat( s_steerSpeed ) * scale, -fixed_fromFloat( s_maxSteer ) );
 	}
 	else
 	{
-		pPlayer->steer *= steerDamping;
+		steer = fixed_mul( steer, fixed_powUint( fixed_fromFloat( s_steerDamping ), tickScale ) );
 	}
 
-	float acceleration = 0.0f;
-	if( buttonMask & ButtonMask_Up )
+	fixed2 velocity;
+	fixed2_fromFloat2( &velocity, &pPlayer->velocity );
+	fixed direction = fixed_fromFloat( pPlayer->direction );
+
+	fixed2 directionVector;
+	fixed2_fromAngle( &directionVector, direction );
+
+	direction = fixed_normalizeAngle( direction + fixed_mul( fixed2_dot( &directionVector, &velocity ), steer ) * scale );
+
+	fixed2 velocityNormalized = velocity;
+	fixed2_normalize0( &velocityNormalized );
+
+	fixed2 velocityForward;
+	fixed2_scale1f( &velocityForward, &velocity, fixed_abs( fixed2_dot( &directionVector, &velocityNormalized ) ) );
+
+	fixed2 velocitySide;
+	fixed2_sub( &velocitySide, &velocity, &velocityForward );
+
+	fixed2 newVelocity;
+	fixed2_set( &newVelocity, accelerationInput * fixed_fromFloat( s_acceleration ) * scale, 0 );
+	fixed2_rotate( &newVelocity, direction );
+	fixed2_addScaled1f( &newVelocity, &newVelocity, &velocityForward, fixed_powUint( fixed_fromFloat( s_forwardDamping ), tickScale ) );
+	fixed2_addScaled1f( &newVelocity, &newVelocity, &velocitySide, fixed_powUint( fixed_fromFloat( s_sideDamping ), tickScale ) );
+
+	const fixed maxSpeed = fixed_fromFloat( s_maxSpeed );
+	const fixed speed = fixed2_length( &newVelocity );
+	if( speed > maxSpeed )
 	{
-		acceleration = 0.03f;
+		fixed2_scale1f( &newVelocity, &newVelocity, fixed_div( maxSpeed, speed ) );
 	}
-	else if( buttonMask & ButtonMask_Down )
-	{ 
-		acceleration = -0.03f;
+
+	fixed2 displacement;
+	fixed2_set( &displacement, newVelocity.x * scale, newVelocity.y * scale );
+
+	pPlayer->steer		= fixed_toFloat( steer );
+	pPlayer->direction	= fixed_toFloat( direction );
+	fixed2_toFloat2( &pPlayer->velocity, &newVelocity );
+	fixed2_toFloat2( pDisplacement, &displacement );
+}
+#else
+static float float_powUint( float value, uint exponent )
+{
+	float result = 1.0f;
+	for( uint i = 0u; i < exponent; ++i )
+	{
+		result *= value;
 	}
+	return result;
+}
 
-	if( buttonDownMask & ButtonMask_PlaceBomb )
+static void player_move( ServerPlayer* pPlayer, float2* pDisplacement, int steerInput, int accelerationInput, uint tickScale )
+{
+	// velocity and steering are in units per GAMETIMESTEP, one server tick covers tickScale of them
+	const float scale = (float)tickScale;
+
+	if( steerInput > 0 )
 	{
-		if( ( pPlayer->maxBombs > activeBombs ) && pBomb )
-		{
-			bomb_place( pBomb, index, &pPlayer->position, pPlayer->direction, pPlayer->bombLength, pWorld );
-		}
+		pPlayer->steer = float_min( pPlayer->steer + s_steerSpeed * scale, s_maxSteer );
+	}
+	else if( steerInput < 0 )
+	{
+		pPlayer->steer = float_max( pPlayer->steer - s_steerSpeed * scale, -s_maxSteer );
+	}
+	else
+	{
+		pPlayer->steer *= float_powUint( s_steerDamping, tickScale );
 	}
 
 	float2 directionVector;
@@ -207,7 +634,7 @@ static void player_update( ServerPlayer* pPlayer, uint index, ServerBomb* pBomb,
 
 	float dirVecDot = float2_dot( &directionVector, &pPlayer->velocity );
 
-	pPlayer->direction += dirVecDot * pPlayer->steer;
+	pPlayer->direction += dirVecDot * pPlayer->steer * scale;
 
 	float2 velocityNormalized = pPlayer->velocity;
 	float2_normalize0( &velocityNormalized );
@@ -220,34 +647,107 @@ static void player_update( ServerPlayer* pPlayer, uint index, ServerBomb* pBomb,
 	float2_sub( &velocitySide, &pPlayer->velocity, &velocityForward );
 
 	float2 velocity;
-	velocity.x = acceleration;
+	velocity.x = (float)accelerationInput * s_acceleration * scale;
 	velocity.y = 0.0f;
 
 	float2_rotate( &velocity, pPlayer->direction );
-	float2_addScaled1f( &velocity, &velocity, &velocityForward, 0.96f );
-	float2_addScaled1f( &velocity, &velocity, &velocitySide, 0.8f );
+	float2_addScaled1f( &velocity, &velocity, &velocityForward, float_powUint( s_forwardDamping, tickScale ) );
+	float2_addScaled1f( &velocity, &velocity, &velocitySide, float_powUint( s_sideDamping, tickScale ) );
 
 	pPlayer->velocity = velocity; 
 
 	const float speed = float_abs( float2_length( &pPlayer->velocity ) );
-	if( speed > maxSpeed )
+	if( speed > s_maxSpeed )
 	{
-		float2_scale1f( &pPlayer->velocity, &pPlayer->velocity, maxSpeed / speed );
+		float2_scale1f( &pPlayer->velocity, &pPlayer->velocity, s_maxSpeed / speed );
 	}
 
 	//	SYS_TRACE_DEBUG( "speed %.4f\n", speed );
 
-	float2_add( &pPlayer->position, &pPlayer->position, &pPlayer->velocity );
-
-	pPlayer->position.x = float_clamp( pPlayer->position.x, pWorld->borderMin.x + s_carRadius, pWorld->borderMax.x - s_carRadius );
-	pPlayer->position.y = float_clamp( pPlayer->position.y, pWorld->borderMin.y + s_carRadius, pWorld->borderMax.y - s_carRadius );
+	float2_scale1f( pDisplacement, &pPlayer->velocity, scale );
 }
+#endif
+
+static void player_update( ServerGameState* pState, uint index, ServerBomb* pBomb, uint bombIndex, uint activeBombs, const World* pWorld )
+{
+	ServerPlayer* pPlayer = &pState->player[ index ];
+
+	const uint buttonMask		= pPlayer->state.buttonMask;
+	const uint buttonDownMask	= buttonMask & ~pPlayer->lastButtonMask;
+	pPlayer->lastButtonMask		= buttonMask; 
+
+	int steerInput = 0;
+	if( buttonMask & ButtonMask_Left )
+	{
+		steerInput = 1;
+	}
+	else if( buttonMask & ButtonMask_Right )
+	{
+		steerInput = -1;
+	}
+
+	int accelerationInput = 0;
+	if( buttonMask & ButtonMask_Up )
+	{
+		accelerationInput = 1;
+	}
+	else if( buttonMask & ButtonMask_Down )
+	{ 
+		accelerationInput = -1;
+	}
+
+	if( buttonDownMask & ButtonMask_PlaceBomb )
+	{
+		if( ( pPlayer->maxBombs > activeBombs ) && pBomb )
+		{
+			bomb_place( pBomb, bombIndex, pState, index, &pPlayer->position, pPlayer->direction, pPlayer->bombLength, pWorld );
+		}
+	}
+
+	float2 displacement;
+	player_move( pPlayer, &displacement, steerInput, accelerationInput, pState->tickScale );
+
+	Circle playerCircle;
+	playerCircle.center = pPlayer->position;
+	playerCircle.radius = s_carRadius;
+
+	// swept against everything that blocks the car, so it can't tunnel through at low tick rates.
+	// overlaps that exist at the start of the move are resolved by the collision pass
+	Capsule obstacles[ MaxWorldSweepObstacles + MaxBombs + MaxPlayer ];
+	uint obstacleCount = world_getSweepObstacles( pWorld, obstacles, MaxWorldSweepObstacles, &playerCircle, &displacement );
+	for( uint i = 0u; i < SYS_COUNTOF( pState->bombs ); ++i )
+	{
+		if( pState->bombs[ i ].timer != InvalidTimer )
+		{
+			obstacles[ obstacleCount ].line.a = pState->bombs[ i ].position;
+			obstacles[ obstacleCount ].line.b = pState->bombs[ i ].position;
+			obstacles[ obstacleCount ].radius = s_bombRadius;
+			obstacleCount++;
+		}
+	}
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
+	{
+		if( i != index && pState->player[ i ].playerState != PlayerState_InActive )
+		{
+			obstacles[ obstacleCount ].line.a = pState->player[ i ].position;
+			obstacles[ obstacleCount ].line.b = pState->player[ i ].position;
+			obstacles[ obstacleCount ].radius = s_carRadius;
+			obstacleCount++;
+		}
+	}
+
+	sweepCircle( &playerCircle, &displacement, obstacles, obstacleCount, &pWorld->borderMin, &pWorld->borderMax );
 
+	pPlayer->position = playerCircle.center;
+	sim_snap2( &pPlayer->position );
+}
 
-static void create_client_state( ClientGameState* pClientState, const ServerGameState* pServerState )
+void server_getSnapshot( ClientGameState* pClientState, const ServerGameState* pServerState )
 {
 	pClientState->id = pServerState->id;
 
+	const uint32 currentTick = pServerState->timers.currentTick;
+
 	for( uint i = 0u; i < SYS_COUNTOF( pServerState->player ); ++i )
 	{
 		ClientPlayer* pClient = &pClientState->player[ i ];
@@ -259,10 +759,11 @@ static void create_client_state( ClientGameState* pClientState, const ServerGame
 			copyString( pClient->name, sizeof( pClient->name ), pServer->name );
 			pClient->posX		= float_quantize( pServer->position.x );
 			pClient->posY		= float_quantize( pServer->position.y );
-			pClient->direction	= angle_quantize( pServer->direction );
-			pClient->age		= time_quantize( pServer->age );
-			pClient->steer		= angle_quantize( pServer->steer );
+			pClient->direction	= sim_quantizeAngle( pServer->direction );
+			pClient->age		= (uint16)uint_min( ( currentTick - pServer->spawnTick ) * pServerState->tickScale, 0xffffu );	// in GAMETIMESTEPs, like time_quantize
+			pClient->steer		= sim_quantizeAngle( pServer->steer );
 			pClient->frags		= (int8)int_clamp( pServer->frags, -128, 127 );
+			pClient->inputId	= (uint16)pServer->state.id;
 		}
 	}
 
@@ -271,10 +772,10 @@ static void create_client_state( ClientGameState* pClientState, const ServerGame
 		ClientBomb* pClient = &pClientState->bombs[ i ];
 		const ServerBomb* pServer = &pServerState->bombs[ i ];
 
-		pClient->time		= time8_quantize( pServer->time );
+		pClient->time		= pServer->timer != InvalidTimer ? tick_age( currentTick, pServer->startTick ) : 0u;
 		pClient->posX		= float_quantize( pServer->position.x );
 		pClient->posY		= float_quantize( pServer->position.y );
-		pClient->direction	= angle_quantize( pServer->direction );
+		pClient->direction	= sim_quantizeAngle( pServer->direction );
 		pClient->length		= (uint8)pServer->length;
 	}
 
@@ -283,10 +784,10 @@ static void create_client_state( ClientGameState* pClientState, const ServerGame
 		ClientExplosion* pClient = &pClientState->explosions[ i ];
 		const ServerExplosion* pServer = &pServerState->explosions[ i ];
 
-		pClient->time			= time8_quantize( pServer->time );
+		pClient->time			= pServer->timer != InvalidTimer ? tick_age( currentTick, pServer->startTick ) : 0u;
 		pClient->posX			= float_quantize( pServer->position.x );
 		pClient->posY			= float_quantize( pServer->position.y );
-		pClient->direction		= angle_quantize( pServer->direction );
+		pClient->direction		= sim_quantizeAngle( pServer->direction );
 		pClient->length[ 0u ]	= (uint8)pServer->length[ 0u ];
 		pClient->length[ 1u ]	= (uint8)pServer->length[ 1u ];
 		pClient->length[ 2u ]	= (uint8)pServer->length[ 2u ];
@@ -302,12 +803,14 @@ static void create_client_state( ClientGameState* pClientState, const ServerGame
 		pClient->posX		= float_quantize( pServer->position.x );
 		pClient->posY		= float_quantize( pServer->position.y );
 	}
+
+	pClientState->hash = statehash_compute( pClientState );
 }
 
-static void server_send_client_state( Server* pServer )
+void server_send( Server* pServer )
 {
 	ClientGameState clientState;
-	create_client_state( &clientState, &pServer->gameState );
+	server_getSnapshot( &clientState, &pServer->gameState );
 
 	//SYS_TRACE_DEBUG( "### %d\n", sizeof( clientState ) );
 
@@ -319,12 +822,27 @@ static void server_send_client_state( Server* pServer )
 			continue;
 		}
 
+		if( pServer->pLocalConnection && socket_isAddressEqual( &pPlayer->address, &s_localAddress ) )
+		{
+			if( !spscring_push( &pServer->pLocalConnection->snapshots, &clientState ) )
+			{
+				// the client hasn't picked up the last ones yet. it only uses the newest, this one goes out again next tick
+				SYS_TRACE_DEBUG( "local snapshot dropped\n" );
+			}
+			continue;
+		}
+
 		socket_send_blocking( pServer->socket, &pPlayer->address, &clientState, sizeof( clientState ) );
 	}
+
+	// all snapshots of this tick go out as one batch:
+	socket_flush();
 }
 
-void server_create( Server* pServer, uint16 port )
+void server_create( Server* pServer, uint16 port, uint tickRate )
 {
+	server_initGameState( &pServer->gameState, tickRate );
+
 	socket_init();
 
 	pServer->socket = socket_create();
@@ -335,31 +853,52 @@ void server_create( Server* pServer, uint16 port )
 
 	socket_bind( pServer->socket, &address );
 
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.player ); ++i )
+	pServer->pLocalConnection = 0;
+}
+
+void server_initGameState( ServerGameState* pState, uint tickRate )
+{
+	// the client still runs at 1 / GAMETIMESTEP, one server tick has to cover a whole number of client steps:
+	SYS_ASSERT( tickRate > 0u && tickRate <= ClientTickRate && ClientTickRate % tickRate == 0u );
+
+	// the snapshot has the unused bombs and explosions as well, another simulation has to start with the same ones:
+	memset( pState, 0, sizeof( *pState ) );
+	pState->tickRate	= tickRate;
+	pState->tickScale	= ClientTickRate / tickRate;
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
 	{
-		 pServer->gameState.player[ i ].playerState = PlayerState_InActive;
+		 pState->player[ i ].playerState = PlayerState_InActive;
 	}
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.bombs ); ++i )
+	timerwheel_init( &pState->timers );
+	for( uint i = 0u; i < SYS_COUNTOF( pState->bombs ); ++i )
 	{
-		pServer->gameState.bombs[ i ].time = 0.0f;
+		pState->bombs[ i ].timer = InvalidTimer;
 	}
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.explosions ); ++i )
+	for( uint i = 0u; i < SYS_COUNTOF( pState->explosions ); ++i )
 	{
-		pServer->gameState.explosions[ i ].time = 0.0f;
+		pState->explosions[ i ].timer = InvalidTimer;
 	}
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.items ); ++i )
+	for( uint i = 0u; i < SYS_COUNTOF( pState->items ); ++i )
 	{
-		pServer->gameState.items[ i ].type = ItemType_None;
+		pState->items[ i ].type = ItemType_None;
 	}
-	pServer->gameState.timeToNextItem = s_itemMaxTime;
+	pState->randomState = 0x2357u;
+	pState->nextItemTick = sim_toTicks( pState, s_itemMaxTime );
+	pState->droppedExplosions = 0u;
 
-	pServer->gameState.id = 0u;
+	pState->id = 0u;
+}
+
+void server_setLocalConnection( Server* pServer, LocalConnection* pConnection )
+{
+	pServer->pLocalConnection = pConnection;
 }
 
 void server_destroy( Server* pServer )
 {
 	pServer->gameState.id |= ServerFlagOffline;
-	server_send_client_state( pServer );
+	server_send( pServer );
 
 	socket_destroy( pServer->socket );
 	pServer->socket = InvalidSocket;
@@ -367,110 +906,129 @@ void server_destroy( Server* pServer )
 	socket_done();
 }
 
-static int server_findFreePosition( float2* pPosition, const World* pWorld )
+static int server_findFreePosition( float2* pPosition, ServerGameState* pState, const World* pWorld )
 {
-	for( uint i = 0u; i < 100u; ++i )
+	if( pWorld->itemSiteCount > 0u )
 	{
-		pPosition->x = float_rand_range( pWorld->borderMin.x + 2.0f, pWorld->borderMax.x - 2.0f );
-		pPosition->y = float_rand_range( pWorld->borderMin.y + 2.0f, pWorld->borderMax.y - 2.0f );
+		// levels with item sites only place items there, starting at a random site:
+		const uint firstSite = sim_random( pState ) % pWorld->itemSiteCount;
+		for( uint i = 0u; i < pWorld->itemSiteCount; ++i )
+		{
+			const float2* pSite = &pWorld->itemSites[ ( firstSite + i ) % pWorld->itemSiteCount ];
 
-		Circle circle;
-		circle.center = *pPosition;
-		circle.radius = s_itemRadius;
+			int isUsed = FALSE;
+			for( uint j = 0u; j < SYS_COUNTOF( pState->items ); ++j )
+			{
+				const ServerItem* pItem = &pState->items[ j ];
+				if( pItem->type != ItemType_None && pItem->position.x == pSite->x && pItem->position.y == pSite->y )
+				{
+					isUsed = TRUE;
+					break;
+				}
+			}
 
-		int intersect = FALSE;
-		for( uint j = 0u; j < SYS_COUNTOF( pWorld->rockz ); ++j )
-		{
-			if( isCircleCircleIntersecting( &pWorld->rockz[ j ], &circle ) )
+			if( !isUsed )
 			{
-				intersect = TRUE;
-				break;
+				*pPosition = *pSite;
+				return TRUE;
 			}
 		}
+		return FALSE;
+	}
 
-		if( !intersect )
-		{
-			return TRUE;
-		}
+	if( pWorld->freeCellCount == 0u )
+	{
+		return FALSE;
 	}
 
-	return FALSE;
+	*pPosition = pWorld->freeCells[ sim_random( pState ) % pWorld->freeCellCount ];
+	return TRUE;
 }
 
-void server_update( Server* pServer, World* pWorld )
+float server_getTickTime( const Server* pServer )
 {
-	for(;;)
+	return 1.0f / (float)pServer->gameState.tickRate;
+}
+
+void server_receiveInput( ServerGameState* pState, const ClientState* pInput, const IP4Address* pFrom, const World* pWorld )
+{
+	const int isOnline = ( pInput->flags & ClientStateFlag_Online );
+
+	ServerPlayer* pPlayer = 0;
+	int freeIndex = -1;
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
 	{
-		ClientState state;
-		IP4Address from;
-		const int result = socket_receive( pServer->socket, &state, sizeof( state ), &from );
-		if( result > 0 )
+		if( pState->player[ i ].playerState == PlayerState_InActive )
 		{
-			SYS_ASSERT( result == sizeof( state ) );
-			//SYS_TRACE_DEBUG( "s recv %d\n", state.id );
-
-			const int isOnline = ( state.flags & ClientStateFlag_Online );
+			if( freeIndex < 0 )
+			{
+				freeIndex = (int)i;
+			}
+			continue;
+		}
 
-			ServerPlayer* pPlayer = 0;
-			int freeIndex = -1;
-			for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.player ); ++i )
+		if( socket_isAddressEqual( &pState->player[ i ].address, pFrom ) )
+		{
+			if( isOnline )
 			{
-				if( pServer->gameState.player[ i ].playerState == PlayerState_InActive )
+				pPlayer = &pState->player[ i ];
+			}
+			else
+			{
+				for( uint j = 0u; j < SYS_COUNTOF( pState->bombs ); ++j )
 				{
-					if( freeIndex < 0 )
+					ServerBomb* pBomb = &pState->bombs[ j ];
+					if( ( pBomb->timer != InvalidTimer ) && ( pBomb->player == i ) )
 					{
-						freeIndex = (int)i;
+						pBomb->player = MaxPlayer;
 					}
-					continue;
 				}
 
-				if( socket_isAddressEqual( &pServer->gameState.player[ i ].address, &from ) )
+				for( uint j = 0u; j < SYS_COUNTOF( pState->explosions ); ++j )
 				{
-					if( isOnline )
+					ServerExplosion* pExplosion = &pState->explosions[ j ];
+					if( ( pExplosion->timer != InvalidTimer ) && ( pExplosion->player == i ) )
 					{
-						pPlayer = &pServer->gameState.player[ i ];
+						pExplosion->player = MaxPlayer;
 					}
-					else
-					{
-						for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.bombs ); ++j )
-						{
-							ServerBomb* pBomb = &pServer->gameState.bombs[ j ];
-							if( ( pBomb->time > 0.0f ) && ( pBomb->player == i ) )
-							{
-								pBomb->player = MaxPlayer;
-							}
-						}
-
-						for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.explosions ); ++j )
-						{
-							ServerExplosion* pExplosion = &pServer->gameState.explosions[ j ];
-							if( ( pExplosion->time > 0.0f ) && ( pExplosion->player == i ) )
-							{
-								pExplosion->player = MaxPlayer;
-							}
-						}
-
-						pServer->gameState.player[ i ].playerState = PlayerState_InActive;
-					}
-					break;
 				}
+
+				pState->player[ i ].playerState = PlayerState_InActive;
 			}
+			break;
+		}
+	}
 
-			if( ( pPlayer == 0 ) && ( freeIndex >= 0 ) && isOnline )
-			{
-				pPlayer = &pServer->gameState.player[ freeIndex ];
+	if( ( pPlayer == 0 ) && ( freeIndex >= 0 ) && isOnline )
+	{
+		pPlayer = &pState->player[ freeIndex ];
 
-				player_init( pPlayer, &from );
-				player_respawn( pPlayer, &s_playerStartPositions[ freeIndex ], s_playerStartDirections[ freeIndex ] );
-			}
+		player_init( pPlayer, pFrom, pInput->name );
+		player_spawn( pPlayer, (uint)freeIndex, pState, pWorld );
+	}
 
-			if( pPlayer )
-			{
-				if( state.id > pPlayer->state.id )
-				{
-					pPlayer->state = state;
-				}
-			}
+	if( pPlayer )
+	{
+		if( pInput->id > pPlayer->state.id )
+		{
+			pPlayer->state = *pInput;
+		}
+	}
+}
+
+void server_receive( Server* pServer, const World* pWorld )
+{
+	for(;;)
+	{
+		ClientState state;
+		IP4Address from;
+		const int result = socket_receive( pServer->socket, &state, sizeof( state ), &from );
+		if( result > 0 )
+		{
+			SYS_ASSERT( result == sizeof( state ) );
+			//SYS_TRACE_DEBUG( "s recv %d\n", state.id );
+
+			server_receiveInput( &pServer->gameState, &state, &from, pWorld );
 		}
 		else
 		{
@@ -478,34 +1036,59 @@ void server_update( Server* pServer, World* pWorld )
 		}
 	}
 
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.player ); ++i )
+	if( pServer->pLocalConnection )
 	{
-		ServerPlayer* pPlayer = &pServer->gameState.player[ i ];
+		ClientState state;
+		while( spscring_pop( &pServer->pLocalConnection->inputs, &state ) )
+		{
+			server_receiveInput( &pServer->gameState, &state, &s_localAddress, pWorld );
+		}
+	}
+}
+
+void server_update( Server* pServer, const World* pWorld )
+{
+	SYS_PROFILE_BEGIN( "server_update" );
+
+	server_receive( pServer, pWorld );
+	server_tick( &pServer->gameState, pWorld );
+	server_send( pServer );
+	SYS_PROFILE_END();
+}
+
+void server_tick( ServerGameState* pState, const World* pWorld )
+{
+	SYS_PROFILE_BEGIN( "server_tick" );
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
+	{
+		ServerPlayer* pPlayer = &pState->player[ i ];
 		if( pPlayer->playerState == PlayerState_InActive )
 		{
 			continue;
 		}
 
 		uint bombCount = 0u;
-		for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.bombs ); ++j )
+		for( uint j = 0u; j < SYS_COUNTOF( pState->bombs ); ++j )
 		{
-			const ServerBomb* pBomb = &pServer->gameState.bombs[ j ];
-			if( ( pBomb->time > 0.0f ) && ( pBomb->player == i ) )
+			const ServerBomb* pBomb = &pState->bombs[ j ];
+			if( ( pBomb->timer != InvalidTimer ) && ( pBomb->player == i ) )
 			{
 				bombCount++;
 			}
 		}
 
-		ServerBomb* pBomb = find_free_bomb( pServer->gameState.bombs, SYS_COUNTOF( pServer->gameState.bombs ) );
-		player_update( pPlayer, i, pBomb, bombCount, pWorld );
+		ServerBomb* pBomb = find_free_bomb( pState->bombs, SYS_COUNTOF( pState->bombs ) );
+		const uint bombIndex = pBomb ? (uint)( pBomb - pState->bombs ) : 0u;
+		player_update( pState, i, pBomb, bombIndex, bombCount, pWorld );
 
 		Circle playerCirlce;
 		playerCirlce.center = pPlayer->position;
 		playerCirlce.radius = s_carRadius;
 
-		for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.items ); ++j )
+		for( uint j = 0u; j < SYS_COUNTOF( pState->items ); ++j )
 		{
-			ServerItem* pItem = &pServer->gameState.items[ j ];
+			ServerItem* pItem = &pState->items[ j ];
 			if( pItem->type == ItemType_None )
 			{
 				continue;
@@ -533,74 +1116,74 @@ void server_update( Server* pServer, World* pWorld )
 		}
 	}
 
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.bombs ); ++i )
+	uint firedTimers[ MaxTimers ];
+	const uint firedTimerCount = timerwheel_advance( &pState->timers, firedTimers, SYS_COUNTOF( firedTimers ) );
+
+	// expired explosions first: their slots can be reused by the bombs going off in this tick
+	for( uint i = 0u; i < firedTimerCount; ++i )
 	{
-		ServerBomb* pBomb = &pServer->gameState.bombs[ i ];
-		if( pBomb->time == 0.0f )
+		if( ( firedTimers[ i ] & TimerType_Mask ) == TimerType_Explosion )
 		{
-			continue;
+			pState->explosions[ firedTimers[ i ] & TimerIndex_Mask ].timer = InvalidTimer;
 		}
+	}
 
-		ServerExplosion* pExplosion = find_free_explosion( pServer->gameState.explosions, SYS_COUNTOF( pServer->gameState.explosions ) );
-		bomb_update( pBomb, pExplosion, pWorld );
+	DetonationQueue detonations;
+	detonationqueue_clear( &detonations );
+	for( uint i = 0u; i < firedTimerCount; ++i )
+	{
+		if( ( firedTimers[ i ] & TimerType_Mask ) == TimerType_Bomb )
+		{
+			const uint bombIndex = firedTimers[ i ] & TimerIndex_Mask;
+			pState->bombs[ bombIndex ].timer = InvalidTimer;
+			detonationqueue_push( &detonations, bombIndex );
+		}
 	}
+	server_resolveDetonations( pState, &detonations, pWorld );
 
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.explosions ); ++i )
+	for( uint i = 0u; i < SYS_COUNTOF( pState->explosions ); ++i )
 	{
-		ServerExplosion* pExplosion = &pServer->gameState.explosions[ i ];
-		if( pExplosion->time == 0.0f )
+		ServerExplosion* pExplosion = &pState->explosions[ i ];
+		if( pExplosion->timer == InvalidTimer )
 		{
 			continue;
 		}
 
-		if( pExplosion->time == GAMETIMESTEP )
+		if( !pExplosion->hasHit )
 		{
+			pExplosion->hasHit = TRUE;
+
 			Capsule capsule0;
 			Capsule capsule1;
-			capsule0.radius = s_explosionRadius;
-			capsule1.radius = s_explosionRadius;
-
-			float2 length0;
-			float2_set( &length0, pExplosion->length[ 0u ], 0.0f );
-			float2_rotate( &length0, pExplosion->direction );
-
-			float2 length1;
-			float2_set( &length1, pExplosion->length[ 2u ], 0.0f );
-			float2_rotate( &length1, pExplosion->direction );
-
-			float2_add( &capsule0.line.a, &pExplosion->position, &length0 );
-			float2_sub( &capsule0.line.b, &pExplosion->position, &length1 );
+			explosion_getCapsules( &capsule0, &capsule1, pExplosion );
 
-			float2 length2;
-			float2_set( &length2, 0.0f, pExplosion->length[ 1u ] );
-			float2_rotate( &length2, pExplosion->direction );
-
-			float2 length3;
-			float2_set( &length3, 0.0f, pExplosion->length[ 3u ] );
-			float2_rotate( &length3, pExplosion->direction );
-
-			float2_add( &capsule1.line.a, &pExplosion->position, &length2 );
-			float2_sub( &capsule1.line.b, &pExplosion->position, &length3 );
+			// players respawn when hit, so the batch has to be rebuilt for every explosion:
+			CircleBatch playerCircles;
+			circlebatch_clear( &playerCircles );
+			for( uint j = 0u; j < SYS_COUNTOF( pState->player ); ++j )
+			{
+				Circle playerCirlce;
+				playerCirlce.center = pState->player[ j ].position;
+				playerCirlce.radius = s_carRadius;
+				circlebatch_add( &playerCircles, &playerCirlce );
+			}
+			const uint32 playerHitMask = circlebatch_intersectCapsule( &playerCircles, &capsule0 ) | circlebatch_intersectCapsule( &playerCircles, &capsule1 );
 
-			for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.player ); ++j )
+			for( uint j = 0u; j < SYS_COUNTOF( pState->player ); ++j )
 			{
-				ServerPlayer* pPlayer = &pServer->gameState.player[ j ];
+				ServerPlayer* pPlayer = &pState->player[ j ];
 				if( pPlayer->playerState == PlayerState_InActive )
 				{
 					continue;
 				}
 
-				Circle playerCirlce;
-				playerCirlce.center = pPlayer->position;
-				playerCirlce.radius = s_carRadius;
-
-				const int isPlayerOldEnough = pPlayer->age > s_playerBulletProofAge;
+				const int isPlayerOldEnough = pState->timers.currentTick - pPlayer->spawnTick > sim_toTicks( pState, s_playerBulletProofAge );
 
-				if( isPlayerOldEnough && ( isCircleCapsuleIntersecting( &playerCirlce, &capsule0 ) || isCircleCapsuleIntersecting( &playerCirlce, &capsule1 ) ) )
+				if( isPlayerOldEnough && ( playerHitMask & ( 1u << j ) ) )
 				{
 					if( pExplosion->player < MaxPlayer ) 
 					{
-						ServerPlayer* pFragPlayer = &pServer->gameState.player[ pExplosion->player ];
+						ServerPlayer* pFragPlayer = &pState->player[ pExplosion->player ];
 						if( pExplosion->player == j )
 						{
 							pFragPlayer->frags--;
@@ -611,59 +1194,39 @@ void server_update( Server* pServer, World* pWorld )
 						}
 					}
 
-					player_respawn( pPlayer, &s_playerStartPositions[ j ], s_playerStartDirections[ j ] );
+					player_spawn( pPlayer, j, pState, pWorld );
 				}
 			}
 
-			for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.bombs ); ++j )
+			CircleBatch itemCircles;
+			circlebatch_clear( &itemCircles );
+			for( uint j = 0u; j < SYS_COUNTOF( pState->items ); ++j )
 			{
-				ServerBomb* pBomb = &pServer->gameState.bombs[ j ];
-				if( pBomb->time == 0.0f )
-				{
-					continue;
-				}
-
-				Circle bombCircle;
-				bombCircle.center = pBomb->position;
-				bombCircle.radius = s_bombRadius;
-
-				if( isCircleCapsuleIntersecting( &bombCircle, &capsule0 ) || isCircleCapsuleIntersecting( &bombCircle, &capsule1 ) )
-				{
-					bomb_explode( find_free_explosion( pServer->gameState.explosions, SYS_COUNTOF( pServer->gameState.explosions ) ), pBomb, pWorld );
-
-					pBomb->time = 0.0f;
-				}
-			}
-
-			for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.items ); ++j )
-			{
-				ServerItem* pItem = &pServer->gameState.items[ j ];
-				if( pItem->type == ItemType_None )
-				{
-					continue;
-				}
-
 				Circle itemCircle;
-				itemCircle.center = pItem->position;
+				itemCircle.center = pState->items[ j ].position;
 				itemCircle.radius = s_itemRadius;
+				circlebatch_add( &itemCircles, &itemCircle );
+			}
+			const uint32 itemHitMask = circlebatch_intersectCapsule( &itemCircles, &capsule0 ) | circlebatch_intersectCapsule( &itemCircles, &capsule1 );
 
-				if( isCircleCapsuleIntersecting( &itemCircle, &capsule0 ) || isCircleCapsuleIntersecting( &itemCircle, &capsule1 ) )
+			for( uint j = 0u; j < SYS_COUNTOF( pState->items ); ++j )
+			{
+				if( itemHitMask & ( 1u << j ) )
 				{
-					pItem->type = ItemType_None;
+					pState->items[ j ].type = ItemType_None;
 				}
 			}
 		}
-
-		pExplosion->time += GAMETIMESTEP;
-		if( pExplosion->time >= s_explosionTime )
-		{
-			pExplosion->time = 0.0f;
-		}
 	}
 
-	for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.player ); ++i )
+	// bombs don't move in this pass so their batch is shared by all players:
+	CircleBatch bombCircles;
+	uint bombIndices[ MaxBombs ];
+	server_getBombCircles( &bombCircles, bombIndices, pState, 0 );
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
 	{
-		ServerPlayer* pPlayer = &pServer->gameState.player[ i ];
+		ServerPlayer* pPlayer = &pState->player[ i ];
 		if( pPlayer->playerState == PlayerState_InActive )
 		{
 			continue;
@@ -673,27 +1236,39 @@ void server_update( Server* pServer, World* pWorld )
 		playerCirlce.center = pPlayer->position;
 		playerCirlce.radius = s_carRadius;
 
-		for( uint j = 0u; j < SYS_COUNTOF( pServer->gameState.bombs ); ++j )
+		// only the circles that intersect go through the (sqrt based) collision response:
+		uint32 bombHitMask = circlebatch_intersectCircle( &bombCircles, &playerCirlce );
+		for( uint j = 0u; bombHitMask != 0u; ++j, bombHitMask >>= 1u )
 		{
-			const ServerBomb* pBomb = &pServer->gameState.bombs[ j ];
-			if( pBomb->time > 0.0f ) 
+			if( bombHitMask & 1u )
 			{
 				Circle bombCircle;
-				bombCircle.center = pBomb->position;
+				bombCircle.center = pState->bombs[ bombIndices[ j ] ].position;
 				bombCircle.radius = s_bombRadius;
 
 				circleCircleCollide( &bombCircle, &playerCirlce, 1.0f, 0, &pPlayer->position );
+				sim_snap2( &pPlayer->position );
 			}
 		}
 
-		for( uint j = 0u; j < SYS_COUNTOF( pWorld->rockz ); ++j )
+		float2 boundsMin;
+		float2_add2f( &boundsMin, &playerCirlce.center, -s_carRadius, -s_carRadius );
+		float2 boundsMax;
+		float2_add2f( &boundsMax, &playerCirlce.center, s_carRadius, s_carRadius );
+
+		uint16 obstacles[ MaxWorldObstacles ];
+		const uint obstacleCount = world_queryBounds( pWorld, obstacles, SYS_COUNTOF( obstacles ), &boundsMin, &boundsMax );
+		for( uint j = 0u; j < obstacleCount; ++j )
 		{
-			circleCircleCollide( &pWorld->rockz[ j ], &playerCirlce, 1.0f, 0, &pPlayer->position );
+			if( world_collideObstacle( pWorld, obstacles[ j ], &playerCirlce, &pPlayer->position ) )
+			{
+				sim_snap2( &pPlayer->position );
+			}
 		}
 
-		for( uint j = i + 1u; j < SYS_COUNTOF( pServer->gameState.player ); ++j )
+		for( uint j = i + 1u; j < SYS_COUNTOF( pState->player ); ++j )
 		{
-			ServerPlayer* pOtherPlayer = &pServer->gameState.player[ j ];
+			ServerPlayer* pOtherPlayer = &pState->player[ j ];
 			if( pOtherPlayer->playerState == PlayerState_InActive )
 			{
 				continue;
@@ -704,30 +1279,30 @@ void server_update( Server* pServer, World* pWorld )
 			otherPlayerCirlce.radius = s_carRadius;
 
 			circleCircleCollide( &playerCirlce, &otherPlayerCirlce, 0.5f, &pPlayer->position, &pOtherPlayer->position );
+			sim_snap2( &pPlayer->position );
+			sim_snap2( &pOtherPlayer->position );
 		}
 	}
 
-	pServer->gameState.timeToNextItem -= GAMETIMESTEP;
-	if( pServer->gameState.timeToNextItem <= 0.0f )
+	if( pState->timers.currentTick >= pState->nextItemTick )
 	{	
-		for( uint i = 0u; i < SYS_COUNTOF( pServer->gameState.items ); ++i )
+		for( uint i = 0u; i < SYS_COUNTOF( pState->items ); ++i )
 		{
-			ServerItem* pItem = &pServer->gameState.items[ i ];
+			ServerItem* pItem = &pState->items[ i ];
 
 			if( pItem->type == ItemType_None )
 			{
-				if( server_findFreePosition( &pItem->position, pWorld ) )
+				if( server_findFreePosition( &pItem->position, pState, pWorld ) )
 				{
-					pItem->type	= ( float_rand() < 0.5f ? ItemType_ExtraBomb : ItemType_BombRange );
+					pItem->type	= ( ( sim_random( pState ) & 1u ) ? ItemType_ExtraBomb : ItemType_BombRange );
 				}				
 				break;
 			}
 		}
-		pServer->gameState.timeToNextItem = float_rand_range( s_itemMinTime, s_itemMaxTime );
+		pState->nextItemTick = pState->timers.currentTick + sim_toTicks( pState, sim_randomRange( pState, s_itemMinTime, s_itemMaxTime ) );
 	}
 
-	pServer->gameState.id++;
-
-	server_send_client_state( pServer );
+	pState->id++;
+	SYS_PROFILE_END();
 }
 
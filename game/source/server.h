@@ -6,6 +6,7 @@
 #include "settings.h"
 #include "client.h"
 #include "world.h"
+#include "timerwheel.h"
 
 typedef struct 
 {
@@ -13,7 +14,8 @@ typedef struct
 	float2	position;
 	float	direction;
 	float	length;
-	float	time;
+	uint32	startTick;
+	uint	timer;			// fuse timer, InvalidTimer if the slot is free
 
 } ServerBomb;
 
@@ -30,7 +32,9 @@ typedef struct
 	float2	position;
 	float	direction;
 	float	length[ 4u ];
-	float	time;
+	uint32	startTick;
+	uint	timer;			// lifetime timer, InvalidTimer if the slot is free
+	int		hasHit;
 
 } ServerExplosion;
 
@@ -43,7 +47,7 @@ typedef struct
 	int				frags;
 	uint			playerState;
 	char			name[ 12u ];
-	float			age;
+	uint32			spawnTick;
 	float2			position;
 	float			direction;
 	float			steer;
@@ -56,26 +60,48 @@ typedef struct
 typedef struct 
 {
 	uint				id;
+	uint				tickRate;		// server ticks per second
+	uint				tickScale;		// GAMETIMESTEPs per server tick
 
 	ServerPlayer		player[ MaxPlayer ];
 	ServerBomb			bombs[ MaxBombs ];
 	ServerExplosion		explosions[ MaxExplosions ];
 	ServerItem 			items[ MaxItems ];
 
-	float				timeToNextItem;
+	uint32				nextItemTick;
+	uint32				randomState;
+	uint				droppedExplosions;	// bombs that went off while all explosion slots were in use
+
+	TimerWheel			timers;
 
 } ServerGameState;
 
 typedef struct 
 {
-	Socket			socket;
-	ServerGameState	gameState;
+	Socket				socket;
+	LocalConnection*	pLocalConnection;	// the host's own player, if the server runs on its own thread
+	ServerGameState		gameState;
 
 } Server;
 
-void	server_create( Server* pServer, uint16 port );
+void	server_create( Server* pServer, uint16 port, uint tickRate );
 void	server_destroy( Server* pServer );
-void	server_update( Server* pServer, World* pWorld );
+
+// the player on the connection is served through its rings instead of the socket
+void	server_setLocalConnection( Server* pServer, LocalConnection* pConnection );
+void	server_update( Server* pServer, const World* pWorld );
+
+// the halves of server_update around server_tick. they use the socket and have to run on the thread that created the
+// server, the tick of the game state can run on any thread in between
+void	server_receive( Server* pServer, const World* pWorld );
+void	server_send( Server* pServer );
+float	server_getTickTime( const Server* pServer );
+
+// the simulation without the network (server_update is receive, tick and send). a replay check runs it on its own
+void	server_initGameState( ServerGameState* pState, uint tickRate );
+void	server_receiveInput( ServerGameState* pState, const ClientState* pInput, const IP4Address* pFrom, const World* pWorld );
+void	server_tick( ServerGameState* pState, const World* pWorld );
+void	server_getSnapshot( ClientGameState* pSnapshot, const ServerGameState* pState );
 
 #endif
 
@@ -9,6 +9,8 @@ enum
 	MaxExplosions	= 16u,
 	MaxItems		= 4u,
 	NetworkPort		= 2357u,
+	ClientTickRate	= 60u,		// 1 / GAMETIMESTEP
+	ServerTickRate	= 60u,		// has to divide ClientTickRate (20, 30 or 60)
 };	
 
 static const float s_bombTime			= 2.0f;
@@ -4,6 +4,8 @@
 #include "debug.h"
 #include "opengl.h"
 
+#include <string.h>
+
 static const char* s_pVSUniformNames[ MaxVSUniformCount ] =
 {
     "vp0", "vp1", "vp2", "vp3"
@@ -69,6 +71,22 @@ uint shader_create( Shader* pShader, const GlslShaderDefinition* pDefinition, ui
     }
 #endif
 
+    // uniforms start at zero after linking:
+    memset( pShader->vpValues, 0, sizeof( pShader->vpValues ) );
+    memset( pShader->fpValues, 0, sizeof( pShader->fpValues ) );
+    for( uint i = 0u; i < MaxVSUniformCount; ++i )
+    {
+        pShader->vp[ i ] = -1;
+    }
+    for( uint i = 0u; i < MaxFSUniformCount; ++i )
+    {
+        pShader->fp[ i ] = -1;
+    }
+    for( uint i = 0u; i < MaxFSTextureCount; ++i )
+    {
+        pShader->ft[ i ] = -1;
+    }
+
     for( uint i = 0u; i < vsUniformCount; ++i )
     {
         pShader->vp[ i ] = glGetUniformLocationARB( shaderId, s_pVSUniformNames[ i ] );
@@ -95,6 +113,16 @@ uint shader_create( Shader* pShader, const GlslShaderDefinition* pDefinition, ui
         }
     }
 
+    // the texture units never change, so they are set once here (without disturbing the active program):
+    int currentProgram;
+    glGetIntegerv( GL_CURRENT_PROGRAM, &currentProgram );
+    glUseProgram( shaderId );
+    for( uint i = 0u; i < fsTextureCount; ++i )
+    {
+        glUniform1i( pShader->ft[ i ], ( int )i );
+    }
+    glUseProgram( ( uint )currentProgram );
+
     return shaderId;
 }
 
@@ -110,18 +138,33 @@ void shader_activate( const Shader* pShader )
     }
 }
 
-void shader_setVp4f( const Shader* pShader, uint index, float x, float y, float z, float w )
+static int isSameValue( const float4* pValue, float x, float y, float z, float w )
 {
-    float4 params;
-    float4_set( &params, x, y, z, w );
-    glUniform4fv( pShader->vp[ index ], 1u, &params.x );
+    return pValue->x == x && pValue->y == y && pValue->z == z && pValue->w == w;
 }
 
-void shader_setFp4f( const Shader* pShader, uint index, float x, float y, float z, float w )
+void shader_setVp4f( Shader* pShader, uint index, float x, float y, float z, float w )
 {
-    float4 params;
-    float4_set( &params, x, y, z, w );
-    glUniform4fv( pShader->fp[ index ], 1u, &params.x );
+    SYS_ASSERT( index < MaxVSUniformCount );
+    float4* pValue = &pShader->vpValues[ index ];
+    if( isSameValue( pValue, x, y, z, w ) )
+    {
+        return;
+    }
+    float4_set( pValue, x, y, z, w );
+    glUniform4fv( pShader->vp[ index ], 1u, &pValue->x );
+}
+
+void shader_setFp4f( Shader* pShader, uint index, float x, float y, float z, float w )
+{
+    SYS_ASSERT( index < MaxFSUniformCount );
+    float4* pValue = &pShader->fpValues[ index ];
+    if( isSameValue( pValue, x, y, z, w ) )
+    {
+        return;
+    }
+    float4_set( pValue, x, y, z, w );
+    glUniform4fv( pShader->fp[ index ], 1u, &pValue->x );
 }
 
 
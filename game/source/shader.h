@@ -15,14 +15,18 @@ typedef struct
     uint    id;
     int     vp[ MaxVSUniformCount ];
     int     fp[ MaxFSUniformCount ];
-    int     ft[ MaxFSTextureCount ];
+    int     ft[ MaxFSTextureCount ];    // texture ft<i> always samples texture unit i
+
+    // the values the program has right now, setting the same values again is skipped:
+    float4  vpValues[ MaxVSUniformCount ];
+    float4  fpValues[ MaxFSUniformCount ];
 } Shader;
 
 uint shader_create( Shader* pShader, const GlslShaderDefinition* pDefinition, uint vsUniformCount, uint fsUniformCount, uint fsTextureCount );
 void shader_activate( const Shader* pShader );
 
-void shader_setVp4f( const Shader* pShader, uint index, float x, float y, float z, float w );
-void shader_setFp4f( const Shader* pShader, uint index, float x, float y, float z, float w );
+void shader_setVp4f( Shader* pShader, uint index, float x, float y, float z, float w );
+void shader_setFp4f( Shader* pShader, uint index, float x, float y, float z, float w );
 
 #endif
 
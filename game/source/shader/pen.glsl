@@ -1,15 +1,29 @@
 <Shared>
 varying vec2 texCoord;
+varying vec3 penColor;
+varying float variance;
+varying float pageArc;
 
 <VS>
 
 void main()
 {
-    texCoord = gl_MultiTexCoord0.xy;
+    vec2 point = gl_Vertex.xy;
+    vec2 normal = gl_Vertex.zw;
+    float strokeArc = gl_MultiTexCoord0.y;
+    float strokeLength = gl_MultiTexCoord0.z;
+    float side = gl_MultiTexCoord0.w;
+    float halfWidth = gl_MultiTexCoord1.x;
+
+    vec2 paperPos = point + side * halfWidth * normal;
+
+    pageArc = gl_MultiTexCoord0.x;
+    texCoord = vec2( ( pageArc - strokeArc ) / strokeLength, 0.5f - 0.5f * side );
+    penColor = gl_Color.xyz;
+    variance = gl_MultiTexCoord1.y;
 
     vec2 paperSize = vec2( 64.0, 36.0 );
 
-    vec2 paperPos = gl_Vertex.xy;
     vec2 clipPos = vec2(2.0f*paperPos.x/paperSize.x,2.0f*(paperSize.y-paperPos.y)/paperSize.y)-vec2(1.0f,1.0f);
 
     gl_Position = vec4(clipPos,0.0f,1.0f);
@@ -17,29 +31,35 @@ void main()
 
 <FS>
 
+// x: drawn length of the page before this frame, y: drawn length after this frame
+uniform vec4 fp0;
+
 float rand(vec2 co){
     return fract(sin(dot(co.xy ,vec2(12.9898,78.233))) * 43758.5453);
 }
 
-uniform vec4 fp0;
-uniform vec4 fp1;
 void main()
 {
+    // only the part of the page drawn in this frame:
+    if( pageArc < fp0.x || pageArc >= fp0.y )
+    {
+        discard;
+    }
+
     float width=0.25f; ///18.0;    // * rand( gl_FragCoord );
-    float offset=0.0f; //fp0.y;
-    float curveSize=fp0.z;
-    vec4 penColor=vec4( fp1.xyz, 1.0f );
+    float offset=0.0f; //variance;
+    float curveSize=0.05f*variance;
 
     float pixelPos=texCoord.y;
     float linepos=0.5f;//-curveSize*sin(texCoord.x*3.14159+offset);
- 
+
     float distance = abs( linepos - pixelPos );
     float x=(distance/width);
     float strokeVariance=mix(0.7f,0.8f,cos(texCoord.x*3.14159));
 
     float intensity =strokeVariance*max(1.0-x*x,0.0);
 
-    vec4 color=penColor*intensity;
+    vec4 color=vec4( penColor, 1.0f )*intensity;
     gl_FragColor=color;
 //gl_FragColor=vec4(1,0,1,1);
 }
@@ -1,5 +1,6 @@
 #include "sound.h"
 #include "debug.h"
+#include "profile.h"
 
 #include <math.h>
 
@@ -37,6 +38,8 @@ static inline void pan( float* pLeft, float* pRight, float sample, float panning
 
 void sound_fillBuffer( float2* pBuffer, uint count )
 {
+    SYS_PROFILE_BEGIN( "sound_fillBuffer" );
+
     const double sampleRateFactor = 2 * PI / (double)SoundSampleRate;
 
     double samplePos = s_sound.samplePos;
@@ -75,5 +78,6 @@ void sound_fillBuffer( float2* pBuffer, uint count )
         s_sound.samplePos++;
     }
     s_sound.currentEngineFrequency = (float)engineFrequency;
+    SYS_PROFILE_END();
 }
 
@@ -0,0 +1,43 @@
+#include "spscring.h"
+#include "atomic.h"
+#include "debug.h"
+
+#include <string.h>
+
+void spscring_init( SpscRing* pRing, void* pData, uint elementSize, uint capacity )
+{
+	SYS_ASSERT( capacity > 0u && ( capacity & ( capacity - 1u ) ) == 0u );
+
+	pRing->pData		= (uint8*)pData;
+	pRing->elementSize	= elementSize;
+	pRing->mask			= capacity - 1u;
+	pRing->head			= 0u;
+	pRing->tail			= 0u;
+}
+
+int spscring_push( SpscRing* pRing, const void* pElement )
+{
+	// head and tail count up forever, their difference is the fill level:
+	const uint32 head = pRing->head;
+	if( head - atomic_loadAcquire( &pRing->tail ) > pRing->mask )
+	{
+		return FALSE;
+	}
+
+	memcpy( pRing->pData + ( head & pRing->mask ) * pRing->elementSize, pElement, pRing->elementSize );
+	atomic_storeRelease( &pRing->head, head + 1u );
+	return TRUE;
+}
+
+int spscring_pop( SpscRing* pRing, void* pElement )
+{
+	const uint32 tail = pRing->tail;
+	if( atomic_loadAcquire( &pRing->head ) == tail )
+	{
+		return FALSE;
+	}
+
+	memcpy( pElement, pRing->pData + ( tail & pRing->mask ) * pRing->elementSize, pRing->elementSize );
+	atomic_storeRelease( &pRing->tail, tail + 1u );
+	return TRUE;
+}
@@ -0,0 +1,35 @@
+#ifndef SPSCRING_H_INCLUDED
+#define SPSCRING_H_INCLUDED
+
+#include "types.h"
+
+enum
+{
+	SpscRingCacheLineSize	= 64u
+};
+
+// a lock free queue of fixed size elements between exactly one producer and one consumer thread.
+// the storage is owned by the caller, the capacity has to be a power of two
+typedef struct
+{
+	uint8*				pData;
+	uint32				elementSize;
+	uint32				mask;
+
+	// written by the producer / by the consumer only. kept on separate cache lines so the two threads don't share one
+	uint8				padding0[ SpscRingCacheLineSize ];
+	volatile uint32		head;
+	uint8				padding1[ SpscRingCacheLineSize - sizeof( uint32 ) ];
+	volatile uint32		tail;
+	uint8				padding2[ SpscRingCacheLineSize - sizeof( uint32 ) ];
+} SpscRing;
+
+void	spscring_init( SpscRing* pRing, void* pData, uint elementSize, uint capacity );
+
+// producer side. returns FALSE if the ring is full
+int		spscring_push( SpscRing* pRing, const void* pElement );
+
+// consumer side. returns FALSE if the ring is empty
+int		spscring_pop( SpscRing* pRing, void* pElement );
+
+#endif
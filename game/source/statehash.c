@@ -0,0 +1,162 @@
+#include "statehash.h"
+#include "debug.h"
+
+#include <string.h>
+
+static inline uint64 hash_add( uint64 hash, uint32 value )
+{
+	hash ^= (uint64)value;
+	return hash * 0x100000001b3ull;
+}
+
+static inline uint64 hash_finalize( uint64 hash )
+{
+	hash ^= hash >> 33u;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33u;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33u;
+	return hash;
+}
+
+static inline uint32 pack16( int16 a, int16 b )
+{
+	return ( (uint32)(uint16)a << 16u ) | (uint32)(uint16)b;
+}
+
+static inline uint32 pack8( uint8 a, uint8 b, uint8 c, uint8 d )
+{
+	return ( (uint32)a << 24u ) | ( (uint32)b << 16u ) | ( (uint32)c << 8u ) | (uint32)d;
+}
+
+uint64 statehash_compute( const ClientGameState* pState )
+{
+	// the state is hashed field by field: the struct padding is not initialized
+	uint64 hash = 0xcbf29ce484222325ull;
+	hash = hash_add( hash, pState->id );
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->player ); ++i )
+	{
+		const ClientPlayer* pPlayer = &pState->player[ i ];
+		hash = hash_add( hash, pPlayer->state );
+		if( pPlayer->state == PlayerState_InActive )
+		{
+			continue;
+		}
+
+		for( uint j = 0u; j < sizeof( pPlayer->name ) && pPlayer->name[ j ] != '\0'; ++j )
+		{
+			hash = hash_add( hash, (uint8)pPlayer->name[ j ] );
+		}
+		hash = hash_add( hash, pack16( pPlayer->posX, pPlayer->posY ) );
+		hash = hash_add( hash, pack8( (uint8)pPlayer->frags, pPlayer->direction, pPlayer->steer, 0u ) );
+		hash = hash_add( hash, ( (uint32)pPlayer->inputId << 16u ) | pPlayer->age );
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->bombs ); ++i )
+	{
+		const ClientBomb* pBomb = &pState->bombs[ i ];
+		hash = hash_add( hash, pack16( pBomb->posX, pBomb->posY ) );
+		hash = hash_add( hash, pack8( pBomb->time, pBomb->direction, pBomb->length, 0u ) );
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->explosions ); ++i )
+	{
+		const ClientExplosion* pExplosion = &pState->explosions[ i ];
+		hash = hash_add( hash, pack16( pExplosion->posX, pExplosion->posY ) );
+		hash = hash_add( hash, pack8( pExplosion->time, pExplosion->direction, 0u, 0u ) );
+		hash = hash_add( hash, pack8( pExplosion->length[ 0u ], pExplosion->length[ 1u ], pExplosion->length[ 2u ], pExplosion->length[ 3u ] ) );
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pState->items ); ++i )
+	{
+		const ClientItem* pItem = &pState->items[ i ];
+		hash = hash_add( hash, pItem->type );
+		hash = hash_add( hash, pack16( pItem->posX, pItem->posY ) );
+	}
+
+	return hash_finalize( hash );
+}
+
+#define STATEHASH_DIFF_FIELD( name, index, field ) \
+	if( pExpected->field != pActual->field ) \
+	{ \
+		SYS_TRACE_WARNING( "state diff @%u: %s[%u]." #field " expected %i got %i\n", tick, name, index, (int)pExpected->field, (int)pActual->field ); \
+		diffCount++; \
+	}
+
+uint statehash_diff( const ClientGameState* pExpectedState, const ClientGameState* pActualState )
+{
+	const uint tick = pActualState->id;
+	uint diffCount = 0u;
+	SYS_USE_ARGUMENT( tick );
+
+	if( pExpectedState->id != pActualState->id )
+	{
+		SYS_TRACE_WARNING( "state diff: comparing tick %u against tick %u\n", pExpectedState->id, pActualState->id );
+		diffCount++;
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pActualState->player ); ++i )
+	{
+		const ClientPlayer* pExpected = &pExpectedState->player[ i ];
+		const ClientPlayer* pActual = &pActualState->player[ i ];
+
+		STATEHASH_DIFF_FIELD( "player", i, state );
+		if( pExpected->state == PlayerState_InActive || pActual->state == PlayerState_InActive )
+		{
+			continue;
+		}
+		if( strncmp( pExpected->name, pActual->name, sizeof( pExpected->name ) ) != 0 )
+		{
+			SYS_TRACE_WARNING( "state diff @%u: player[%u].name expected '%.12s' got '%.12s'\n", tick, i, pExpected->name, pActual->name );
+			diffCount++;
+		}
+		STATEHASH_DIFF_FIELD( "player", i, frags );
+		STATEHASH_DIFF_FIELD( "player", i, posX );
+		STATEHASH_DIFF_FIELD( "player", i, posY );
+		STATEHASH_DIFF_FIELD( "player", i, age );
+		STATEHASH_DIFF_FIELD( "player", i, direction );
+		STATEHASH_DIFF_FIELD( "player", i, steer );
+		STATEHASH_DIFF_FIELD( "player", i, inputId );
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pActualState->bombs ); ++i )
+	{
+		const ClientBomb* pExpected = &pExpectedState->bombs[ i ];
+		const ClientBomb* pActual = &pActualState->bombs[ i ];
+
+		STATEHASH_DIFF_FIELD( "bomb", i, time );
+		STATEHASH_DIFF_FIELD( "bomb", i, posX );
+		STATEHASH_DIFF_FIELD( "bomb", i, posY );
+		STATEHASH_DIFF_FIELD( "bomb", i, direction );
+		STATEHASH_DIFF_FIELD( "bomb", i, length );
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pActualState->explosions ); ++i )
+	{
+		const ClientExplosion* pExpected = &pExpectedState->explosions[ i ];
+		const ClientExplosion* pActual = &pActualState->explosions[ i ];
+
+		STATEHASH_DIFF_FIELD( "explosion", i, time );
+		STATEHASH_DIFF_FIELD( "explosion", i, posX );
+		STATEHASH_DIFF_FIELD( "explosion", i, posY );
+		STATEHASH_DIFF_FIELD( "explosion", i, direction );
+		STATEHASH_DIFF_FIELD( "explosion", i, length[ 0u ] );
+		STATEHASH_DIFF_FIELD( "explosion", i, length[ 1u ] );
+		STATEHASH_DIFF_FIELD( "explosion", i, length[ 2u ] );
+		STATEHASH_DIFF_FIELD( "explosion", i, length[ 3u ] );
+	}
+
+	for( uint i = 0u; i < SYS_COUNTOF( pActualState->items ); ++i )
+	{
+		const ClientItem* pExpected = &pExpectedState->items[ i ];
+		const ClientItem* pActual = &pActualState->items[ i ];
+
+		STATEHASH_DIFF_FIELD( "item", i, type );
+		STATEHASH_DIFF_FIELD( "item", i, posX );
+		STATEHASH_DIFF_FIELD( "item", i, posY );
+	}
+
+	return diffCount;
+}
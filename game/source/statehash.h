@@ -0,0 +1,13 @@
+#ifndef STATEHASH_H_INCLUDED
+#define STATEHASH_H_INCLUDED
+
+#include "types.h"
+#include "client.h"
+
+// hash over all fields of the quantized game state (the hash field itself is excluded)
+uint64	statehash_compute( const ClientGameState* pState );
+
+// traces every field that differs between the two states and returns the number of differences
+uint	statehash_diff( const ClientGameState* pExpected, const ClientGameState* pActual );
+
+#endif
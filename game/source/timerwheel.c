@@ -0,0 +1,110 @@
+#include "timerwheel.h"
+#include "debug.h"
+
+void timerwheel_init( TimerWheel* pWheel )
+{
+	pWheel->currentTick = 0u;
+
+	for( uint i = 0u; i < SYS_COUNTOF( pWheel->slots ); ++i )
+	{
+		pWheel->slots[ i ] = InvalidTimer;
+	}
+
+	// all entries go into the free list (linked through next):
+	for( uint i = 0u; i < SYS_COUNTOF( pWheel->entries ); ++i )
+	{
+		pWheel->entries[ i ].prev = InvalidTimer;
+		pWheel->entries[ i ].next = (uint16)( i + 1u < SYS_COUNTOF( pWheel->entries ) ? i + 1u : InvalidTimer );
+	}
+	pWheel->firstFree = 0u;
+}
+
+uint timerwheel_add( TimerWheel* pWheel, uint delayTicks, uint userData )
+{
+	const uint timer = pWheel->firstFree;
+	if( timer == InvalidTimer )
+	{
+		SYS_TRACE_WARNING( "no free timer!\n" );
+		return InvalidTimer;
+	}
+
+	TimerWheelEntry* pEntry = &pWheel->entries[ timer ];
+	pWheel->firstFree = pEntry->next;
+
+	pEntry->expireTick	= pWheel->currentTick + uint_max( delayTicks, 1u );
+	pEntry->userData	= userData;
+
+	uint16* pSlot = &pWheel->slots[ pEntry->expireTick & ( TimerWheelSlotCount - 1u ) ];
+	pEntry->prev = InvalidTimer;
+	pEntry->next = *pSlot;
+	if( *pSlot != InvalidTimer )
+	{
+		pWheel->entries[ *pSlot ].prev = (uint16)timer;
+	}
+	*pSlot = (uint16)timer;
+
+	return timer;
+}
+
+static void timerwheel_unlink( TimerWheel* pWheel, uint timer )
+{
+	TimerWheelEntry* pEntry = &pWheel->entries[ timer ];
+
+	if( pEntry->prev != InvalidTimer )
+	{
+		pWheel->entries[ pEntry->prev ].next = pEntry->next;
+	}
+	else
+	{
+		pWheel->slots[ pEntry->expireTick & ( TimerWheelSlotCount - 1u ) ] = pEntry->next;
+	}
+	if( pEntry->next != InvalidTimer )
+	{
+		pWheel->entries[ pEntry->next ].prev = pEntry->prev;
+	}
+
+	pEntry->prev = InvalidTimer;
+	pEntry->next = pWheel->firstFree;
+	pWheel->firstFree = (uint16)timer;
+}
+
+void timerwheel_remove( TimerWheel* pWheel, uint timer )
+{
+	if( timer == InvalidTimer )
+	{
+		return;
+	}
+	SYS_ASSERT( timer < SYS_COUNTOF( pWheel->entries ) );
+	timerwheel_unlink( pWheel, timer );
+}
+
+uint timerwheel_advance( TimerWheel* pWheel, uint* pFiredUserData, uint capacity )
+{
+	pWheel->currentTick++;
+	const uint32 tick = pWheel->currentTick;
+
+	uint firedCount = 0u;
+	uint timer = pWheel->slots[ tick & ( TimerWheelSlotCount - 1u ) ];
+	while( timer != InvalidTimer )
+	{
+		const TimerWheelEntry* pEntry = &pWheel->entries[ timer ];
+		const uint next = pEntry->next;
+
+		// timers further than one revolution away stay in the slot:
+		if( pEntry->expireTick == tick )
+		{
+			if( firedCount < capacity )
+			{
+				pFiredUserData[ firedCount++ ] = pEntry->userData;
+			}
+			else
+			{
+				SYS_TRACE_WARNING( "fired timer dropped!\n" );
+			}
+			timerwheel_unlink( pWheel, timer );
+		}
+		timer = next;
+	}
+
+	return firedCount;
+}
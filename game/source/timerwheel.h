@@ -0,0 +1,39 @@
+#ifndef TIMERWHEEL_H_INCLUDED
+#define TIMERWHEEL_H_INCLUDED
+
+#include "types.h"
+#include "settings.h"
+
+enum
+{
+	TimerWheelSlotCount	= 128u,		// has to be a power of two
+	MaxTimers			= MaxBombs + MaxExplosions,
+	InvalidTimer		= 0xffffu
+};
+
+typedef struct
+{
+	uint32	expireTick;
+	uint16	prev;
+	uint16	next;
+	uint	userData;
+} TimerWheelEntry;
+
+typedef struct
+{
+	uint32				currentTick;
+	uint16				slots[ TimerWheelSlotCount ];
+	uint16				firstFree;
+	TimerWheelEntry		entries[ MaxTimers ];
+} TimerWheel;
+
+void	timerwheel_init( TimerWheel* pWheel );
+
+// returns InvalidTimer if all timers are in use. the timer fires delayTicks ticks after the current one (at least one)
+uint	timerwheel_add( TimerWheel* pWheel, uint delayTicks, uint userData );
+void	timerwheel_remove( TimerWheel* pWheel, uint timer );
+
+// advances the wheel by one tick and returns the user data of all timers that expired in it (the timers are freed)
+uint	timerwheel_advance( TimerWheel* pWheel, uint* pFiredUserData, uint capacity );
+
+#endif
@@ -0,0 +1,242 @@
+#include "trace.h"
+
+#ifdef SYS_TRACE_ENABLED
+
+#include "debug.h"
+#include "platform.h"
+#include "atomic.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+
+// one slot of the ring. a producer owns the slot while sequence is its position, the writer while it is position + 1
+typedef struct
+{
+	volatile uint32		sequence;
+	int					level;
+	uint64				time;
+	char				text[ TraceMessageSize ];
+} TraceEntry;
+
+static TraceEntry		s_traceEntries[ TraceRingCapacity ];
+static volatile uint32	s_traceHead = 0u;				// next position claimed by any producer
+static uint32			s_traceTail = 0u;				// next position written, only touched while draining
+static volatile uint32	s_droppedTraceCount = 0u;
+static volatile uint32	s_isTraceRunning = 0u;
+static volatile uint32	s_isTraceDraining = 0u;
+static volatile uint32	s_stopTraceWriter = 0u;
+static ThreadHandle		s_traceWriterThread;
+static FILE*			s_pTraceFile = NULL;
+static uint64			s_traceStartTime = 0u;
+
+static char trace_getLevelChar( int level )
+{
+	if( level <= TraceLevel_Error )
+	{
+		return 'E';
+	}
+	else if( level <= TraceLevel_Warning )
+	{
+		return 'W';
+	}
+	else if( level <= TraceLevel_Info )
+	{
+		return 'I';
+	}
+	return 'D';
+}
+
+static void trace_writeText( const char* pText )
+{
+	if( s_pTraceFile )
+	{
+		fputs( pText, s_pTraceFile );
+	}
+	else
+	{
+		sys_writeTrace( pText );
+	}
+}
+
+static void trace_writeEntry( const TraceEntry* pEntry )
+{
+	char line[ TraceMessageSize + 32u ];
+	snprintf( line, sizeof( line ), "%10.6f %c %s", (double)( pEntry->time - s_traceStartTime ) * 1e-9, trace_getLevelChar( pEntry->level ), pEntry->text );
+	trace_writeText( line );
+}
+
+void trace_flush()
+{
+	// only one thread may consume at a time (the writer or someone flushing before an exit):
+	while( atomic_exchange( &s_isTraceDraining, 1u ) )
+	{
+	}
+
+	for( ;; )
+	{
+		TraceEntry* pEntry = &s_traceEntries[ s_traceTail & ( TraceRingCapacity - 1u ) ];
+		if( atomic_loadAcquire( &pEntry->sequence ) != s_traceTail + 1u )
+		{
+			break;
+		}
+
+		trace_writeEntry( pEntry );
+
+		// hand the slot back to the producers for the next round:
+		atomic_storeRelease( &pEntry->sequence, s_traceTail + TraceRingCapacity );
+		s_traceTail++;
+	}
+
+	const uint32 droppedCount = atomic_exchange( &s_droppedTraceCount, 0u );
+	if( droppedCount > 0u )
+	{
+		char line[ 64u ];
+		snprintf( line, sizeof( line ), "(%u trace messages dropped, the ring was full)\n", droppedCount );
+		trace_writeText( line );
+	}
+
+	if( s_pTraceFile )
+	{
+		fflush( s_pTraceFile );
+	}
+
+	atomic_storeRelease( &s_isTraceDraining, 0u );
+}
+
+static void trace_writerThread( void* pArgument )
+{
+	SYS_USE_ARGUMENT( pArgument );
+
+	while( !atomic_loadAcquire( &s_stopTraceWriter ) )
+	{
+		trace_flush();
+		sys_sleepUntil( sys_getTime() + TraceWriterPeriod );
+	}
+	trace_flush();
+}
+
+int trace_init( const char* pFileName )
+{
+	if( pFileName )
+	{
+		s_pTraceFile = fopen( pFileName, "w" );
+		if( !s_pTraceFile )
+		{
+			SYS_TRACE_ERROR( "could not open trace file '%s'\n", pFileName );
+			return FALSE;
+		}
+	}
+
+	for( uint i = 0u; i < TraceRingCapacity; ++i )
+	{
+		s_traceEntries[ i ].sequence = i;
+	}
+	s_traceHead			= 0u;
+	s_traceTail			= 0u;
+	s_stopTraceWriter	= 0u;
+	s_traceStartTime	= sys_getTime();
+
+	s_traceWriterThread = sys_createThread( trace_writerThread, NULL );
+	atomic_storeRelease( &s_isTraceRunning, 1u );
+	return TRUE;
+}
+
+void trace_done()
+{
+	if( !atomic_loadAcquire( &s_isTraceRunning ) )
+	{
+		return;
+	}
+
+	atomic_storeRelease( &s_isTraceRunning, 0u );
+	atomic_storeRelease( &s_stopTraceWriter, 1u );
+	sys_joinThread( s_traceWriterThread );
+
+	if( s_pTraceFile )
+	{
+		fclose( s_pTraceFile );
+		s_pTraceFile = NULL;
+	}
+}
+
+// returns FALSE if the call site already wrote its share of messages in the current window
+static int trace_isSiteAllowed( TraceSite* pSite, uint64 time )
+{
+	const uint32 window = (uint32)( time >> TraceSiteWindowShift );
+	if( atomic_loadAcquire( &pSite->window ) != window && atomic_exchange( &pSite->window, window ) != window )
+	{
+		// the first message of a new window reports what the last one swallowed:
+		const uint32 lastCount = atomic_exchange( &pSite->messageCount, 0u );
+		if( lastCount > TraceSiteMaxMessageCount )
+		{
+			TraceSite reportSite = { 0u, 0u };
+			sys_trace( &reportSite, TraceLevel_Warning, "(%u more messages like the next one were rate limited)\n", lastCount - TraceSiteMaxMessageCount );
+		}
+	}
+
+	return atomic_fetchAdd( &pSite->messageCount, 1u ) < TraceSiteMaxMessageCount;
+}
+
+void sys_trace( TraceSite* pSite, int level, const char* pFormat, ... )
+{
+	const uint64 time = sys_getTime();
+	if( !trace_isSiteAllowed( pSite, time ) )
+	{
+		return;
+	}
+
+	va_list argumentList;
+	va_start( argumentList, pFormat );
+
+	if( !atomic_loadAcquire( &s_isTraceRunning ) )
+	{
+		char text[ TraceMessageSize ];
+		vsnprintf( text, sizeof( text ), pFormat, argumentList );
+		va_end( argumentList );
+
+		trace_writeText( text );
+		return;
+	}
+
+	// claim a slot:
+	TraceEntry* pEntry;
+	uint32 position = atomic_loadAcquire( &s_traceHead );
+	for( ;; )
+	{
+		pEntry = &s_traceEntries[ position & ( TraceRingCapacity - 1u ) ];
+		const int32 difference = (int32)( atomic_loadAcquire( &pEntry->sequence ) - position );
+		if( difference == 0 )
+		{
+			if( atomic_compareExchange( &s_traceHead, position, position + 1u ) )
+			{
+				break;
+			}
+			position = atomic_loadAcquire( &s_traceHead );
+		}
+		else if( difference < 0 )
+		{
+			// the writer is a whole ring behind. dropping is better than stalling the frame
+			va_end( argumentList );
+			atomic_fetchAdd( &s_droppedTraceCount, 1u );
+			return;
+		}
+		else
+		{
+			position = atomic_loadAcquire( &s_traceHead );
+		}
+	}
+
+	pEntry->level	= level;
+	pEntry->time	= time;
+	const int length = vsnprintf( pEntry->text, sizeof( pEntry->text ), pFormat, argumentList );
+	va_end( argumentList );
+
+	if( length >= (int)sizeof( pEntry->text ) )
+	{
+		pEntry->text[ sizeof( pEntry->text ) - 2u ] = '\n';
+	}
+
+	atomic_storeRelease( &pEntry->sequence, position + 1u );
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include "types.h"
+
+// the writer behind SYS_TRACE_*: before trace_init and after trace_done messages are written directly on the calling thread
+
+#ifdef SYS_TRACE_ENABLED
+
+enum
+{
+	TraceRingCapacity		= 1024u,		// messages, has to be a power of two
+	TraceMessageSize		= 240u,			// longer messages are cut
+	TraceWriterPeriod		= 10000000u		// ns between two drains of the writer thread
+};
+
+// starts the writer thread. without a file name the lines go to sys_writeTrace
+int		trace_init( const char* pFileName );
+void	trace_done();
+
+// writes everything queued so far on the calling thread (e.g. before exiting)
+void	trace_flush();
+
+#endif
+
+#endif
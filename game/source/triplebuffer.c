@@ -0,0 +1,39 @@
+#include "triplebuffer.h"
+#include "atomic.h"
+
+void triplebuffer_init( TripleBuffer* pBuffer, void* pSlots, uint slotSize )
+{
+	pBuffer->pData		= (uint8*)pSlots;
+	pBuffer->slotSize	= slotSize;
+	pBuffer->writeSlot	= 0u;
+	pBuffer->middleSlot	= 1u;
+	pBuffer->readSlot	= 2u;
+}
+
+void* triplebuffer_getWriteSlot( TripleBuffer* pBuffer )
+{
+	return pBuffer->pData + pBuffer->writeSlot * pBuffer->slotSize;
+}
+
+void triplebuffer_publish( TripleBuffer* pBuffer )
+{
+	// the written slot becomes the middle one, the producer continues with the old middle slot:
+	pBuffer->writeSlot = atomic_exchange( &pBuffer->middleSlot, pBuffer->writeSlot | TripleBufferFreshFlag ) & TripleBufferSlotMask;
+}
+
+int triplebuffer_acquire( TripleBuffer* pBuffer )
+{
+	if( ( atomic_loadAcquire( &pBuffer->middleSlot ) & TripleBufferFreshFlag ) == 0u )
+	{
+		return FALSE;
+	}
+
+	// only the consumer clears the flag, so the middle slot is still fresh here:
+	pBuffer->readSlot = atomic_exchange( &pBuffer->middleSlot, pBuffer->readSlot ) & TripleBufferSlotMask;
+	return TRUE;
+}
+
+const void* triplebuffer_getReadSlot( const TripleBuffer* pBuffer )
+{
+	return pBuffer->pData + pBuffer->readSlot * pBuffer->slotSize;
+}
@@ -0,0 +1,35 @@
+#ifndef TRIPLEBUFFER_H_INCLUDED
+#define TRIPLEBUFFER_H_INCLUDED
+
+#include "types.h"
+
+enum
+{
+	TripleBufferSlotCount	= 3u,
+	TripleBufferSlotMask	= 3u,
+	TripleBufferFreshFlag	= 4u		// set on the middle slot when it was published after the consumer took the last one
+};
+
+// hands the newest version of some state from one producer thread to one consumer thread without locks and without
+// either side ever waiting: the producer always has a slot to write, the consumer always has a complete one to read.
+// versions the consumer is too slow for are skipped. the storage (three slots) is owned by the caller
+typedef struct
+{
+	uint8*			pData;
+	uint32			slotSize;
+	uint32			writeSlot;		// producer only
+	uint32			readSlot;		// consumer only
+	volatile uint32	middleSlot;
+} TripleBuffer;
+
+// the slots should hold the same initial state, the consumer reads one before anything was published
+void		triplebuffer_init( TripleBuffer* pBuffer, void* pSlots, uint slotSize );
+
+void*		triplebuffer_getWriteSlot( TripleBuffer* pBuffer );
+void		triplebuffer_publish( TripleBuffer* pBuffer );
+
+// takes the newest published slot. returns FALSE (and keeps the current read slot) if nothing was published since
+int			triplebuffer_acquire( TripleBuffer* pBuffer );
+const void*	triplebuffer_getReadSlot( const TripleBuffer* pBuffer );
+
+#endif
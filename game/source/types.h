@@ -42,8 +42,10 @@ typedef unsigned __int64     uint64_t;
 
 #ifndef _MSC_VER
 #   define SYS_NO_RETURN   __attribute__ ((__noreturn__))
+#   define SYS_THREAD_LOCAL __thread
 #else
 #   define SYS_NO_RETURN    
+#   define SYS_THREAD_LOCAL __declspec( thread )
 #endif
 
 typedef uint8_t uint8;
@@ -127,6 +127,28 @@ static inline float2* float2_add2f( float2* pResult, const float2* pA, float bx,
 	return pResult;
 }
 
+static inline float2* float2_min( float2* pResult, const float2* pA, const float2* pB )
+{
+	const float rx = float_min( pA->x, pB->x );
+	const float ry = float_min( pA->y, pB->y );
+
+	pResult->x = rx;
+	pResult->y = ry;
+
+	return pResult;
+}
+
+static inline float2* float2_max( float2* pResult, const float2* pA, const float2* pB )
+{
+	const float rx = float_max( pA->x, pB->x );
+	const float ry = float_max( pA->y, pB->y );
+
+	pResult->x = rx;
+	pResult->y = ry;
+
+	return pResult;
+}
+
 static inline float float2_squareLength( const float2* pX )
 {
 	const float x = pX->x;
@@ -13,6 +13,12 @@
 #include "game.h"
 #include "input.h"
 #include "sound.h"
+#include "platform.h"
+#include "atomic.h"
+#include "framepacer.h"
+#include "profile.h"
+#include "trace.h"
+#include "settings.h"
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -41,6 +47,121 @@ int sys_getScreenHeight()
 	return (int)s_height;
 }
 
+const void* sys_mapFile( const char* pFileName, uint* pSize )
+{
+	HANDLE file = CreateFileA( pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+	{
+		return 0;
+	}
+
+	DWORD sizeHigh = 0u;
+	const DWORD size = GetFileSize( file, &sizeHigh );
+	if( size == INVALID_FILE_SIZE || size == 0u || sizeHigh != 0u )
+	{
+		CloseHandle( file );
+		return 0;
+	}
+
+	// the view keeps the mapping alive after both handles are closed:
+	HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0u, 0u, NULL );
+	CloseHandle( file );
+	if( mapping == NULL )
+	{
+		return 0;
+	}
+
+	const void* pData = MapViewOfFile( mapping, FILE_MAP_READ, 0u, 0u, 0u );
+	CloseHandle( mapping );
+	if( pData == NULL )
+	{
+		return 0;
+	}
+
+	*pSize = (uint)size;
+	return pData;
+}
+
+void sys_unmapFile( const void* pData, uint size )
+{
+	SYS_USE_ARGUMENT( size );
+	UnmapViewOfFile( pData );
+}
+
+typedef struct
+{
+	ThreadFunction	pFunction;
+	void*			pArgument;
+} ThreadStart;
+
+static unsigned __stdcall threadStartFunction( void* pUserData )
+{
+	const ThreadStart start = *(ThreadStart*)pUserData;
+	free( pUserData );
+	start.pFunction( start.pArgument );
+	return 0u;
+}
+
+ThreadHandle sys_createThread( ThreadFunction pFunction, void* pArgument )
+{
+	ThreadStart* pStart = (ThreadStart*)malloc( sizeof( ThreadStart ) );
+	pStart->pFunction	= pFunction;
+	pStart->pArgument	= pArgument;
+
+	const uintptr_t thread = _beginthreadex( NULL, 0u, threadStartFunction, pStart, 0u, NULL );
+	if( thread == 0u )
+	{
+		SYS_BREAK( "_beginthreadex failed!\n" );
+	}
+	return (ThreadHandle)thread;
+}
+
+void sys_joinThread( ThreadHandle thread )
+{
+	WaitForSingleObject( (HANDLE)(uintptr_t)thread, INFINITE );
+	CloseHandle( (HANDLE)(uintptr_t)thread );
+}
+
+uint64 sys_getTime()
+{
+	static LARGE_INTEGER s_frequency;
+	if( s_frequency.QuadPart == 0 )
+	{
+		QueryPerformanceFrequency( &s_frequency );
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter( &counter );
+
+	// split to keep the multiplication from overflowing:
+	const uint64 ticks = (uint64)counter.QuadPart;
+	const uint64 frequency = (uint64)s_frequency.QuadPart;
+	return ( ticks / frequency ) * 1000000000u + ( ticks % frequency ) * 1000000000u / frequency;
+}
+
+void sys_sleepUntil( uint64 time )
+{
+	// Sleep() is only as precise as the timer period (set to 1ms in WinMain), the last bit is spun:
+	for( ;; )
+	{
+		const uint64 currentTime = sys_getTime();
+		if( currentTime >= time )
+		{
+			break;
+		}
+
+		const uint64 remainingTime = time - currentTime;
+		if( remainingTime > 2000000u )
+		{
+			Sleep( (DWORD)( remainingTime / 1000000u ) - 1u );
+		}
+		else
+		{
+			YieldProcessor();
+		}
+	}
+}
+
 static void updateButtonMask( uint32* pButtonMask, uint32 button, int isDown )
 {
     uint32 buttonMask = *pButtonMask;
@@ -55,20 +176,17 @@ static void updateButtonMask( uint32* pButtonMask, uint32 button, int isDown )
     *pButtonMask = buttonMask;
 }
 
-void sys_trace( const char* pFormat, ... )
+void sys_writeTrace( const char* pText )
 {
-	va_list	vargs;
-	char buffer[ 2048u ];
-
-	va_start( vargs, pFormat );
-	vsnprintf_s( buffer, sizeof( buffer ), sizeof( buffer ) - 1u, pFormat, vargs );
-	va_end(vargs);
-
-	OutputDebugString( buffer );
+	OutputDebugString( pText );
 }
 
 void sys_exit( int exitcode )
 {
+#ifdef SYS_TRACE_ENABLED
+	// the message that explains the exit is probably still queued:
+	trace_flush();
+#endif
 	ExitProcess( ( uint )exitcode );
 }
 
@@ -236,6 +354,8 @@ static void	__cdecl soundThreadFunction( void* )
 			return;
 		}		
 
+		SYS_PROFILE_THREAD_NAME( "sound" );
+
 		float2 fbuffer[ SoundBufferSampleHalfCount ];
 		sound_fillBuffer( fbuffer, SoundBufferSampleHalfCount );
 
@@ -353,6 +473,47 @@ static void dxsound_done()
 	s_pDxSoundBuffer->Stop();
 }
 
+enum
+{
+	FallbackRefreshRate	= 60u		// until the render thread measured the display with vsync
+};
+
+static volatile uint32	s_renderFrameCount = 0u;
+static volatile uint32	s_stopRenderThread = 0u;
+static HDC				s_hDC = NULL;
+static HGLRC			s_hRC = NULL;
+
+// all gl work happens here, so waiting for vsync in the swap never delays input and network on the main thread
+static void renderThreadFunction( void* pUserData )
+{
+	SYS_USE_ARGUMENT( pUserData );
+
+	SYS_PROFILE_THREAD_NAME( "render" );
+
+	wglMakeCurrent( s_hDC, s_hRC );
+	game_initRender();
+
+	// with vsync the swap already waits for the display, the pacer only keeps the thread from spinning without it:
+	FramePacer framePacer;
+	framepacer_init( &framePacer, FallbackRefreshRate );
+	uint64 lastFrameTime = sys_getTime();
+
+	while( !atomic_loadAcquire( &s_stopRenderThread ) )
+	{
+		const float timeStep = framepacer_getElapsedTime( &lastFrameTime );
+
+		game_render( timeStep );
+		const uint64 swapStartTime = sys_getTime();
+		SwapBuffers( s_hDC );
+
+		atomic_storeRelease( &s_renderFrameCount, s_renderFrameCount + 1u );
+		framepacer_waitForSwap( &framePacer, swapStartTime );
+	}
+
+	game_doneRender();
+	wglMakeCurrent( NULL, NULL );
+}
+
 int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow )
 {
 	SYS_USE_ARGUMENT( hInstance );
@@ -360,6 +521,18 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 	SYS_USE_ARGUMENT( lpCmdLine );
 	SYS_USE_ARGUMENT( nCmdShow );
 
+#ifdef SYS_TRACE_ENABLED
+	trace_init( NULL );
+#endif
+
+#ifdef SYS_PROFILE_ENABLED
+	// -profile <file> writes a chrome trace of the whole session:
+	if( strncmp( lpCmdLine, "-profile ", 9u ) == 0 && profile_init( lpCmdLine + 9u ) )
+	{
+		SYS_PROFILE_THREAD_NAME( "main" );
+	}
+#endif
+
 	const char* pWndClass = "paperbomb_wc";
 
     WNDCLASS wc;
@@ -451,29 +624,40 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 
 	SYS_VERIFY( glewInit() == GLEW_OK );
 
+	// 1ms timer period for the sleeps of the simulation thread:
+	timeBeginPeriod( 1u );
+
 	dxsound_init();
 	game_init();
+
+	// the context moves to the render thread:
+	s_hDC = hDC;
+	s_hRC = hRC;
+	wglMakeCurrent( NULL, NULL );
+	const ThreadHandle renderThread = sys_createThread( renderThreadFunction, NULL );
+
+	FramePacer framePacer;
+	framepacer_init( &framePacer, ClientTickRate );
    
-    uint32 lastTime = timeGetTime();
+    uint64 lastTime = sys_getTime();
 
 #ifndef SYS_BUILD_MASTER
-    uint32 lastTimingTime = lastTime;
-    uint32 timingFrameCount = 0u;
+    uint64 lastTimingTime = lastTime;
+    uint32 lastTimingFrameCount = 0u;
 #endif
 
     int quit = 0;
     do
     {
-        uint32 currentTime = timeGetTime();
-
-        const float timeStep = ( float )( currentTime - lastTime ) / 1000.0f;
-        lastTime = currentTime;
+        const float timeStep = framepacer_getElapsedTime( &lastTime );
 
 #ifndef SYS_BUILD_MASTER
-        if( currentTime - lastTimingTime > 500u )
+        const uint64 currentTime = lastTime;
+        if( currentTime - lastTimingTime > 500000000u )
         {
-            const float timingTimeSpan = ( float )( currentTime - lastTimingTime ) / 1000.0f;
-            const float currentFps = ( float )( timingFrameCount ) / timingTimeSpan;
+            const float timingTimeSpan = ( float )( currentTime - lastTimingTime ) * 1e-9f;
+            const uint32 timingFrameCount = atomic_loadAcquire( &s_renderFrameCount );
+            const float currentFps = ( float )( timingFrameCount - lastTimingFrameCount ) / timingTimeSpan;
 
             //SYS_TRACE_DEBUG( "fps=%f\n", currentFps );
 
@@ -482,7 +666,11 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 			SetWindowText( s_hWnd, windowTitle );            
     
             lastTimingTime = currentTime;
-            timingFrameCount = 0u;
+            lastTimingFrameCount = timingFrameCount;
+
+#ifdef SYS_PROFILE_ENABLED
+			profile_flush();
+#endif
         }
 #endif
 
@@ -503,18 +691,25 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
         gameInput.buttonMask = s_currentButtonMask | s_currentJoyStickButtonMask;
 
         game_update( &gameInput );
-        game_render();
 
-		SwapBuffers( hDC );       
-
-#ifndef SYS_BUILD_MASTER
-        timingFrameCount++;
-#endif
+		// the render thread picks up the published state. without the swap to block on, the updates are paced here:
+		framepacer_waitForFrame( &framePacer );
     }
     while( !quit );
 
+	atomic_storeRelease( &s_stopRenderThread, 1u );
+	sys_joinThread( renderThread );
     game_done();
 	dxsound_done();
 
+#ifdef SYS_PROFILE_ENABLED
+	profile_done();
+#endif
+#ifdef SYS_TRACE_ENABLED
+	trace_done();
+#endif
+
+	timeEndPeriod( 1u );
+
     return( 0 );
 }
@@ -160,3 +160,7 @@ int	socket_receive( Socket socket, void* pData, uint size, IP4Address* pFrom )
 		}
 	}
 }
+
+void socket_flush()
+{
+}
@@ -1,2 +1,489 @@
 #include "world.h"
+#include "vector.h"
+#include "debug.h"
 
+#include <string.h>
+
+// the bounds are padded a bit so that rounding never culls an obstacle that is just touched
+static const float s_boundsPadding = 0.01f;
+
+void world_init( World* pWorld, const float2* pBorderMin, const float2* pBorderMax )
+{
+	// cleared completely so that written level files don't contain uninitialized padding:
+	memset( pWorld, 0, sizeof( *pWorld ) );
+
+	pWorld->borderMin = *pBorderMin;
+	pWorld->borderMax = *pBorderMax;
+}
+
+static int world_addObstacle( World* pWorld, uint type, uint shape, float minX, float minY, float maxX, float maxY )
+{
+	if( pWorld->obstacleCount >= MaxWorldObstacles )
+	{
+		SYS_TRACE_WARNING( "too many world obstacles!\n" );
+		return FALSE;
+	}
+
+	const uint obstacle = pWorld->obstacleCount++;
+	pWorld->obstacleType[ obstacle ]	= (uint8)type;
+	pWorld->obstacleShape[ obstacle ]	= (uint8)shape;
+	float2_set( &pWorld->obstacleBoundsMin[ obstacle ], minX - s_boundsPadding, minY - s_boundsPadding );
+	float2_set( &pWorld->obstacleBoundsMax[ obstacle ], maxX + s_boundsPadding, maxY + s_boundsPadding );
+	return TRUE;
+}
+
+int world_addCircle( World* pWorld, const Circle* pCircle )
+{
+	if( !world_addObstacle( pWorld, ObstacleType_Circle, pWorld->circleCount,
+		pCircle->center.x - pCircle->radius, pCircle->center.y - pCircle->radius,
+		pCircle->center.x + pCircle->radius, pCircle->center.y + pCircle->radius ) )
+	{
+		return FALSE;
+	}
+
+	pWorld->circles[ pWorld->circleCount++ ] = *pCircle;
+	return TRUE;
+}
+
+int world_addCapsule( World* pWorld, const Capsule* pCapsule )
+{
+	const Line* pLine = &pCapsule->line;
+	if( !world_addObstacle( pWorld, ObstacleType_Capsule, pWorld->capsuleCount,
+		float_min( pLine->a.x, pLine->b.x ) - pCapsule->radius, float_min( pLine->a.y, pLine->b.y ) - pCapsule->radius,
+		float_max( pLine->a.x, pLine->b.x ) + pCapsule->radius, float_max( pLine->a.y, pLine->b.y ) + pCapsule->radius ) )
+	{
+		return FALSE;
+	}
+
+	pWorld->capsules[ pWorld->capsuleCount++ ] = *pCapsule;
+	return TRUE;
+}
+
+int world_addPolygon( World* pWorld, const float2* pVertices, uint vertexCount )
+{
+	if( vertexCount < 3u || vertexCount > MaxPolygonVertices )
+	{
+		SYS_TRACE_WARNING( "invalid polygon vertex count %u\n", vertexCount );
+		return FALSE;
+	}
+	if( pWorld->polygonCount >= MaxWorldPolygons )
+	{
+		SYS_TRACE_WARNING( "too many world polygons!\n" );
+		return FALSE;
+	}
+
+	float2 boundsMin = pVertices[ 0u ];
+	float2 boundsMax = pVertices[ 0u ];
+	for( uint i = 1u; i < vertexCount; ++i )
+	{
+		float2_min( &boundsMin, &boundsMin, &pVertices[ i ] );
+		float2_max( &boundsMax, &boundsMax, &pVertices[ i ] );
+	}
+	if( !world_addObstacle( pWorld, ObstacleType_Polygon, pWorld->polygonCount, boundsMin.x, boundsMin.y, boundsMax.x, boundsMax.y ) )
+	{
+		return FALSE;
+	}
+
+	Polygon* pPolygon = &pWorld->polygons[ pWorld->polygonCount++ ];
+	pPolygon->vertexCount = vertexCount;
+	for( uint i = 0u; i < vertexCount; ++i )
+	{
+		pPolygon->vertices[ i ] = pVertices[ i ];
+	}
+	return TRUE;
+}
+
+int world_addSpawnPoint( World* pWorld, const float2* pPosition, float direction )
+{
+	if( pWorld->spawnPointCount >= MaxWorldSpawnPoints )
+	{
+		SYS_TRACE_WARNING( "too many spawn points!\n" );
+		return FALSE;
+	}
+
+	WorldSpawnPoint* pSpawnPoint = &pWorld->spawnPoints[ pWorld->spawnPointCount++ ];
+	pSpawnPoint->position	= *pPosition;
+	pSpawnPoint->direction	= direction;
+	return TRUE;
+}
+
+int world_addItemSite( World* pWorld, const float2* pPosition )
+{
+	if( pWorld->itemSiteCount >= MaxWorldItemSites )
+	{
+		SYS_TRACE_WARNING( "too many item sites!\n" );
+		return FALSE;
+	}
+
+	pWorld->itemSites[ pWorld->itemSiteCount++ ] = *pPosition;
+	return TRUE;
+}
+
+static float world_getObstacleCenter( const World* pWorld, uint obstacle, uint axis )
+{
+	const float2* pMin = &pWorld->obstacleBoundsMin[ obstacle ];
+	const float2* pMax = &pWorld->obstacleBoundsMax[ obstacle ];
+	return axis == 0u ? pMin->x + pMax->x : pMin->y + pMax->y;
+}
+
+static void world_buildNode( World* pWorld, uint nodeIndex, uint first, uint count )
+{
+	WorldBvhNode* pNode = &pWorld->bvhNodes[ nodeIndex ];
+
+	pNode->boundsMin = pWorld->obstacleBoundsMin[ pWorld->bvhObstacles[ first ] ];
+	pNode->boundsMax = pWorld->obstacleBoundsMax[ pWorld->bvhObstacles[ first ] ];
+	for( uint i = first + 1u; i < first + count; ++i )
+	{
+		const uint obstacle = pWorld->bvhObstacles[ i ];
+		float2_min( &pNode->boundsMin, &pNode->boundsMin, &pWorld->obstacleBoundsMin[ obstacle ] );
+		float2_max( &pNode->boundsMax, &pNode->boundsMax, &pWorld->obstacleBoundsMax[ obstacle ] );
+	}
+
+	if( count <= WorldBvhLeafSize )
+	{
+		pNode->first = (uint16)first;
+		pNode->count = (uint16)count;
+		return;
+	}
+
+	// split at the median obstacle along the longer side:
+	const uint axis = ( pNode->boundsMax.x - pNode->boundsMin.x >= pNode->boundsMax.y - pNode->boundsMin.y ) ? 0u : 1u;
+	uint16* pObstacles = &pWorld->bvhObstacles[ first ];
+	for( uint i = 1u; i < count; ++i )
+	{
+		const uint16 obstacle = pObstacles[ i ];
+		const float center = world_getObstacleCenter( pWorld, obstacle, axis );
+
+		uint j = i;
+		while( j > 0u && world_getObstacleCenter( pWorld, pObstacles[ j - 1u ], axis ) > center )
+		{
+			pObstacles[ j ] = pObstacles[ j - 1u ];
+			--j;
+		}
+		pObstacles[ j ] = obstacle;
+	}
+
+	const uint childIndex = pWorld->bvhNodeCount;
+	pWorld->bvhNodeCount += 2u;
+	SYS_ASSERT( pWorld->bvhNodeCount <= MaxWorldBvhNodes );
+
+	pNode->first = (uint16)childIndex;
+	pNode->count = 0u;
+
+	const uint half = count / 2u;
+	world_buildNode( pWorld, childIndex, first, half );
+	world_buildNode( pWorld, childIndex + 1u, first + half, count - half );
+}
+
+static void world_buildFreeCells( World* pWorld )
+{
+	float2 cellSize;
+	float2_sub( &cellSize, &pWorld->borderMax, &pWorld->borderMin );
+	float2_scale1f( &cellSize, &cellSize, 1.0f / (float)WorldFreeGridSize );
+
+	pWorld->freeCellCount = 0u;
+	for( uint y = 0u; y < WorldFreeGridSize; ++y )
+	{
+		for( uint x = 0u; x < WorldFreeGridSize; ++x )
+		{
+			Circle circle;
+			circle.center.x	= pWorld->borderMin.x + ( (float)x + 0.5f ) * cellSize.x;
+			circle.center.y	= pWorld->borderMin.y + ( (float)y + 0.5f ) * cellSize.y;
+			circle.radius	= s_carRadius;
+
+			if( circle.center.x - circle.radius < pWorld->borderMin.x || circle.center.x + circle.radius > pWorld->borderMax.x ||
+				circle.center.y - circle.radius < pWorld->borderMin.y || circle.center.y + circle.radius > pWorld->borderMax.y )
+			{
+				continue;
+			}
+			if( world_isCircleIntersecting( pWorld, &circle ) )
+			{
+				continue;
+			}
+
+			pWorld->freeCells[ pWorld->freeCellCount++ ] = circle.center;
+		}
+	}
+
+	if( pWorld->freeCellCount == 0u )
+	{
+		SYS_TRACE_WARNING( "the world has no room to spawn anything!\n" );
+	}
+}
+
+void world_build( World* pWorld )
+{
+	pWorld->bvhNodeCount = 0u;
+	if( pWorld->obstacleCount > 0u )
+	{
+		for( uint i = 0u; i < pWorld->obstacleCount; ++i )
+		{
+			pWorld->bvhObstacles[ i ] = (uint16)i;
+		}
+
+		pWorld->bvhNodeCount = 1u;
+		world_buildNode( pWorld, 0u, 0u, pWorld->obstacleCount );
+	}
+
+	world_buildFreeCells( pWorld );
+}
+
+static int isBoundsOverlapping( const float2* pMinA, const float2* pMaxA, const float2* pMinB, const float2* pMaxB )
+{
+	return pMinA->x <= pMaxB->x && pMinB->x <= pMaxA->x && pMinA->y <= pMaxB->y && pMinB->y <= pMaxA->y;
+}
+
+uint world_queryBounds( const World* pWorld, uint16* pObstacles, uint capacity, const float2* pMin, const float2* pMax )
+{
+	if( pWorld->bvhNodeCount == 0u )
+	{
+		return 0u;
+	}
+
+	uint count = 0u;
+
+	uint16 stack[ WorldBvhStackSize ];
+	uint stackSize = 0u;
+	stack[ stackSize++ ] = 0u;
+	while( stackSize > 0u )
+	{
+		const WorldBvhNode* pNode = &pWorld->bvhNodes[ stack[ --stackSize ] ];
+		if( !isBoundsOverlapping( &pNode->boundsMin, &pNode->boundsMax, pMin, pMax ) )
+		{
+			continue;
+		}
+
+		if( pNode->count == 0u )
+		{
+			SYS_ASSERT( stackSize + 2u <= SYS_COUNTOF( stack ) );
+			stack[ stackSize++ ] = (uint16)( pNode->first + 1u );
+			stack[ stackSize++ ] = pNode->first;
+			continue;
+		}
+
+		for( uint i = pNode->first; i < pNode->first + pNode->count; ++i )
+		{
+			const uint16 obstacle = pWorld->bvhObstacles[ i ];
+			if( !isBoundsOverlapping( &pWorld->obstacleBoundsMin[ obstacle ], &pWorld->obstacleBoundsMax[ obstacle ], pMin, pMax ) )
+			{
+				continue;
+			}
+			if( count == capacity )
+			{
+				SYS_TRACE_WARNING( "world query result dropped!\n" );
+				break;
+			}
+
+			uint j = count++;
+			while( j > 0u && pObstacles[ j - 1u ] > obstacle )
+			{
+				pObstacles[ j ] = pObstacles[ j - 1u ];
+				--j;
+			}
+			pObstacles[ j ] = obstacle;
+		}
+	}
+
+	return count;
+}
+
+static uint world_queryCircle( const World* pWorld, uint16* pObstacles, uint capacity, const Circle* pCircle )
+{
+	float2 boundsMin;
+	float2_add2f( &boundsMin, &pCircle->center, -pCircle->radius, -pCircle->radius );
+	float2 boundsMax;
+	float2_add2f( &boundsMax, &pCircle->center, pCircle->radius, pCircle->radius );
+	return world_queryBounds( pWorld, pObstacles, capacity, &boundsMin, &boundsMax );
+}
+
+int world_isObstacleIntersectingCircle( const World* pWorld, uint obstacle, const Circle* pCircle )
+{
+	const uint shape = pWorld->obstacleShape[ obstacle ];
+	switch( pWorld->obstacleType[ obstacle ] )
+	{
+	case ObstacleType_Circle:
+		return isCircleCircleIntersecting( &pWorld->circles[ shape ], pCircle );
+
+	case ObstacleType_Capsule:
+		return isCircleCapsuleIntersecting( pCircle, &pWorld->capsules[ shape ] );
+
+	case ObstacleType_Polygon:
+		return isCirclePolygonIntersecting( pCircle, &pWorld->polygons[ shape ] );
+	}
+	return FALSE;
+}
+
+int world_collideObstacle( const World* pWorld, uint obstacle, const Circle* pCircle, float2* pCirclePos )
+{
+	const uint shape = pWorld->obstacleShape[ obstacle ];
+	switch( pWorld->obstacleType[ obstacle ] )
+	{
+	case ObstacleType_Circle:
+		return circleCircleCollide( &pWorld->circles[ shape ], pCircle, 1.0f, 0, pCirclePos );
+
+	case ObstacleType_Capsule:
+		return capsuleCircleCollide( &pWorld->capsules[ shape ], pCircle, pCirclePos );
+
+	case ObstacleType_Polygon:
+		return polygonCircleCollide( &pWorld->polygons[ shape ], pCircle, pCirclePos );
+	}
+	return FALSE;
+}
+
+int world_isCircleIntersecting( const World* pWorld, const Circle* pCircle )
+{
+	uint16 obstacles[ MaxWorldObstacles ];
+	const uint obstacleCount = world_queryCircle( pWorld, obstacles, SYS_COUNTOF( obstacles ), pCircle );
+	for( uint i = 0u; i < obstacleCount; ++i )
+	{
+		if( world_isObstacleIntersectingCircle( pWorld, obstacles[ i ], pCircle ) )
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+uint world_getSweepObstacles( const World* pWorld, Capsule* pObstacles, uint capacity, const Circle* pCircle, const float2* pDisplacement )
+{
+	// sliding along a contact can leave the box around start and end, but never gets further than the displacement length:
+	const float reach = float2_length( pDisplacement ) + pCircle->radius;
+
+	float2 boundsMin;
+	float2_add2f( &boundsMin, &pCircle->center, -reach, -reach );
+	float2 boundsMax;
+	float2_add2f( &boundsMax, &pCircle->center, reach, reach );
+
+	uint16 obstacles[ MaxWorldObstacles ];
+	const uint obstacleCount = world_queryBounds( pWorld, obstacles, SYS_COUNTOF( obstacles ), &boundsMin, &boundsMax );
+
+	uint count = 0u;
+	for( uint i = 0u; i < obstacleCount; ++i )
+	{
+		const uint type = pWorld->obstacleType[ obstacles[ i ] ];
+		const uint shape = pWorld->obstacleShape[ obstacles[ i ] ];
+		const uint shapeCount = type == ObstacleType_Polygon ? pWorld->polygons[ shape ].vertexCount : 1u;
+		if( count + shapeCount > capacity )
+		{
+			SYS_TRACE_WARNING( "too many sweep obstacles!\n" );
+			break;
+		}
+
+		switch( type )
+		{
+		case ObstacleType_Circle:
+			pObstacles[ count ].line.a	= pWorld->circles[ shape ].center;
+			pObstacles[ count ].line.b	= pWorld->circles[ shape ].center;
+			pObstacles[ count ].radius	= pWorld->circles[ shape ].radius;
+			count++;
+			break;
+
+		case ObstacleType_Capsule:
+			pObstacles[ count++ ] = pWorld->capsules[ shape ];
+			break;
+
+		case ObstacleType_Polygon:
+			{
+				// the circle can only get inside through one of the edges:
+				const Polygon* pPolygon = &pWorld->polygons[ shape ];
+				for( uint j = 0u; j < pPolygon->vertexCount; ++j )
+				{
+					pObstacles[ count ].line.a	= pPolygon->vertices[ j ];
+					pObstacles[ count ].line.b	= pPolygon->vertices[ ( j + 1u ) % pPolygon->vertexCount ];
+					pObstacles[ count ].radius	= 0.0f;
+					count++;
+				}
+			}
+			break;
+		}
+	}
+
+	return count;
+}
+
+void world_castRays( const World* pWorld, RayBatch* pRays )
+{
+	// a hit closer than the current distance lies within that distance of the ray start, so every ray only
+	// needs the obstacles around its start. the union of them is tested against the whole batch
+	uint8 isGathered[ MaxWorldObstacles ] = { 0u };
+	uint16 gathered[ MaxWorldObstacles ];
+	uint gatheredCount = 0u;
+
+	for( uint i = 0u; i < pRays->count; ++i )
+	{
+		const float distance = pRays->distance[ i ];
+
+		float2 boundsMin;
+		float2_set( &boundsMin, pRays->ax[ i ] - distance, pRays->ay[ i ] - distance );
+		float2 boundsMax;
+		float2_set( &boundsMax, pRays->ax[ i ] + distance, pRays->ay[ i ] + distance );
+
+		uint16 obstacles[ MaxWorldObstacles ];
+		const uint obstacleCount = world_queryBounds( pWorld, obstacles, SYS_COUNTOF( obstacles ), &boundsMin, &boundsMax );
+		for( uint j = 0u; j < obstacleCount; ++j )
+		{
+			if( !isGathered[ obstacles[ j ] ] )
+			{
+				isGathered[ obstacles[ j ] ] = 1u;
+				gathered[ gatheredCount++ ] = obstacles[ j ];
+			}
+		}
+	}
+
+	// capsules are cast as their two caps and two sides, polygons as their edges:
+	Circle circles[ 2u * MaxWorldObstacles ];
+	uint circleCount = 0u;
+	Line lines[ 2u * MaxWorldObstacles + MaxPolygonVertices * MaxWorldPolygons ];
+	uint lineCount = 0u;
+
+	for( uint i = 0u; i < gatheredCount; ++i )
+	{
+		const uint shape = pWorld->obstacleShape[ gathered[ i ] ];
+		switch( pWorld->obstacleType[ gathered[ i ] ] )
+		{
+		case ObstacleType_Circle:
+			circles[ circleCount++ ] = pWorld->circles[ shape ];
+			break;
+
+		case ObstacleType_Capsule:
+			{
+				const Capsule* pCapsule = &pWorld->capsules[ shape ];
+				circles[ circleCount ].center = pCapsule->line.a;
+				circles[ circleCount ].radius = pCapsule->radius;
+				circleCount++;
+				circles[ circleCount ].center = pCapsule->line.b;
+				circles[ circleCount ].radius = pCapsule->radius;
+				circleCount++;
+
+				float2 normal;
+				float2_sub( &normal, &pCapsule->line.b, &pCapsule->line.a );
+				float2_perpendicular( &normal, &normal );
+				float2_normalize0( &normal );
+				float2_scale1f( &normal, &normal, pCapsule->radius );
+
+				float2_add( &lines[ lineCount ].a, &pCapsule->line.a, &normal );
+				float2_add( &lines[ lineCount ].b, &pCapsule->line.b, &normal );
+				lineCount++;
+				float2_sub( &lines[ lineCount ].a, &pCapsule->line.a, &normal );
+				float2_sub( &lines[ lineCount ].b, &pCapsule->line.b, &normal );
+				lineCount++;
+			}
+			break;
+
+		case ObstacleType_Polygon:
+			{
+				const Polygon* pPolygon = &pWorld->polygons[ shape ];
+				for( uint j = 0u; j < pPolygon->vertexCount; ++j )
+				{
+					lines[ lineCount ].a = pPolygon->vertices[ j ];
+					lines[ lineCount ].b = pPolygon->vertices[ ( j + 1u ) % pPolygon->vertexCount ];
+					lineCount++;
+				}
+			}
+			break;
+		}
+	}
+
+	raybatch_intersectCircles( pRays, circles, circleCount );
+	raybatch_intersectLines( pRays, lines, lineCount );
+}
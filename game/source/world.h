@@ -2,17 +2,103 @@
 #define WORLD_H_INCLUDED
 
 #include "geometry.h"
-#include "matrix.h"
+#include "settings.h"
 
-typedef struct 
+enum
 {
-	float2x3	worldTransform;
+	MaxWorldObstacles		= 64u,
+	MaxWorldPolygons		= 16u,
+	MaxWorldBvhNodes		= 2u * MaxWorldObstacles,
+	MaxWorldSweepObstacles	= 64u,		// capsules handed to sweepCircle (polygons need one per edge)
+	MaxWorldSpawnPoints		= MaxPlayer,
+	MaxWorldItemSites		= 32u,
+	WorldFreeGridSize		= 32u,		// cells per side of the spawn grid over the border
+	MaxWorldFreeCells		= WorldFreeGridSize * WorldFreeGridSize,
+	WorldBvhLeafSize		= 2u,
+	WorldBvhStackSize		= 32u		// of the bvh traversal, level files with deeper trees are rejected
+};
 
-	float2		borderMin;
-	float2		borderMax;
+enum
+{
+	ObstacleType_Circle,
+	ObstacleType_Capsule,
+	ObstacleType_Polygon
+};
+
+typedef struct
+{
+	float2		boundsMin;
+	float2		boundsMax;
+	uint16		first;		// first child (the second one follows it) for inner nodes, first bvhObstacles entry for leaves
+	uint16		count;		// 0 for inner nodes
+} WorldBvhNode;
+
+typedef struct
+{
+	float2		position;
+	float		direction;
+} WorldSpawnPoint;
+
+// everything the simulation knows about a level. there are no pointers in here so a world can be used
+// straight from a mapped level file (see level.h) and shared by every match that plays on it
+typedef struct
+{
+	float2			borderMin;
+	float2			borderMax;
+
+	// per obstacle in structure of arrays layout. obstacleShape indexes the shape array of the obstacle type
+	uint32			obstacleCount;
+	uint8			obstacleType[ MaxWorldObstacles ];
+	uint8			obstacleShape[ MaxWorldObstacles ];
+	float2			obstacleBoundsMin[ MaxWorldObstacles ];
+	float2			obstacleBoundsMax[ MaxWorldObstacles ];
+
+	uint32			circleCount;
+	uint32			capsuleCount;
+	uint32			polygonCount;
+	Circle			circles[ MaxWorldObstacles ];
+	Capsule			capsules[ MaxWorldObstacles ];
+	Polygon			polygons[ MaxWorldPolygons ];
 
-	Circle		rockz[ 4u ];
+	// built by world_build after all obstacles were added:
+	uint32			bvhNodeCount;
+	WorldBvhNode	bvhNodes[ MaxWorldBvhNodes ];
+	uint16			bvhObstacles[ MaxWorldObstacles ];
 
+	// spawning picks the best of these if there are any, otherwise the best of some random free cells
+	uint32			spawnPointCount;
+	WorldSpawnPoint	spawnPoints[ MaxWorldSpawnPoints ];
+	uint32			itemSiteCount;
+	float2			itemSites[ MaxWorldItemSites ];
+
+	// centers of the spawn grid cells where a car fits without touching an obstacle or the border.
+	// built by world_build, spawning picks from them in O(1)
+	uint32			freeCellCount;
+	float2			freeCells[ MaxWorldFreeCells ];
 } World;
 
+void	world_init( World* pWorld, const float2* pBorderMin, const float2* pBorderMax );
+
+// return FALSE if the world is full (or the polygon has too many vertices)
+int		world_addCircle( World* pWorld, const Circle* pCircle );
+int		world_addCapsule( World* pWorld, const Capsule* pCapsule );
+int		world_addPolygon( World* pWorld, const float2* pVertices, uint vertexCount );
+int		world_addSpawnPoint( World* pWorld, const float2* pPosition, float direction );
+int		world_addItemSite( World* pWorld, const float2* pPosition );
+
+void	world_build( World* pWorld );
+
+// writes the indices of all obstacles with bounds overlapping [pMin,pMax] in ascending order, so results don't depend on the tree layout
+uint	world_queryBounds( const World* pWorld, uint16* pObstacles, uint capacity, const float2* pMin, const float2* pMax );
+
+int		world_isCircleIntersecting( const World* pWorld, const Circle* pCircle );
+int		world_isObstacleIntersectingCircle( const World* pWorld, uint obstacle, const Circle* pCircle );
+int		world_collideObstacle( const World* pWorld, uint obstacle, const Circle* pCircle, float2* pCirclePos );
+
+// the obstacles a circle moving by pDisplacement can touch, as capsules for sweepCircle
+uint	world_getSweepObstacles( const World* pWorld, Capsule* pObstacles, uint capacity, const Circle* pCircle, const float2* pDisplacement );
+
+// shortens the rays in the batch to their closest obstacle hit. only obstacles within the current ray distance are tested
+void	world_castRays( const World* pWorld, RayBatch* pRays );
+
 #endif